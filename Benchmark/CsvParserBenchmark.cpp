@@ -0,0 +1,136 @@
+﻿# include <Siv3D.hpp> // Siv3D v0.6.14
+# include "SimpleGridViewer/CsvParser.hpp"
+
+// ウィンドウを作らずに、合成した CSV を CsvParser で解析する速さを測る
+SIV3D_SET(EngineOption::Renderer::Headless)
+
+namespace
+{
+	using namespace SimpleGridViewer;
+
+	constexpr size_t DataBytes = (512 << 20);
+
+	constexpr size_t RepeatCount = 3;
+
+	// 引用符の規則を確かめる行。フィールドの途中の引用符はただの文字で、引用はフィールドの先頭でだけ始まる
+	constexpr std::string_view CheckLines =
+		"12\" pipe,plain,1\n"
+		"\"a,\"\"b\"\"\",x,2\n"
+		"\"multi\nline\",y,3\n"
+		"w\"x\"y,\"z\",4\n"
+		"\"\",\",\",5\r\n";
+
+	const std::array<std::array<StringView, 3>, 5> CheckCells{ {
+		{ U"12\" pipe", U"plain", U"1" },
+		{ U"a,\"b\"", U"x", U"2" },
+		{ U"multi\nline", U"y", U"3" },
+		{ U"w\"x\"y", U"z", U"4" },
+		{ U"", U",", U"5" },
+	} };
+
+	// 分割した塊の境界がいろいろな位置に来るよう、確かめる行を数 MB 分並べて解析する
+	bool CheckQuotes(size_t threadCount)
+	{
+		constexpr size_t Repeat = 200'000;
+		std::string data;
+		data.reserve(CheckLines.size() * Repeat);
+		for (size_t i = 0; i < Repeat; ++i)
+		{
+			data += CheckLines;
+		}
+
+		const ColumnarStore store = CsvParser::Parse(data, CsvParser::Options{ .threadCount = threadCount });
+		if ((store.rowCount() != (CheckCells.size() * Repeat)) || (store.columnCount() != 3))
+		{
+			return false;
+		}
+
+		CellWindow window;
+		window.reset({ 0, store.rowCount() }, { 0, 3 });
+		store.fetch(window);
+		for (size_t row = 0; row < store.rowCount(); ++row)
+		{
+			for (size_t column = 0; column < 3; ++column)
+			{
+				if (window.at(row, column) != CheckCells[row % CheckCells.size()][column])
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// 整数、小数、少ない種類の文字列、ばらばらの文字列、引用した文字列の列を並べる
+	std::string MakeData(size_t bytes)
+	{
+		constexpr std::array<std::string_view, 8> Words{ "alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta" };
+
+		std::string data;
+		data.reserve(bytes + 256);
+		data += "id,price,category,name,note\n";
+
+		uint64 random = 1;
+		for (uint64 row = 0; data.size() < bytes; ++row)
+		{
+			random = (random * 6364136223846793005ull + 1442695040888963407ull);
+			const uint32 value = static_cast<uint32>(random >> 33);
+
+			data += std::to_string(row);
+			data += ',';
+			data += std::to_string(value % 100000);
+			data += '.';
+			data += static_cast<char>('1' + (value % 9));
+			data += ',';
+			data += Words[value % Words.size()];
+			data += ",item";
+			data += std::to_string(value);
+			data += ',';
+			switch (value % 4)
+			{
+			case 0:
+				data += "\"a, \"\"quoted\"\" note\"";
+				break;
+			case 1:
+				data += "12\" pipe";
+				break;
+			default:
+				data += "note";
+				break;
+			}
+			data += '\n';
+		}
+		return data;
+	}
+}
+
+void Main()
+{
+	Console.open();
+
+	Console << U"quote rules (1 thread): {}"_fmt(CheckQuotes(1) ? U"ok" : U"NG");
+	Console << U"quote rules (all threads): {}"_fmt(CheckQuotes(0) ? U"ok" : U"NG");
+
+	const std::string data = MakeData(DataBytes);
+	const double gigabytes = (data.size() / 1e9);
+	Console << U"data: {:.2f} GB"_fmt(gigabytes);
+	Console << U"threads, best [ms], throughput [GB/s]";
+
+	size_t checksum = 0;
+	for (const size_t threadCount : Array<size_t>{ 1, 2, 4, 0 })
+	{
+		double bestMs = Math::Inf;
+		for (size_t i = 0; i < RepeatCount; ++i)
+		{
+			const Stopwatch stopwatch{ StartImmediately::Yes };
+			const ColumnarStore store = CsvParser::Parse(data, CsvParser::Options{ .header = true, .threadCount = threadCount });
+			bestMs = Min(bestMs, stopwatch.msF());
+			checksum += store.rowCount();
+		}
+
+		const size_t threads = ((threadCount == 0) ? std::thread::hardware_concurrency() : threadCount);
+		Console << U"{}, {:.1f}, {:.2f}"_fmt(threads, bestMs, (gigabytes / (bestMs / 1000.0)));
+	}
+
+	Console << U"checksum: {}"_fmt(checksum);
+}
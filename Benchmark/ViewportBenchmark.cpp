@@ -0,0 +1,76 @@
+﻿# include <Siv3D.hpp> // Siv3D v0.6.14
+# include "gridcell/CellGrid.hpp"
+
+// ウィンドウを作らずに、スクロール位置から表示範囲を求める処理の時間を行数ごとに測る
+SIV3D_SET(EngineOption::Renderer::Headless)
+
+namespace
+{
+	constexpr int32 ColumnCount = 20;
+
+	constexpr Size CellSize{ 80, 20 };
+
+	constexpr Size ViewSize{ 1600, 900 };
+
+	constexpr size_t FrameCount = 100'000;
+
+	struct ViewportResult
+	{
+		// CellGrid を作るのにかかった時間（ミリ秒）
+		double buildMs = 0.0;
+
+		// 1 フレーム分の表示範囲を求めるのにかかった平均の時間（マイクロ秒）
+		double frameUs = 0.0;
+
+		// 計算が最適化で消されないように、結果を足し合わせておく
+		size_t checksum = 0;
+	};
+
+	ViewportResult MeasureViewport(size_t rowCount)
+	{
+		ViewportResult result;
+
+		// 高さの違う行を 1000 か所ほど混ぜて、幅がそろっていない軸にする
+		const Stopwatch buildWatch{ StartImmediately::Yes };
+		CellGrid grid{ Size{ ColumnCount, static_cast<int32>(rowCount) }, CellSize };
+		Array<std::pair<size_t, int32>> heights;
+		for (size_t row = 0; row < rowCount; row += Max<size_t>((rowCount / 1000), 1))
+		{
+			heights.emplace_back(row, (CellSize.y + static_cast<int32>(row % 3) * 10));
+		}
+		grid.setRowHeights(heights);
+		result.buildMs = buildWatch.msF();
+
+		// フレームごとにスクロール位置を飛ばしながら、SpreadSheet と同じく queryVisible で表示範囲を求める
+		const uint64 scrollRange = static_cast<uint64>(Max((grid.getTotalHeight() - ViewSize.y), 1));
+		uint64 random = 1;
+		CellGrid::VisibleSpan span;
+		const Stopwatch frameWatch{ StartImmediately::Yes };
+		for (size_t frame = 0; frame < FrameCount; ++frame)
+		{
+			random = (random * 6364136223846793005ull + 1442695040888963407ull);
+			const double scrollY = static_cast<double>((random >> 33) % scrollRange);
+			grid.queryVisible(RectF{ 0, scrollY, ViewSize.x, ViewSize.y }, span);
+			result.checksum += (span.firstRow + span.lastRow);
+		}
+		result.frameUs = (frameWatch.usF() / FrameCount);
+
+		return result;
+	}
+}
+
+void Main()
+{
+	Console.open();
+	Console << U"rows, build [ms], viewport per frame [us]";
+
+	size_t checksum = 0;
+	for (const size_t rowCount : Array<size_t>{ 1'000, 10'000, 100'000, 1'000'000, 10'000'000, 100'000'000 })
+	{
+		const ViewportResult result = MeasureViewport(rowCount);
+		Console << U"{}, {:.1f}, {:.3f}"_fmt(rowCount, result.buildMs, result.frameUs);
+		checksum += result.checksum;
+	}
+
+	Console << U"checksum: {}"_fmt(checksum);
+}
@@ -1,36 +1,176 @@
-﻿# include <Siv3D.hpp> // Siv3D v0.6.14
-# include "SimpleGridViewer/SpreadSheet.hpp"
-
-void Main()
-{
-	Window::Resize(1920, 1009);
-	Scene::SetBackground(Color(34, 116, 71));
-
-	size_t columnCount = 20;
-	size_t rowCount = 24;
-
-	SimpleGridViewer::SpreadSheet spreadSheet{ {columnCount, rowCount }, { 10, 10 }, { 0, 0 } };
-
-	Grid<String> values(columnCount, rowCount);
-	Array<String> columnNames = SimpleGridViewer::AlphabetUtility::GenerateAlphabetArray(columnCount);
-
-	for (size_t row = 0; row < rowCount; ++row)
-	{
-		for (size_t column = 0; column < columnCount; ++column)
-		{
-			values[row][column] = U"{}{}"_fmt(columnNames[column], row);
-		}
-	}
-
-	spreadSheet.setValues(values);
-	spreadSheet.setTextFont(Font(15));
-
-
-	while (System::Update())
-	{
-		const Transformer2D t{ Mat3x2::Translate(50, 50), TransformCursor::Yes };
-		spreadSheet.update();
-
-		spreadSheet.draw();
-	}
-}
+﻿# include <Siv3D.hpp> // Siv3D v0.6.14
+# include "SimpleGridViewer/SpreadSheet.hpp"
+# include "SimpleGridViewer/ColumnarStore.hpp"
+# include "SimpleGridViewer/CsvFileSource.hpp"
+# include "SimpleGridViewer/CsvParser.hpp"
+
+void Main()
+{
+	Window::Resize(1920, 1009);
+	Scene::SetBackground(Color(34, 116, 71));
+
+	size_t columnCount = 20;
+	size_t rowCount = 24;
+
+	SimpleGridViewer::SpreadSheet spreadSheet{ {columnCount, rowCount }, { 10, 10 }, { 0, 0 } };
+
+	Grid<String> values(columnCount, rowCount);
+	Array<String> columnNames = SimpleGridViewer::AlphabetUtility::GenerateAlphabetArray(columnCount);
+
+	for (size_t row = 0; row < rowCount; ++row)
+	{
+		for (size_t column = 0; column < columnCount; ++column)
+		{
+			values[row][column] = U"{}{}"_fmt(columnNames[column], row);
+		}
+	}
+
+	spreadSheet.setSource(std::make_shared<SimpleGridViewer::ColumnarStore>(SimpleGridViewer::ColumnarStore::FromGrid(values)));
+	spreadSheet.setTextFont(Font(15));
+
+	// 列の見出しは A1 形式にする
+	spreadSheet.setColumnLabelGenerator(SimpleGridViewer::HeaderLabels::Alphabet);
+
+	// 操作していない間は、前のフレームで描いたシートを使い回す
+	spreadSheet.setFrameCacheEnabled(true);
+
+	// セルはタイルごとに描いておき、スクロールしたら新しく見えたタイルだけを描く
+	spreadSheet.setTileCacheEnabled(true);
+
+	// 検索する文字列
+	TextEditState findText;
+
+	// 表示が変わらず、操作も裏で動いている処理も無い間は、フレームレートを下げて CPU と GPU を休ませる
+	constexpr double IdleFrameRateHz = 10.0;
+	bool idle = false;
+
+	while (System::Update())
+	{
+		// CSV / TSV ファイルをドロップすると、そのファイルを表示する
+		// Ctrl を押しながらドロップした場合は、全体を読み込んで型ごとの列に変換する
+		if (DragDrop::HasNewFilePaths())
+		{
+			const FilePath path = DragDrop::GetDroppedFilePaths().front().path;
+			if (KeyControl.pressed())
+			{
+				SimpleGridViewer::CsvParser::Options options;
+				options.delimiter = ((FileSystem::Extension(path) == U"tsv") ? '\t' : ',');
+				if (auto store = SimpleGridViewer::CsvParser::Load(path, options))
+				{
+					spreadSheet.setSource(std::make_shared<SimpleGridViewer::ColumnarStore>(std::move(*store)));
+				}
+			}
+			else
+			{
+				auto source = std::make_shared<SimpleGridViewer::CsvFileSource>();
+				if (source->open(path))
+				{
+					spreadSheet.setSource(source);
+				}
+			}
+		}
+
+		// 入力するたびに検索し直す。 Enter / F3 で次、 Shift + F3 で前の一致に移動する
+		if (SimpleGUI::TextBox(findText, Vec2{ 1000, 7 }, 300))
+		{
+			spreadSheet.find(findText.text);
+		}
+		if (findText.enterKey || (KeyF3.down() && (not KeyShift.pressed())))
+		{
+			spreadSheet.findNext();
+		}
+		else if (KeyF3.down() && KeyShift.pressed())
+		{
+			spreadSheet.findPrevious();
+		}
+		if (const auto& finder = spreadSheet.getFinder(); (not finder.query().isEmpty()))
+		{
+			SimpleGUI::GetFont()(U"{} 件 ({:.0f}%)"_fmt(finder.getMatchCount(), (finder.getProgress() * 100))).draw(1310, 10);
+		}
+
+		// F4 で選択中のセルより上の行と左の列を固定する。固定している場合は解除する
+		if (KeyF4.down())
+		{
+			if (spreadSheet.getFrozenRows() || spreadSheet.getFrozenColumns())
+			{
+				spreadSheet.setFrozenPanes(0, 0);
+			}
+			else if (const auto cell = spreadSheet.getSelectedCell())
+			{
+				spreadSheet.setFrozenPanes(cell->y, cell->x);
+			}
+		}
+
+		// 前のフレームの描画命令の数
+		SimpleGUI::GetFont()(U"描画命令 {}"_fmt(Profiler::GetStat().drawCalls)).draw(1700, 10);
+
+		const Transformer2D t{ Mat3x2::Translate(50, 50), TransformCursor::Yes };
+		spreadSheet.update();
+
+		// draw() の前に確かめる。 draw() の後は描いた状態と同じになる
+		const bool active = (spreadSheet.needsRedraw() || spreadSheet.hasBackgroundWork()
+			|| (not Cursor::Delta().isZero()) || (Mouse::Wheel() != 0.0)
+			|| MouseL.pressed() || MouseR.pressed() || (not Keyboard::GetAllInputs().isEmpty()));
+
+		spreadSheet.draw();
+
+		// 範囲選択した領域の数値の集計
+		if (const auto& summary = spreadSheet.getSelectedRangeSummary())
+		{
+			const String text = (summary->count
+				? U"合計 {}  平均 {}  最小 {}  最大 {}  数値の個数 {}"_fmt(summary->sum, summary->mean(), summary->min, summary->max, summary->count)
+				: String{ U"数値の個数 0" });
+			SimpleGUI::GetFont()(text).draw(50, (Scene::Height() - 40));
+		}
+
+		// 選択中の列の統計
+		if (const auto stats = spreadSheet.getSelectedColumnStats())
+		{
+			Array<String> lines{
+				U"列 {}"_fmt(stats->column),
+				U"件数 {}"_fmt(stats->count),
+				U"空のセル {}"_fmt(stats->nullCount),
+				U"異なる値 {}"_fmt(stats->distinctCount),
+			};
+			if (stats->numeric)
+			{
+				lines.push_back(U"最小 {}"_fmt(stats->min));
+				lines.push_back(U"最大 {}"_fmt(stats->max));
+				lines.push_back(U"合計 {}"_fmt(stats->sum));
+				lines.push_back(U"平均 {}"_fmt(stats->mean));
+				lines.push_back(U"標準偏差 {}"_fmt(stats->stddev));
+			}
+			else
+			{
+				lines.push_back(U"最小 {}"_fmt(stats->minText));
+				lines.push_back(U"最大 {}"_fmt(stats->maxText));
+			}
+
+			Vec2 pos{ 950, 50 };
+			for (const auto& line : lines)
+			{
+				SimpleGUI::GetFont()(line).draw(pos);
+				pos.y += 30;
+			}
+		}
+		else if (spreadSheet.isComputingColumnStats())
+		{
+			SimpleGUI::GetFont()(U"集計中...").draw(950, 50);
+		}
+
+		if (idle == active)
+		{
+			idle = (not active);
+			if (idle)
+			{
+				Graphics::SetVSyncEnabled(false);
+				Graphics::SetTargetFrameRateHz(IdleFrameRateHz);
+			}
+			else
+			{
+				Graphics::SetTargetFrameRateHz(none);
+				Graphics::SetVSyncEnabled(true);
+			}
+		}
+	}
+}
@@ -378,6 +378,9 @@ namespace SasaGUI
 
 		double viewportSize() const;
 
+		// スクロールや色の変化の途中なら true
+		bool isAnimating() const;
+
 		void updateLayout(Rect rect);
 		void updateConstraints(double minimum, double maximum, double viewportSize);
 		void show();
@@ -0,0 +1,112 @@
+﻿# pragma once
+
+namespace SimpleGridViewer
+{
+	// 1 つの処理を別のスレッドで走らせる。新しく始めると、前の処理は中断してから始める
+	// 処理が持ち主のメンバを読み書きする場合は、持ち主のメンバの最後に置き、ほかのメンバより先に破棄されるようにする
+	class BackgroundThread
+	{
+	public:
+		BackgroundThread() = default;
+
+		BackgroundThread(const BackgroundThread&) = delete;
+
+		BackgroundThread& operator=(const BackgroundThread&) = delete;
+
+		~BackgroundThread()
+		{
+			cancel();
+		}
+
+		// function(std::stop_token) を別のスレッドで呼ぶ
+		template <class Function>
+		void start(Function function)
+		{
+			cancel();
+
+			m_busy = true;
+			m_thread = std::jthread{ [this, function = std::move(function)](std::stop_token stopToken) mutable
+			{
+				function(stopToken);
+				m_busy = false;
+			} };
+		}
+
+		// 処理を中断し、スレッドが終わるのを待つ
+		void cancel()
+		{
+			if (m_thread.joinable())
+			{
+				m_thread.request_stop();
+				m_thread.join();
+			}
+			m_busy = false;
+		}
+
+		bool isBusy() const noexcept
+		{
+			return m_busy;
+		}
+
+	private:
+		std::atomic<bool> m_busy{ false };
+
+		std::jthread m_thread;
+	};
+
+	// 結果を 1 つ返す処理を別のスレッドで走らせ、終わったら結果を 1 度だけ受け取る
+	template <class Result>
+	class BackgroundTask
+	{
+	public:
+		// function(std::stop_token) を別のスレッドで呼ぶ。 function は中断された場合に none を返す
+		template <class Function>
+		void start(Function function)
+		{
+			cancel();
+
+			m_thread.start([this, function = std::move(function)](std::stop_token stopToken) mutable
+			{
+				Optional<Result> result = function(stopToken);
+				if (result)
+				{
+					std::lock_guard lock{ m_mutex };
+					m_result = std::move(result);
+				}
+			});
+		}
+
+		// 処理を中断して、まだ受け取っていない結果も捨てる
+		void cancel()
+		{
+			m_thread.cancel();
+
+			std::lock_guard lock{ m_mutex };
+			m_result.reset();
+		}
+
+		bool isBusy() const noexcept
+		{
+			return m_thread.isBusy();
+		}
+
+		// 処理が終わっていれば結果を返す。同じ結果は 1 度だけ返す
+		Optional<Result> takeResult()
+		{
+			if (m_thread.isBusy())
+			{
+				return none;
+			}
+
+			std::lock_guard lock{ m_mutex };
+			return std::exchange(m_result, none);
+		}
+
+	private:
+		std::mutex m_mutex;
+
+		Optional<Result> m_result;
+
+		BackgroundThread m_thread;
+	};
+}
@@ -0,0 +1,94 @@
+﻿# pragma once
+# include <deque>
+# include "SimpleGridViewer/CellSource.hpp"
+# include "SimpleGridViewer/SubstringSearcher.hpp"
+# include "SimpleGridViewer/BackgroundTask.hpp"
+
+namespace SimpleGridViewer
+{
+	// 検索語を含むセルの位置。行優先の順に並べる
+	struct FindMatch
+	{
+		size_t row = 0;
+
+		size_t column = 0;
+
+		auto operator<=>(const FindMatch&) const = default;
+	};
+
+	// 全てのセルから検索語を含むものを探す
+	// 行を一定数ずつの塊に分けて複数のスレッドで調べ、塊ごとに結果を公開するので、探している間も見つかった分から使える
+	class CellFinder
+	{
+	public:
+		CellFinder() = default;
+
+		CellFinder(const CellFinder&) = delete;
+
+		CellFinder& operator=(const CellFinder&) = delete;
+
+		// 別のスレッドで探し始める。前回の検索が終わっていなければ中断し、結果を捨てる
+		void start(std::shared_ptr<const ICellSource> source, StringView query, size_t threadCount = 0);
+
+		// 検索を中断して、結果を捨てる
+		void cancel();
+
+		// 末尾に増えた行を別のスレッドで調べ始める。探している間は呼ばない
+		// 結果は mergeAppendedRows() で加える
+		void scanAppendedRows(std::shared_ptr<const ICellSource> source, size_t threadCount = 0);
+
+		// 増えた行を調べ終えていれば、見つかった位置を加えて true を返す
+		bool mergeAppendedRows();
+
+		// 書き換えられた 1 つのセルを調べ直す。探している間は呼ばない
+		void rescanCell(const ICellSource& source, size_t row, size_t column);
+
+		// 全体の検索か、増えた行の検索が終わっていなければ true
+		bool isBusy() const noexcept;
+
+		const String& query() const noexcept;
+
+		// 調べ終えた行の割合 [0.0, 1.0]
+		double getProgress() const noexcept;
+
+		// これまでに見つかった数
+		size_t getMatchCount() const noexcept;
+
+		bool isMatch(size_t row, size_t column) const;
+
+		// これまでに見つかった全ての位置を、行優先の順に返す
+		Array<FindMatch> getMatches() const;
+
+		// 先頭の count 行が捨てられて残りの行が前に詰められたとき、見つかっている位置を同じだけずらす
+		// 探している間は呼ばない
+		void eraseLeadingRows(size_t count);
+
+	private:
+		// 1 つの塊の結果。 ready が立つまで、探す側のスレッドだけが書き換える
+		struct Chunk
+		{
+			Array<FindMatch> matches;
+
+			std::atomic<bool> ready{ false };
+		};
+
+		String m_query;
+
+		SubstringSearcher m_searcher;
+
+		// 調べる行数
+		size_t m_rowCount = 0;
+
+		// 行が増えると末尾に塊を加えるので、既存の塊が動かない std::deque に置く
+		std::deque<Chunk> m_chunks;
+
+		std::atomic<size_t> m_finishedChunks{ 0 };
+
+		std::atomic<size_t> m_matchCount{ 0 };
+
+		// 増えた行 [m_rowCount, 調べ終えた行数) で見つかった位置
+		BackgroundTask<std::pair<size_t, Array<FindMatch>>> m_appendedScan;
+
+		BackgroundThread m_thread;
+	};
+}
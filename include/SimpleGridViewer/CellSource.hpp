@@ -0,0 +1,136 @@
+﻿# pragma once
+
+namespace SimpleGridViewer
+{
+	// [first, last) の添字の範囲
+	struct IndexRange
+	{
+		size_t first = 0;
+
+		size_t last = 0;
+
+		size_t size() const noexcept
+		{
+			return (first < last) ? (last - first) : 0;
+		}
+
+		bool isEmpty() const noexcept
+		{
+			return (last <= first);
+		}
+
+		bool contains(size_t index) const noexcept
+		{
+			return (first <= index && index < last);
+		}
+
+		bool operator==(const IndexRange&) const = default;
+	};
+
+	// 表示中の範囲のセルの文字列を保持するバッファ
+	class CellWindow
+	{
+	public:
+		// 範囲を変更する。確保済みの文字列の領域は再利用される
+		void reset(const IndexRange& rows, const IndexRange& columns);
+
+		const IndexRange& rows() const noexcept;
+
+		const IndexRange& columns() const noexcept;
+
+		bool contains(size_t row, size_t column) const noexcept;
+
+		String& at(size_t row, size_t column);
+
+		const String& at(size_t row, size_t column) const;
+
+	private:
+		IndexRange m_rows;
+
+		IndexRange m_columns;
+
+		Array<String> m_cells;
+	};
+
+	// SpreadSheet に表示するデータの供給元
+	// SpreadSheet は表示中の範囲のセルだけを fetch で問い合わせる
+	// 並べ替えや絞り込み、検索、統計は別のスレッドから const のメンバ関数を呼ぶ。その間は setCell() や appendRow() で書き換えない
+	class ICellSource
+	{
+	public:
+		virtual ~ICellSource() = default;
+
+		virtual size_t rowCount() const = 0;
+
+		virtual size_t columnCount() const = 0;
+
+		// 内容が変わるたびに増える値。変わっていなければ fetch し直さなくてよい
+		virtual uint64 version() const = 0;
+
+		// window.rows() と window.columns() の範囲のセルを window に書き込む
+		// 範囲は rowCount() / columnCount() の内側に収まっている
+		virtual void fetch(CellWindow& window) const = 0;
+
+		// 保持している文字列をコピーせずに参照できるセルだけ値を返す
+		// 参照は次に内容を変更するまで有効
+		virtual Optional<StringView> view(size_t, size_t) const
+		{
+			return none;
+		}
+
+		// 書き換えられる供給元だけが実装する。書き換えたら version() を進める
+		// 範囲外の場合や、値を受け付けられない場合は false
+		virtual bool setCell(size_t, size_t, StringView)
+		{
+			return false;
+		}
+
+		// 末尾に行を追加できる供給元だけが実装する
+		// 追加しても rowCount() が増えない供給元は、増えなかった数だけ先頭の行を捨てて残りの行を前に詰める
+		virtual bool appendRow(std::span<const String>)
+		{
+			return false;
+		}
+	};
+
+	// Grid<String> をそのまま保持する ICellSource
+	class GridCellSource : public ICellSource
+	{
+	public:
+		GridCellSource() = default;
+
+		explicit GridCellSource(const Size& size);
+
+		explicit GridCellSource(Grid<String> values);
+
+		size_t rowCount() const override;
+
+		size_t columnCount() const override;
+
+		uint64 version() const override;
+
+		void fetch(CellWindow& window) const override;
+
+		Optional<StringView> view(size_t row, size_t column) const override;
+
+		bool setCell(size_t row, size_t column, StringView value) override;
+
+		const Grid<String>& values() const noexcept;
+
+		// 重なる範囲だけをコピーする
+		void setValues(const Grid<String>& values);
+
+		// 大きさが同じならバッファをそのまま引き取る。違う場合は重なる範囲だけを移動する
+		void setValues(Grid<String>&& values);
+
+		// topLeft を左上として values を書き込む。はみ出す部分は無視する
+		void setRegion(const Point& topLeft, const Grid<String>& values);
+
+		Optional<String> getValue(size_t row, size_t column) const;
+
+	private:
+		Grid<String> m_values;
+
+		uint64 m_version = 0;
+	};
+}
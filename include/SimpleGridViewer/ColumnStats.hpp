@@ -0,0 +1,89 @@
+﻿# pragma once
+# include "SimpleGridViewer/CellSource.hpp"
+# include "SimpleGridViewer/BackgroundTask.hpp"
+
+namespace SimpleGridViewer
+{
+	// 異なる値の数を一定のメモリで見積もる HyperLogLog
+	// 2^12 個のレジスタで、誤差は 1.6% 程度
+	class HyperLogLog
+	{
+	public:
+		static constexpr uint32 Precision = 12;
+
+		static constexpr size_t RegisterCount = (size_t{ 1 } << Precision);
+
+		// hash は値を十分に混ぜた 64 ビットのハッシュ値
+		void add(uint64 hash) noexcept;
+
+		void merge(const HyperLogLog& other) noexcept;
+
+		double estimate() const noexcept;
+
+	private:
+		std::array<uint8, RegisterCount> m_registers{};
+	};
+
+	// 1 列分の統計
+	// 空のセルと null は count に含めず、 nullCount に数える
+	struct ColumnStats
+	{
+		size_t column = 0;
+
+		size_t count = 0;
+
+		size_t nullCount = 0;
+
+		// 値のある全てのセルが数値として解釈できた場合は true 。 min 以降の数値はこの場合だけ有効
+		bool numeric = false;
+
+		double min = 0.0;
+
+		double max = 0.0;
+
+		double sum = 0.0;
+
+		double mean = 0.0;
+
+		// 標本標準偏差。値が 1 つ以下なら 0
+		double stddev = 0.0;
+
+		// 数値でない列の、文字列としての最小と最大
+		String minText;
+
+		String maxText;
+
+		// 異なる値の数。辞書で符号化した列では正確な値、それ以外は見積もり
+		size_t distinctCount = 0;
+	};
+
+	// 列の統計を求める
+	// ColumnarStore の数値の列は型ごとの配列を SIMD でまとめて集計し、それ以外の供給元は文字列を数値に変換してから集計する
+	class ColumnStatsCalculator
+	{
+	public:
+		ColumnStatsCalculator() = default;
+
+		ColumnStatsCalculator(const ColumnStatsCalculator&) = delete;
+
+		ColumnStatsCalculator& operator=(const ColumnStatsCalculator&) = delete;
+
+		// 別のスレッドで集計を始める。前回の集計が終わっていなければ中断する
+		void start(std::shared_ptr<const ICellSource> source, size_t column, size_t threadCount = 0);
+
+		// 集計を中断し、スレッドが終わるのを待つ
+		void cancel();
+
+		bool isBusy() const noexcept;
+
+		// 集計が終わっていれば結果を返す。同じ結果は 1 度だけ返す
+		Optional<ColumnStats> takeResult();
+
+		// 呼び出したスレッドで集計する
+		// threadCount が 0 なら全てのコアを使う。中断された場合と列が無い場合は none
+		static Optional<ColumnStats> Compute(const ICellSource& source, size_t column, size_t threadCount = 0, std::stop_token stopToken = {});
+
+	private:
+		BackgroundTask<ColumnStats> m_task;
+	};
+}
@@ -0,0 +1,364 @@
+﻿# pragma once
+# include "SimpleGridViewer/CellSource.hpp"
+
+namespace SimpleGridViewer
+{
+	enum class ColumnType : uint8
+	{
+		Int64,
+		Double,
+		Bool,
+
+		// 辞書で符号化した文字列
+		Dictionary,
+
+		// UTF-8 の文字列を 1 つのバッファに詰めたもの
+		String,
+	};
+
+	// 値の有無を表すビット列
+	// null が 1 つも無い間はビット列を確保しない
+	class ValidityBitmap
+	{
+	public:
+		size_t size() const noexcept;
+
+		size_t nullCount() const noexcept;
+
+		bool isValid(size_t index) const noexcept;
+
+		// 1 行を 1 ビットで表し、値があれば 1 。 null が 1 つも無ければ空
+		const Array<uint64>& words() const noexcept;
+
+		void push(bool valid);
+
+		void set(size_t index, bool valid);
+
+		void reserve(size_t size);
+
+		void append(const ValidityBitmap& other);
+
+		size_t memoryUsage() const noexcept;
+
+	private:
+		Array<uint64> m_bits;
+
+		size_t m_size = 0;
+
+		size_t m_nullCount = 0;
+	};
+
+	template <class Type>
+	class NumericColumn
+	{
+	public:
+		using value_type = Type;
+
+		size_t size() const noexcept { return m_values.size(); }
+
+		bool isNull(size_t row) const noexcept { return not m_validity.isValid(row); }
+
+		Type get(size_t row) const noexcept { return m_values[row]; }
+
+		const Array<Type>& values() const noexcept { return m_values; }
+
+		const ValidityBitmap& validity() const noexcept { return m_validity; }
+
+		void reserve(size_t size)
+		{
+			m_values.reserve(size);
+			m_validity.reserve(size);
+		}
+
+		void push(Type value)
+		{
+			m_values.push_back(value);
+			m_validity.push(true);
+		}
+
+		void pushNull()
+		{
+			m_values.push_back(Type{});
+			m_validity.push(false);
+		}
+
+		void set(size_t row, Type value)
+		{
+			m_values[row] = value;
+			m_validity.set(row, true);
+		}
+
+		void setNull(size_t row)
+		{
+			m_values[row] = Type{};
+			m_validity.set(row, false);
+		}
+
+		void append(const NumericColumn& other)
+		{
+			m_values.insert(m_values.end(), other.m_values.begin(), other.m_values.end());
+			m_validity.append(other.m_validity);
+		}
+
+		size_t memoryUsage() const noexcept
+		{
+			return (m_values.capacity() * sizeof(Type) + m_validity.memoryUsage());
+		}
+
+	private:
+		Array<Type> m_values;
+
+		ValidityBitmap m_validity;
+	};
+
+	using Int64Column = NumericColumn<int64>;
+
+	using DoubleColumn = NumericColumn<double>;
+
+	class BoolColumn
+	{
+	public:
+		using value_type = bool;
+
+		size_t size() const noexcept;
+
+		bool isNull(size_t row) const noexcept;
+
+		bool get(size_t row) const noexcept;
+
+		const ValidityBitmap& validity() const noexcept;
+
+		void reserve(size_t size);
+
+		void push(bool value);
+
+		void pushNull();
+
+		void set(size_t row, bool value);
+
+		void setNull(size_t row);
+
+		void append(const BoolColumn& other);
+
+		size_t memoryUsage() const noexcept;
+
+	private:
+		Array<uint64> m_bits;
+
+		size_t m_size = 0;
+
+		ValidityBitmap m_validity;
+	};
+
+	class DictionaryColumn
+	{
+	public:
+		using Code = uint32;
+
+		size_t size() const noexcept;
+
+		bool isNull(size_t row) const noexcept;
+
+		const String& get(size_t row) const noexcept;
+
+		Code getCode(size_t row) const noexcept;
+
+		const Array<Code>& codes() const noexcept;
+
+		const Array<String>& dictionary() const noexcept;
+
+		const ValidityBitmap& validity() const noexcept;
+
+		void reserve(size_t size);
+
+		void push(StringView value);
+
+		// 辞書に登録済みの符号をそのまま追加する
+		void pushCode(Code code);
+
+		void pushNull();
+
+		void set(size_t row, StringView value);
+
+		void setNull(size_t row);
+
+		void append(const DictionaryColumn& other);
+
+		size_t memoryUsage() const noexcept;
+
+	private:
+		Code encode(StringView value);
+
+		Array<Code> m_codes;
+
+		Array<String> m_dictionary;
+
+		HashTable<String, Code> m_lookup;
+
+		ValidityBitmap m_validity;
+	};
+
+	class StringColumn
+	{
+	public:
+		size_t size() const noexcept;
+
+		bool isNull(size_t row) const noexcept;
+
+		// UTF-8 のまま返す
+		std::string_view get(size_t row) const noexcept;
+
+		const ValidityBitmap& validity() const noexcept;
+
+		void reserve(size_t size, size_t bytes);
+
+		void push(std::string_view utf8);
+
+		void push(StringView value);
+
+		void pushNull();
+
+		// 末尾の行と同じ長さの値はその場で書き換え、それ以外は値を m_overflow に足すので O(値の長さ)
+		// m_overflow が大きくなったら、バッファを詰め直す
+		void set(size_t row, StringView value);
+
+		void setNull(size_t row);
+
+		void append(const StringColumn& other);
+
+		size_t memoryUsage() const noexcept;
+
+	private:
+		std::string m_blob;
+
+		// サイズは (行数+1) 、 m_offsets[0] = 0
+		Array<uint64> m_offsets{ 0 };
+
+		ValidityBitmap m_validity;
+
+		// set() で m_blob に収まらなかった値
+		std::string m_overflow;
+
+		// 値を m_overflow に移した行と、 m_overflow での値の範囲
+		HashTable<size_t, std::pair<uint64, uint64>> m_relocated;
+
+		// 値を m_overflow に移した行を 1 にする。 get() で m_relocated を引く前に確かめる
+		// 最後に値を移した時点の行数の分しか無い
+		Array<uint64> m_relocatedBits;
+
+		bool isRelocated(size_t row) const noexcept;
+
+		void unrelocate(size_t row);
+
+		// m_overflow の値を m_blob に戻し、行の順に詰め直す
+		void compact();
+	};
+
+	using Column = std::variant<Int64Column, DoubleColumn, BoolColumn, DictionaryColumn, StringColumn>;
+
+	ColumnType GetColumnType(const Column& column) noexcept;
+
+	size_t GetColumnSize(const Column& column) noexcept;
+
+	bool IsNull(const Column& column, size_t row) noexcept;
+
+	// セルの値を表示用の文字列にする。 null は空文字列
+	void FormatCell(const Column& column, size_t row, String& out);
+
+	// 型付きの列に入れる値を文字列から読む
+	// 読めても、 FormatCell で整形し直すと元の文字列に戻らない値（ "007", "+1", "1e3", "1.50", 20 桁の ID など）は none を返す
+	Optional<int64> ParseInt64(std::string_view text) noexcept;
+
+	Optional<int64> ParseInt64(StringView text) noexcept;
+
+	Optional<double> ParseDouble(std::string_view text) noexcept;
+
+	Optional<double> ParseDouble(StringView text) noexcept;
+
+	Optional<bool> ParseBool(std::string_view text) noexcept;
+
+	Optional<bool> ParseBool(StringView text) noexcept;
+
+	// 型付きの列に入れられない文字列の列は、異なる値がこの数以下なら辞書で符号化する
+	// CsvParser は塊ごとに異なる値を数えるので、列と塊の数だけ集合を持っても大きくならない値にする
+	inline constexpr size_t DictionaryLimit = 4096;
+
+	// 異なる値が distinctCount 種類ある rowCount 行の文字列の列を、辞書で符号化するか
+	// ColumnarStore::FromGrid と CsvParser は、どちらもこの規則で決める
+	constexpr bool UseDictionary(size_t distinctCount, size_t rowCount) noexcept
+	{
+		return ((distinctCount <= DictionaryLimit) && ((distinctCount * 2) <= rowCount));
+	}
+
+	// 列の値を順に渡して、表示を変えずに値を入れられる型付きの列を推定する
+	class ColumnTypeInference
+	{
+	public:
+		// 空の値は null になるので渡さない
+		void add(std::string_view text) noexcept;
+
+		void add(StringView text) noexcept;
+
+		// 同じ列の別の部分の推定結果を合わせる
+		void merge(const ColumnTypeInference& other) noexcept;
+
+		// Int64, Double, Bool の順に、全ての値を入れられる型。どれにも入れられなければ none
+		Optional<ColumnType> getType() const noexcept;
+
+	private:
+		bool m_isInt64 = true;
+
+		bool m_isDouble = true;
+
+		bool m_isBool = true;
+	};
+
+	// 型ごとの列に値を保持する ICellSource
+	// 表示用の文字列は fetch で表示中のセルの分だけ作る
+	class ColumnarStore : public ICellSource
+	{
+	public:
+		ColumnarStore() = default;
+
+		// 各列の値から型を推定して変換する
+		static ColumnarStore FromGrid(const Grid<String>& values);
+
+		size_t addColumn(const String& name, Column column);
+
+		size_t rowCount() const override;
+
+		size_t columnCount() const override;
+
+		uint64 version() const override;
+
+		void fetch(CellWindow& window) const override;
+
+		// 辞書で符号化した列のセルだけ、辞書の文字列を返す
+		Optional<StringView> view(size_t row, size_t column) const override;
+
+		// 列の型として解釈できない値は受け付けない。数値と真偽値の列では空文字列を null にする
+		bool setCell(size_t row, size_t column, StringView value) override;
+
+		const Column& column(size_t index) const;
+
+		// 書き換えた後は markModified() を呼ぶ
+		Column& column(size_t index);
+
+		ColumnType columnType(size_t index) const;
+
+		const Array<String>& columnNames() const noexcept;
+
+		void markModified();
+
+		size_t memoryUsage() const noexcept;
+
+	private:
+		Array<Column> m_columns;
+
+		Array<String> m_names;
+
+		size_t m_rowCount = 0;
+
+		uint64 m_version = 0;
+	};
+}
@@ -0,0 +1,86 @@
+﻿# pragma once
+# include "SimpleGridViewer/CellSource.hpp"
+# include "SimpleGridViewer/MappedFile.hpp"
+
+namespace SimpleGridViewer
+{
+	// メモリにマップした CSV / TSV ファイルを表示する ICellSource
+	// 行の先頭位置の索引はバックグラウンドのスレッドで作り、 rowCount() は索引が進むにつれて増える
+	// セルの文字列は fetch で表示中の行だけを解析して作る
+	class CsvFileSource : public ICellSource
+	{
+	public:
+		CsvFileSource() = default;
+
+		~CsvFileSource() override;
+
+		CsvFileSource(const CsvFileSource&) = delete;
+
+		CsvFileSource& operator=(const CsvFileSource&) = delete;
+
+		// 拡張子が .tsv / .tab ならタブ区切り、それ以外はカンマ区切りとして開く
+		bool open(FilePathView path);
+
+		// 最初の PublishRows 行の索引ができるか、 PublishBytes を読んだ時点で戻る。残りはバックグラウンドで続ける
+		bool open(FilePathView path, char delimiter);
+
+		void close();
+
+		bool isOpen() const noexcept;
+
+		bool isIndexing() const noexcept;
+
+		// 索引を作り終えたバイト数の割合 [0.0, 1.0]
+		double getIndexProgress() const noexcept;
+
+		char delimiter() const noexcept;
+
+		size_t rowCount() const override;
+
+		size_t columnCount() const override;
+
+		uint64 version() const override;
+
+		void fetch(CellWindow& window) const override;
+
+	private:
+		// 索引には Stride 行ごとの先頭位置だけを記録する
+		static constexpr size_t Stride = 32;
+
+		// この行数ごとに索引を公開する
+		static constexpr size_t PublishRows = 16384;
+
+		// 行の数に関わらず、このバイト数を読むごとにも公開し、止める要求を確かめる
+		static constexpr size_t PublishBytes = (4 << 20);
+
+		void buildIndex(std::stop_token stopToken);
+
+		size_t findRowStart(size_t row) const;
+
+		MappedFile m_file;
+
+		char m_delimiter = ',';
+
+		// UTF-8 の BOM を除いたデータの先頭
+		size_t m_dataStart = 0;
+
+		mutable std::mutex m_indexMutex;
+
+		// m_indexMutex で保護する
+		Array<uint64> m_checkpoints;
+
+		std::atomic<size_t> m_rowCount{ 0 };
+
+		std::atomic<size_t> m_columnCount{ 0 };
+
+		std::atomic<size_t> m_indexedBytes{ 0 };
+
+		std::atomic<bool> m_indexing{ false };
+
+		std::atomic<uint32> m_publishCount{ 0 };
+
+		uint64 m_version = 0;
+
+		std::jthread m_indexer;
+	};
+}
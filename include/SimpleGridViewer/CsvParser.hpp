@@ -0,0 +1,27 @@
+﻿# pragma once
+# include "SimpleGridViewer/ColumnarStore.hpp"
+
+namespace SimpleGridViewer
+{
+	// CSV / TSV 全体を解析して ColumnarStore を作る
+	// データを分割して全てのコアで並列に解析し、 Grid<String> を経由せずに各列のバッファへ書き込む
+	class CsvParser
+	{
+	public:
+		struct Options
+		{
+			char delimiter = ',';
+
+			// 1 行目を列の名前として扱う
+			bool header = false;
+
+			// 0 なら std::thread::hardware_concurrency()
+			size_t threadCount = 0;
+		};
+
+		static ColumnarStore Parse(std::string_view data, const Options& options);
+
+		// 失敗した場合は none
+		static Optional<ColumnarStore> Load(FilePathView path, const Options& options);
+	};
+}
@@ -0,0 +1,92 @@
+﻿# pragma once
+
+namespace SimpleGridViewer
+{
+	// CSV を 1 バイトずつ渡して、フィールドと行の区切りを見つける
+	// 引用符はフィールドの先頭にある場合だけ引用の始まりとし、引用の中の "" は引用符 1 つとして扱う
+	// フィールドの途中にある引用符はただの文字として読む
+	// CsvFileSource の索引と CsvParser の分割は、どちらもこの規則で行の区切りを決める
+	class CsvRowScanner
+	{
+	public:
+		enum class Token
+		{
+			None,
+
+			Delimiter,
+
+			EndOfRow,
+		};
+
+		enum class State : uint8
+		{
+			FieldStart,
+
+			Unquoted,
+
+			Quoted,
+
+			// 引用の中で引用符を 1 つ読んだところ。次も引用符なら "" 、それ以外なら引用の終わり
+			QuoteInQuoted,
+		};
+
+		static constexpr size_t StateCount = 4;
+
+		explicit CsvRowScanner(char delimiter, State state = State::FieldStart) noexcept
+			: m_delimiter{ delimiter }
+			, m_state{ state } {}
+
+		Token next(char c) noexcept
+		{
+			switch (m_state)
+			{
+			case State::Quoted:
+				if (c == '"')
+				{
+					m_state = State::QuoteInQuoted;
+				}
+				return Token::None;
+			case State::QuoteInQuoted:
+				if (c == '"')
+				{
+					m_state = State::Quoted;
+					return Token::None;
+				}
+				break;
+			case State::FieldStart:
+				if (c == '"')
+				{
+					m_state = State::Quoted;
+					return Token::None;
+				}
+				break;
+			case State::Unquoted:
+				break;
+			}
+
+			// 引用の外。閉じる引用符の後ろの余計な文字もここで読み飛ばす
+			if (c == m_delimiter)
+			{
+				m_state = State::FieldStart;
+				return Token::Delimiter;
+			}
+			if (c == '\n')
+			{
+				m_state = State::FieldStart;
+				return Token::EndOfRow;
+			}
+			m_state = State::Unquoted;
+			return Token::None;
+		}
+
+		State state() const noexcept
+		{
+			return m_state;
+		}
+
+	private:
+		char m_delimiter;
+
+		State m_state;
+	};
+}
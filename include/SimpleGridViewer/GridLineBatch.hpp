@@ -0,0 +1,32 @@
+﻿# pragma once
+
+namespace SimpleGridViewer
+{
+	// 格子の線を 1 つの頂点配列に積んで、まとめて 1 回で描く
+	// 線は太さ 1 ピクセルの矩形とし、三角形 2 つで表す
+	// 頂点配列は Buffer2D に直接積み、描くときに写さない
+	class GridLineBatch
+	{
+	public:
+		// 積んだ線を捨てる。確保済みの領域は次のフレームで再利用する
+		void clear();
+
+		// x の位置に [top, bottom) の縦線を積む
+		void addVertical(int32 x, int32 top, int32 bottom);
+
+		// y の位置に [left, right) の横線を積む
+		void addHorizontal(int32 y, int32 left, int32 right);
+
+		size_t lineCount() const noexcept;
+
+		void draw(const ColorF& color);
+
+	private:
+		void addRect(float x, float y, float w, float h);
+
+		Buffer2D m_buffer;
+
+		// 頂点に書き込んである色。 clear() しても引き継ぎ、違う色で描くときだけ書き換える
+		ColorF m_color = Palette::Black;
+	};
+}
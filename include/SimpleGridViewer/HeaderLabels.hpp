@@ -0,0 +1,54 @@
+﻿# pragma once
+
+namespace SimpleGridViewer
+{
+	// 見出しの文字列を書き込むバッファ
+	// size_t の最大値は 10 進で 20 桁、 A1 形式で 14 文字なので収まる
+	using LabelBuffer = std::array<char32, 32>;
+
+	// index 番目の見出しを buffer に書き込んで、書き込んだ範囲を返す
+	// buffer 以外を指す StringView を返してもよいが、次に呼ばれるまで有効でなければならない
+	using LabelGenerator = std::function<StringView(size_t index, LabelBuffer& buffer)>;
+
+	// 行や列の見出し
+	// 全ての見出しを文字列として持たず、表示する分だけをその場で作る。名前を変えた見出しだけを別に持つ
+	// 先頭からまとめて設定した名前は配列に、それ以外の位置の名前はハッシュテーブルに持つ
+	class HeaderLabels
+	{
+	public:
+		// 0, 1, 2, ...
+		static StringView Number(size_t index, LabelBuffer& buffer) noexcept;
+
+		// A, B, ..., Z, AA, AB, ...
+		static StringView Alphabet(size_t index, LabelBuffer& buffer) noexcept;
+
+		HeaderLabels() = default;
+
+		explicit HeaderLabels(LabelGenerator generator);
+
+		void setGenerator(LabelGenerator generator);
+
+		// [0, labels.size()) 番目の見出しを labels にして、それ以外の見出しを元に戻す
+		void setLabels(Array<String> labels);
+
+		// index 番目の見出しだけを label にする
+		void setLabel(size_t index, const String& label);
+
+		void resetLabel(size_t index);
+
+		// setLabel で変えた見出しを全て元に戻す
+		void resetLabels();
+
+		// 返す StringView は buffer か、 setLabel で設定した文字列を指す
+		StringView get(size_t index, LabelBuffer& buffer) const;
+
+	private:
+		LabelGenerator m_generator = Number;
+
+		// setLabels で設定した見出し。 resetLabel で戻した位置は none
+		Array<Optional<String>> m_denseLabels;
+
+		// m_denseLabels の範囲外の見出し
+		HashTable<size_t, String> m_labels;
+	};
+}
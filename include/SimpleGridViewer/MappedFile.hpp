@@ -0,0 +1,53 @@
+﻿# pragma once
+
+namespace SimpleGridViewer
+{
+	// 読み込み専用でメモリにマップしたファイル
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+
+		explicit MappedFile(FilePathView path);
+
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// 失敗した場合は false を返す。大きさ 0 のファイルは開けるが data() は nullptr
+		bool open(FilePathView path);
+
+		void close();
+
+		bool isOpen() const noexcept;
+
+		explicit operator bool() const noexcept;
+
+		const char* data() const noexcept;
+
+		size_t size() const noexcept;
+
+		std::string_view view() const noexcept;
+
+	private:
+		const char* m_data = nullptr;
+
+		size_t m_size = 0;
+
+		bool m_isOpen = false;
+
+	# if SIV3D_PLATFORM(WINDOWS)
+
+		void* m_file = nullptr;
+
+		void* m_mapping = nullptr;
+
+	# else
+
+		int m_fd = -1;
+
+	# endif
+	};
+}
@@ -0,0 +1,75 @@
+﻿# pragma once
+
+// 使える SIMD 命令。 AVX2 は /arch:AVX2 などで有効にした場合だけ使い、 x64 では少なくとも SSE2 を使う
+# if defined(__AVX2__)
+#	include <immintrin.h>
+#	define SIMPLEGRIDVIEWER_AVX2 1
+# elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#	include <emmintrin.h>
+#	define SIMPLEGRIDVIEWER_SSE2 1
+# endif
+
+namespace SimpleGridViewer
+{
+	// 行ごとのビット列の 1 語のビット数
+	inline constexpr size_t WordBits = 64;
+
+	// 汎用の供給元から 1 度に問い合わせる行数。 WordBits の倍数にする
+	inline constexpr size_t FetchRows = 4096;
+
+	// 1 つのスレッドに任せる最小の行数
+	inline constexpr size_t MinChunkRows = (1 << 14);
+
+	// 1 つのスレッドに任せる最小の語数
+	inline constexpr size_t MinChunkWords = (MinChunkRows / WordBits);
+
+	// threadCount が 0 なら std::thread::hardware_concurrency() を返す
+	inline size_t GetThreadCount(size_t threadCount = 0)
+	{
+		return Max<size_t>(1, (threadCount ? threadCount : std::thread::hardware_concurrency()));
+	}
+
+	// [0, count) の各 i について function(i) を最大 threadCount 個のスレッドで分担して呼ぶ
+	// 呼び出したスレッドも処理に加わり、全て終わってから戻る
+	template <class Function>
+	void ParallelFor(size_t count, size_t threadCount, Function function)
+	{
+		std::atomic<size_t> next{ 0 };
+		const auto worker = [&]()
+		{
+			for (size_t i; (i = next++) < count;)
+			{
+				function(i);
+			}
+		};
+
+		Array<std::jthread> threads;
+		for (size_t i = 1; i < Min(threadCount, count); ++i)
+		{
+			threads.emplace_back(worker);
+		}
+		worker();
+	}
+
+	// [0, rowCount) 行を MinChunkRows 行以上ずつの塊に分け、 function(first, last) を並列に呼ぶ
+	template <class Function>
+	void ParallelForRows(size_t rowCount, size_t threadCount, Function function)
+	{
+		const size_t chunkCount = Clamp<size_t>((rowCount / MinChunkRows), 1, threadCount);
+		ParallelFor(chunkCount, threadCount, [&](size_t i)
+		{
+			function((rowCount * i / chunkCount), (rowCount * (i + 1) / chunkCount));
+		});
+	}
+
+	// [0, wordCount) 語を MinChunkWords 語以上ずつの塊に分け、 function(firstWord, lastWord) を並列に呼ぶ
+	template <class Function>
+	void ParallelForWords(size_t wordCount, size_t threadCount, Function function)
+	{
+		const size_t chunkCount = Clamp<size_t>((wordCount / MinChunkWords), 1, threadCount);
+		ParallelFor(chunkCount, threadCount, [&](size_t i)
+		{
+			function((wordCount * i / chunkCount), (wordCount * (i + 1) / chunkCount));
+		});
+	}
+}
@@ -0,0 +1,66 @@
+﻿# pragma once
+
+namespace SimpleGridViewer
+{
+	// 1 つのセルの書き換え
+	struct CellPatch
+	{
+		size_t row = 0;
+
+		size_t column = 0;
+
+		String value;
+	};
+
+	// 1 行の書き換え。 row が none なら末尾に追加する
+	struct RowPatch
+	{
+		Optional<size_t> row;
+
+		Array<String> values;
+	};
+
+	using Patch = std::variant<CellPatch, RowPatch>;
+
+	// 複数のスレッドから書き換えを受け取り、 1 つのスレッドで取り出すキュー
+	// push はロックを取らず、 atomic の exchange 1 回で終わる
+	class PatchQueue
+	{
+	public:
+		PatchQueue();
+
+		~PatchQueue();
+
+		PatchQueue(const PatchQueue&) = delete;
+
+		PatchQueue& operator=(const PatchQueue&) = delete;
+
+		// どのスレッドからでも呼べる
+		void push(Patch patch);
+
+		// まとめて 1 回で追加する。件数が多い場合はこちらの方が速い
+		void push(Array<Patch> patches);
+
+		// 取り出す側のスレッドだけが呼べる
+		// 次のまとまりを patches に移して true を返す。空なら false
+		bool pop(Array<Patch>& patches);
+
+		// 取り出す側のスレッドだけが呼べる
+		// 取り出せるまとまりが無ければ true
+		bool isEmpty() const noexcept;
+
+	private:
+		struct Node
+		{
+			std::atomic<Node*> next{ nullptr };
+
+			Array<Patch> patches;
+		};
+
+		// 最後に追加されたノード。追加する側が書き換える
+		alignas(64) std::atomic<Node*> m_head;
+
+		// 取り出し済みのノード。取り出す側だけが書き換える
+		alignas(64) Node* m_tail;
+	};
+}
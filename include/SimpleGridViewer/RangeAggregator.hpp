@@ -0,0 +1,121 @@
+﻿# pragma once
+# include "SimpleGridViewer/RowViewSource.hpp"
+# include "SimpleGridViewer/BackgroundTask.hpp"
+
+namespace SimpleGridViewer
+{
+	// 範囲の数値の集計。数値として解釈できないセルと空のセルは数えない
+	struct RangeSummary
+	{
+		size_t count = 0;
+
+		double sum = 0.0;
+
+		double min = std::numeric_limits<double>::infinity();
+
+		double max = -std::numeric_limits<double>::infinity();
+
+		void add(double value) noexcept;
+
+		void merge(const RangeSummary& other) noexcept;
+
+		// 数値が無ければ 0
+		double mean() const noexcept;
+	};
+
+	// 1 列分の数値の区間木
+	// 64 行ごとのブロックを葉にして、範囲の両端の端数のブロックは値を直接集計する
+	// 葉の数は 2 の累乗にしておき、末尾への追加で足りなくなったときだけ倍に広げる
+	class ColumnSegmentTree
+	{
+	public:
+		static constexpr size_t BlockSize = 64;
+
+		ColumnSegmentTree() = default;
+
+		// 数値でないセルは NaN
+		explicit ColumnSegmentTree(Array<double> values);
+
+		size_t size() const noexcept;
+
+		void set(size_t row, double value);
+
+		// 末尾に values を加える。増えたブロックとその親だけを作り直す
+		void append(std::span<const double> values);
+
+		// [first, last) 行の集計
+		RangeSummary query(size_t first, size_t last) const;
+
+	private:
+		// 葉の数を leafCount に広げる。作成済みのブロックの集計はそのまま移す
+		void grow(size_t leafCount);
+
+		void updateBlock(size_t block);
+
+		// firstBlock 以降のブロックと、その親を作り直す。葉が足りなければ先に広げる
+		void updateBlocksFrom(size_t firstBlock);
+
+		RangeSummary summarize(size_t first, size_t last) const noexcept;
+
+		Array<double> m_values;
+
+		size_t m_leafCount = 0;
+
+		// m_nodes[1] が根、 m_nodes[m_leafCount + i] が i 番目のブロック
+		Array<RangeSummary> m_nodes;
+	};
+
+	// 範囲選択した領域の数値を、列ごとの区間木で集計する
+	// 区間木は表示上の行の順に並べ、集計を求められた列の分だけ別のスレッドで作る
+	// 行が増えた場合は、増えた行だけを読んで作成済みの区間木に加える
+	// 並び順が変わった場合は clear() で全て捨てる
+	class RangeAggregator
+	{
+	public:
+		// これ以下のセル数の範囲は、区間木を作らずにその場で読んで集計する
+		static constexpr uint64 DirectCellCount = 4096;
+
+		// 区間木を作っているスレッドも止める
+		void clear();
+
+		// [firstColumn, lastColumn) の列の区間木を捨てる
+		void invalidate(size_t firstColumn, size_t lastColumn);
+
+		// 区間木を作っているスレッドを止める。供給元を書き換える前に呼ぶ
+		void cancel();
+
+		bool isBusy() const noexcept;
+
+		// 表示上の row 行目のセルを読み直して、作成済みの区間木に反映する
+		void updateCell(const RowViewSource& view, size_t row, size_t column);
+
+		// rows × columns の範囲を集計する
+		// 広い範囲は区間木で集計し、区間木の無い列がある場合や、区間木に加える前の行が多い場合は none
+		Optional<RangeSummary> query(const RowViewSource& view, const IndexRange& rows, const IndexRange& columns);
+
+		// columns の列の区間木を別のスレッドで作るか、増えた行を読んで伸ばす
+		// 同じ列を作っている間は始め直さない
+		void build(const RowViewSource& view, const IndexRange& columns);
+
+	private:
+		// 別のスレッドで読んだ 1 列分の値。 firstRow が 0 なら tree を、そうでなければ values を使う
+		struct ColumnValues
+		{
+			size_t column = 0;
+
+			size_t firstRow = 0;
+
+			Array<double> values;
+
+			ColumnSegmentTree tree;
+		};
+
+		void applyBuildResult();
+
+		HashTable<size_t, ColumnSegmentTree> m_columns;
+
+		IndexRange m_buildColumns;
+
+		BackgroundTask<Array<ColumnValues>> m_builder;
+	};
+}
@@ -0,0 +1,155 @@
+﻿# pragma once
+# include "SimpleGridViewer/CellSource.hpp"
+# include "SimpleGridViewer/BackgroundTask.hpp"
+
+namespace SimpleGridViewer
+{
+	// 行ごとに 1 ビットを持つビット列
+	class RowBitmap
+	{
+	public:
+		RowBitmap() = default;
+
+		RowBitmap(size_t size, bool value);
+
+		size_t size() const noexcept;
+
+		// 立っているビットの数
+		size_t count() const noexcept;
+
+		bool test(size_t row) const noexcept;
+
+		void set(size_t row, bool value) noexcept;
+
+		// 64 行ごとの語。 size() を超える位置のビットは常に 0
+		Array<uint64>& words() noexcept;
+
+		const Array<uint64>& words() const noexcept;
+
+		// 先頭の count 行を取り除き、残りの行を前に詰める
+		void eraseLeading(size_t count) noexcept;
+
+		// 行数を変える。増えた行のビットは 0
+		void resize(size_t size);
+
+		// tested のビットが立っている行を passed の値で置き換え、行数を passed.size() に伸ばす
+		// 前からあった行の値が変わった場合は true
+		bool replace(const RowBitmap& tested, const RowBitmap& passed);
+
+		// ビットが立っている行を昇順に並べる
+		Array<size_t> toRows() const;
+
+		// order の順のまま、ビットが立っている行だけを残す
+		Array<size_t> select(const Array<size_t>& order) const;
+
+	private:
+		Array<uint64> m_words;
+
+		size_t m_size = 0;
+	};
+
+	// 1 つの列に対する絞り込みの条件
+	// Equals / Contains / Regex は表示する文字列に対して判定する
+	struct FilterCondition
+	{
+		enum class Kind : uint8
+		{
+			Equals,
+			Contains,
+			// 数値として読めて、 [min, max] に収まる
+			Range,
+			// 正規表現にマッチする部分がある。正しくない正規表現はどの行にもマッチしない
+			Regex,
+		};
+
+		Kind kind = Kind::Equals;
+
+		size_t column = 0;
+
+		String text;
+
+		// none なら下限・上限なし
+		Optional<double> min;
+
+		Optional<double> max;
+
+		bool operator==(const FilterCondition&) const = default;
+
+		// この条件を満たす行が、必ず other も満たすか
+		bool implies(const FilterCondition& other) const;
+
+		static FilterCondition Equals(size_t column, StringView text);
+
+		static FilterCondition Contains(size_t column, StringView text);
+
+		static FilterCondition Range(size_t column, const Optional<double>& min, const Optional<double>& max);
+
+		static FilterCondition Regex(size_t column, StringView pattern);
+	};
+
+	// 全ての条件を満たす行を求める
+	// 条件は列ごとに、行を塊に分けて並列に判定する。数値の範囲は SIMD で 64 行ずつまとめて比べる
+	class RowFilter
+	{
+	public:
+		// startPartial() の結果
+		struct PartialResult
+		{
+			// 調べた行のビットが立っている。大きさは調べ始めたときの行数
+			RowBitmap tested;
+
+			// 調べた行のうち、全ての条件を満たす行のビットが立っている
+			RowBitmap passed;
+		};
+
+		RowFilter() = default;
+
+		RowFilter(const RowFilter&) = delete;
+
+		RowFilter& operator=(const RowFilter&) = delete;
+
+		// 別のスレッドで判定を始める。前回の判定が終わっていなければ中断する
+		// 前回の結果から条件を狭めただけの場合は、前回残った行だけを調べ直す
+		void start(std::shared_ptr<const ICellSource> source, Array<FilterCondition> conditions, size_t threadCount = 0);
+
+		// rows のビットが立っている行だけを別のスレッドで判定する。前回の部分的な判定が終わっていなければ中断する
+		// 行が増えたときや行を書き換えたときに、全ての行を判定し直さずに済ませる
+		void startPartial(std::shared_ptr<const ICellSource> source, Array<FilterCondition> conditions, RowBitmap rows, size_t threadCount = 0);
+
+		// 判定を中断し、スレッドが終わるのを待つ
+		void cancel();
+
+		// 前回の結果を忘れる。次の start() では全ての行を調べる
+		void reset();
+
+		bool isBusy() const noexcept;
+
+		// 判定が終わっていれば結果を返す。同じ結果は 1 度だけ返す
+		std::shared_ptr<const RowBitmap> takeResult();
+
+		Optional<PartialResult> takePartialResult();
+
+		// 呼び出したスレッドで判定する。 base を渡した場合は、そのビットが立っている行だけを調べる
+		// threadCount が 0 なら全てのコアを使う。中断された場合は none
+		static Optional<RowBitmap> Evaluate(const ICellSource& source, const Array<FilterCondition>& conditions, const RowBitmap* base = nullptr, size_t threadCount = 0, std::stop_token stopToken = {});
+
+	private:
+		struct Snapshot
+		{
+			std::shared_ptr<const RowBitmap> bitmap;
+
+			Array<FilterCondition> conditions;
+
+			std::weak_ptr<const ICellSource> source;
+
+			uint64 version = 0;
+		};
+
+		// 最後に受け取った結果。条件を狭めた場合の出発点にする
+		Snapshot m_last;
+
+		BackgroundTask<Snapshot> m_task;
+
+		BackgroundTask<PartialResult> m_partialTask;
+	};
+}
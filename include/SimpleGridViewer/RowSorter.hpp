@@ -0,0 +1,48 @@
+﻿# pragma once
+# include "SimpleGridViewer/CellSource.hpp"
+# include "SimpleGridViewer/BackgroundTask.hpp"
+
+namespace SimpleGridViewer
+{
+	// 並べ替えに使う列と向き
+	struct SortKey
+	{
+		size_t column = 0;
+
+		bool ascending = true;
+
+		bool operator==(const SortKey&) const = default;
+	};
+
+	// 行の並び順を求める
+	// データは動かさず、 rows[表示上の行] = 元の行 となる対応表を作る
+	// 各キーの列は最初に 1 度だけ比べやすい形で取り出し、数値は基数ソート、文字列は並列の安定なマージソートで並べる
+	// 空のセルは向きによらず末尾に置く
+	class RowSorter
+	{
+	public:
+		RowSorter() = default;
+
+		RowSorter(const RowSorter&) = delete;
+
+		RowSorter& operator=(const RowSorter&) = delete;
+
+		// 別のスレッドで並べ替えを始める。前回の並べ替えが終わっていなければ中断する
+		void start(std::shared_ptr<const ICellSource> source, Array<SortKey> keys, size_t threadCount = 0);
+
+		// 並べ替えを中断し、スレッドが終わるのを待つ
+		void cancel();
+
+		bool isBusy() const noexcept;
+
+		// 並べ替えが終わっていれば結果を返す。同じ結果は 1 度だけ返す
+		Optional<Array<size_t>> takeResult();
+
+		// 呼び出したスレッドで並べ替える。 keys は前にあるものほど優先する
+		// threadCount が 0 なら全てのコアを使う。中断された場合は none
+		static Optional<Array<size_t>> Sort(const ICellSource& source, const Array<SortKey>& keys, size_t threadCount = 0, std::stop_token stopToken = {});
+
+	private:
+		BackgroundTask<Array<size_t>> m_task;
+	};
+}
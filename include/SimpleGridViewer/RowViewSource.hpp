@@ -0,0 +1,70 @@
+﻿# pragma once
+# include "SimpleGridViewer/CellSource.hpp"
+
+namespace SimpleGridViewer
+{
+	// 元の供給元の行を並べ替えたり間引いたりして見せる ICellSource
+	// 元のデータは動かさず、表示上の行から元の行への対応表だけを持つ
+	class RowViewSource : public ICellSource
+	{
+	public:
+		explicit RowViewSource(std::shared_ptr<ICellSource> source);
+
+		const std::shared_ptr<ICellSource>& source() const noexcept;
+
+		// rows[表示上の行] = 元の行。 rows は元の [0, sourceRowCount) 行から作ったもの
+		// sourceRowCount 以降の元の行は、 showAppended なら末尾にそのままの順で並べ、そうでなければ appendRows() で加えるまで表示しない
+		void setRows(Array<size_t> rows, size_t sourceRowCount, bool showAppended = true);
+
+		// 元の行 [これまでの sourceRowCount, sourceRowCount) のうち、 rows だけを末尾に加える
+		// rows は昇順に並べておく
+		void appendRows(std::span<const size_t> rows, size_t sourceRowCount);
+
+		// 元の順に戻す
+		void resetRows();
+
+		bool hasRows() const noexcept;
+
+		// 元の行数を超える場合は、元の行数以上の値を返す
+		size_t toSourceRow(size_t row) const noexcept;
+
+		// 元の行が表示されている位置。間引かれている場合は none
+		// 並べ替えた後に初めて呼んだときに、逆向きの対応表を作る
+		Optional<size_t> toDisplayRow(size_t sourceRow) const;
+
+		size_t rowCount() const override;
+
+		size_t columnCount() const override;
+
+		uint64 version() const override;
+
+		void fetch(CellWindow& window) const override;
+
+		Optional<StringView> view(size_t row, size_t column) const override;
+
+		bool setCell(size_t row, size_t column, StringView value) override;
+
+		bool appendRow(std::span<const String> values) override;
+
+	private:
+		std::shared_ptr<ICellSource> m_source;
+
+		Array<size_t> m_rows;
+
+		bool m_hasRows = false;
+
+		bool m_showAppended = true;
+
+		// 対応表が扱っている元の行数
+		size_t m_sourceRowCount = 0;
+
+		// 対応表を変えるたびに増やす。元の供給元の version() との和を version() とする
+		uint64 m_version = 0;
+
+		// 連続する元の行をまとめて問い合わせるためのバッファ
+		mutable CellWindow m_buffer;
+
+		// m_rows の逆向きの対応表。必要になるまで作らない
+		mutable Array<size_t> m_displayRows;
+	};
+}
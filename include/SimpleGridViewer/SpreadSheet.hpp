@@ -1,113 +1,327 @@
-﻿# pragma once
-# include "gridcell/CellGrid.hpp"
-# include "SasaGUI/SasaGUI.hpp"
-
-namespace SimpleGridViewer
-{
-	namespace Config
-	{
-		struct SheetHeader
-		{
-			inline constexpr static int32 Height = 20;
-			inline constexpr static ColorF BackgroundColor = Palette::Lightgray;
-			inline constexpr static ColorF TextColor = Palette::Black;
-			inline constexpr static ColorF HoveredColor{ 0.9, 0.9, 0.9, 0.5 };
-			inline constexpr static ColorF SelectedColor{ 1.0, 0.0, 0.0, 1.0 };
-		};
-
-		struct SheetRow
-		{
-			inline constexpr static int32 Width = 60;
-			inline constexpr static ColorF BackgroundColor = Palette::Lightgray;
-			inline constexpr static ColorF TextColor = Palette::Black;
-			inline constexpr static ColorF HoveredColor{ 0.9, 0.9, 0.9, 0.5 };
-			inline constexpr static ColorF SelectedColor{ 1.0, 0.0, 0.0, 1.0 };
-		};
-
-		struct Cell
-		{
-			inline constexpr static int32 Height = 20;
-			inline constexpr static int32 Width = 80;
-			inline constexpr static ColorF BackgroundColor = Palette::White;
-			inline constexpr static ColorF HoveredColor{ 0.9, 0.9, 0.9, 0.5 };
-			inline constexpr static ColorF SelectedColor{ 1.0, 0.0, 0.0, 1.0 };
-			inline constexpr static ColorF TextColor = Palette::Black;
-		};
-
-		struct Grid
-		{
-			inline constexpr static ColorF Color{ 0.11 };
-		};
-
-		struct Font
-		{
-			inline constexpr static int32 IndexSize = 15;
-			inline constexpr static int32 TextSize = 15;
-		};
-	};
-
-	class AlphabetUtility
-	{
-	public:
-		static String ToAlphabet(size_t index);
-		static Array<String> GenerateAlphabetArray(size_t index);
-	};
-
-	class SpreadSheet
-	{
-	public:
-		SpreadSheet(const Size& sheetSize, const Size& visibleCellSize, const Point& viewPoint);
-		void setValues(const Grid<String>& values);
-		Optional<String> getValue(size_t row, size_t column) const;
-		void setIndexFont(const Font& font);
-		void setTextFont(const Font& font);
-		void setRowNames(const Array<String>& rowNames);
-		void setColumnNames(const Array<String>& columnNames);
-		SizeF getAreaSize() const noexcept;
-		Optional<Point> getHoveredCell() const noexcept;
-		Optional<Point> getSelectedCell() const noexcept;
-		Optional<size_t> getSelectedRow() const noexcept;
-		Optional<size_t> getSelectedColumn() const noexcept;
-		void update();
-		void draw() const;
-	private:
-		void initialize(const Size& sheetSize, const Size& visibleCellSize, const Point& viewPoint);
-		void updateScrollBar();
-		void updateVisibleColumns();
-		void updateVisibleRows();
-		void updateCells();
-		void updateSelectedRow();
-		void updateSelectedColumn();
-		size_t getVisibleRowCount() const;
-		size_t getVisibleColumnCount() const;
-		bool isCellVisible(size_t row, size_t column) const;
-		void drawSheetHeader() const;
-		void drawSheetRows() const;
-		void drawCells() const;
-		void drawSelectedRow() const;
-		void drawSelectedColumn() const;
-		void drawGridLines() const;
-		Array<int32> m_rowHeights;
-		Array<int32> m_columnWidths;
-		Grid<String> m_values;
-		RectF m_viewArea;
-		RectF m_sheetArea;
-		SasaGUI::ScrollBar m_verticalScrollBar{ SasaGUI::Orientation::Vertical };
-		SasaGUI::ScrollBar m_horizontalScrollBar{ SasaGUI::Orientation::Horizontal };
-		size_t m_firstVisibleRow = 0;
-		size_t m_firstVisibleColumn = 0;
-		size_t m_lastVisibleRow;
-		size_t m_lastVisibleColumn;
-		CellGrid m_cellGrid;
-		Array<String> m_rowNames;
-		Array<String> m_columnNames;
-		Font m_indexFont;
-		Font m_textFont;
-		Optional<Point> m_hoveredCell;
-		Optional<Point> m_selectedCell;
-		Optional<size_t> m_hoveredRow;
-		Optional<size_t> m_hoveredColumn;
-		Optional<size_t> m_selectedRow;
-		Optional<size_t> m_selectedColumn;
-	};
-}
+﻿# pragma once
+# include "gridcell/CellGrid.hpp"
+# include "SasaGUI/SasaGUI.hpp"
+# include "SimpleGridViewer/TextLayoutCache.hpp"
+# include "SimpleGridViewer/CellSource.hpp"
+# include "SimpleGridViewer/CellFinder.hpp"
+# include "SimpleGridViewer/ColumnStats.hpp"
+# include "SimpleGridViewer/GridLineBatch.hpp"
+# include "SimpleGridViewer/HeaderLabels.hpp"
+# include "SimpleGridViewer/PatchQueue.hpp"
+# include "SimpleGridViewer/RangeAggregator.hpp"
+# include "SimpleGridViewer/RowFilter.hpp"
+# include "SimpleGridViewer/RowSorter.hpp"
+# include "SimpleGridViewer/RowViewSource.hpp"
+# include "SimpleGridViewer/TileRenderCache.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace Config
+	{
+		struct SheetHeader
+		{
+			inline constexpr static int32 Height = 20;
+			inline constexpr static ColorF BackgroundColor = Palette::Lightgray;
+			inline constexpr static ColorF TextColor = Palette::Black;
+			inline constexpr static ColorF HoveredColor{ 0.9, 0.9, 0.9, 0.5 };
+			inline constexpr static ColorF SelectedColor{ 1.0, 0.0, 0.0, 1.0 };
+			inline constexpr static ColorF SortIndicatorColor{ 0.3 };
+			// 並べ替えていない列の、並べ替えのボタンの三角形
+			inline constexpr static ColorF SortButtonColor{ 0.3, 0.2 };
+			// 見出しの右端の、クリックすると並べ替える部分の幅
+			inline constexpr static int32 SortButtonWidth = 16;
+		};
+
+		struct SheetRow
+		{
+			inline constexpr static int32 Width = 60;
+			inline constexpr static ColorF BackgroundColor = Palette::Lightgray;
+			inline constexpr static ColorF TextColor = Palette::Black;
+			inline constexpr static ColorF HoveredColor{ 0.9, 0.9, 0.9, 0.5 };
+			inline constexpr static ColorF SelectedColor{ 1.0, 0.0, 0.0, 1.0 };
+		};
+
+		struct Cell
+		{
+			inline constexpr static int32 Height = 20;
+			inline constexpr static int32 Width = 80;
+			inline constexpr static ColorF BackgroundColor = Palette::White;
+			inline constexpr static ColorF HoveredColor{ 0.9, 0.9, 0.9, 0.5 };
+			inline constexpr static ColorF SelectedColor{ 1.0, 0.0, 0.0, 1.0 };
+			inline constexpr static ColorF TextColor = Palette::Black;
+			// 文字の上に重ねるので、文字が読める程度に薄くする
+			inline constexpr static ColorF FoundColor{ 1.0, 0.85, 0.2, 0.4 };
+			inline constexpr static ColorF RangeColor{ 0.2, 0.45, 1.0, 0.2 };
+		};
+
+		struct Grid
+		{
+			inline constexpr static ColorF Color{ 0.11 };
+		};
+
+		struct Font
+		{
+			inline constexpr static int32 IndexSize = 15;
+			inline constexpr static int32 TextSize = 15;
+		};
+	};
+
+	class AlphabetUtility
+	{
+	public:
+		static String ToAlphabet(size_t index);
+
+		// 0 から index までの index + 1 個を返す
+		static Array<String> GenerateAlphabetArray(size_t index);
+	};
+
+	class SpreadSheet
+	{
+	public:
+		SpreadSheet(const Size& sheetSize, const Size& visibleCellSize, const Point& viewPoint);
+		void setValues(const Grid<String>& values);
+		void setValues(Grid<String>&& values);
+		void setRegion(const Point& topLeft, const Grid<String>& values);
+		void setSource(std::shared_ptr<ICellSource> source);
+		const std::shared_ptr<ICellSource>& getSource() const noexcept;
+		Optional<String> getValue(size_t row, size_t column) const;
+		Optional<StringView> getValueView(size_t row, size_t column) const;
+		void setIndexFont(const Font& font);
+		void setTextFont(const Font& font);
+		void setRowNames(const Array<String>& rowNames);
+		void setColumnNames(const Array<String>& columnNames);
+		void setRowName(size_t row, const String& name);
+		void setColumnName(size_t column, const String& name);
+		void setRowLabelGenerator(LabelGenerator generator);
+		void setColumnLabelGenerator(LabelGenerator generator);
+		SizeF getAreaSize() const noexcept;
+		Optional<Point> getHoveredCell() const noexcept;
+		Optional<Point> getSelectedCell() const noexcept;
+		Optional<Rect> getSelectedRange() const noexcept;
+		const Optional<RangeSummary>& getSelectedRangeSummary() const noexcept;
+		Optional<size_t> getSelectedRow() const noexcept;
+		Optional<size_t> getSelectedColumn() const noexcept;
+		const TextLayoutCache& getTextLayoutCache() const noexcept;
+		void setFollowTail(bool followTail);
+		bool isFollowingTail() const noexcept;
+		const std::shared_ptr<PatchQueue>& getPatchQueue() const noexcept;
+		void setPatchTimeBudget(const Duration& budget);
+		void setSortKeys(const Array<SortKey>& keys);
+		const Array<SortKey>& getSortKeys() const noexcept;
+		bool isSorting() const noexcept;
+		void setFilters(const Array<FilterCondition>& filters);
+		const Array<FilterCondition>& getFilters() const noexcept;
+		bool isFiltering() const noexcept;
+		void find(StringView query);
+		bool findNext();
+		bool findPrevious();
+		const CellFinder& getFinder() const noexcept;
+		// 内容が変わった後も、集計し直すまでは前の統計を返す
+		Optional<ColumnStats> getSelectedColumnStats() const;
+		bool isComputingColumnStats() const noexcept;
+		// 前回の draw() から表示が変わっていれば true
+		bool needsRedraw() const;
+		// 並べ替えや絞り込み、検索、集計、書き換えの反映のどれかが終わっていなければ true
+		bool hasBackgroundWork() const;
+		// 有効にすると、表示が変わらない間は前回描いたシートのテクスチャをそのまま使う
+		void setFrameCacheEnabled(bool enabled);
+		bool isFrameCacheEnabled() const noexcept;
+		// 有効にすると、セルをタイルごとに描いておき、スクロールしても新しく見えたタイルだけを描く
+		void setTileCacheEnabled(bool enabled);
+		bool isTileCacheEnabled() const noexcept;
+		const TileRenderCache& getTileRenderCache() const noexcept;
+		// 先頭の rows 行と columns 列を固定し、残りだけをスクロールする
+		void setFrozenPanes(size_t rows, size_t columns);
+		size_t getFrozenRows() const noexcept;
+		size_t getFrozenColumns() const noexcept;
+		void update();
+		void draw() const;
+	private:
+		// 描いた結果を左右する状態。前回描いたときと同じなら描き直さなくてよい
+		struct RedrawState
+		{
+			Point scrollOffset{ 0, 0 };
+			Size gridSize{ 0, 0 };
+			// 列の幅と行の高さ
+			uint64 cellSizeVersion = 0;
+			Size frozenSize{ 0, 0 };
+			Optional<Point> hoveredCell;
+			Optional<Point> selectedCell;
+			Optional<Point> selectionEnd;
+			Optional<size_t> hoveredRow;
+			Optional<size_t> hoveredColumn;
+			Optional<size_t> selectedRow;
+			Optional<size_t> selectedColumn;
+			uint64 dataVersion = 0;
+			uint64 labelVersion = 0;
+			uint64 rowViewVersion = 0;
+			uint64 styleVersion = 0;
+			uint64 overlayVersion = 0;
+			// 検索の途中で一致が増えたら、重ねて描く一致の色を描き直す
+			size_t findMatchCount = 0;
+
+			bool operator==(const RedrawState&) const = default;
+		};
+
+		// 固定した行と列で分けた表示領域の 1 つ。領域ごとに座標変換と表示範囲を持つ
+		struct Pane
+		{
+			// セルの領域の左上を原点とする、この領域の範囲
+			Rect area{ 0, 0, 0, 0 };
+
+			// シートの左上を原点とする座標で、この領域に見えている範囲
+			Rect viewport{ 0, 0, 0, 0 };
+
+			CellGrid::VisibleSpan span;
+
+			// この領域に表示するセルの内容
+			CellWindow window;
+
+			// シートの座標から、セルの領域の左上を原点とする座標へのずれ
+			Point offset() const noexcept
+			{
+				return (area.pos - viewport.pos);
+			}
+		};
+
+		// m_panes の並び。固定した行と列が交わる部分、固定した行、固定した列、残りの順
+		inline constexpr static size_t CornerPane = 0;
+		inline constexpr static size_t FrozenRowsPane = 1;
+		inline constexpr static size_t FrozenColumnsPane = 2;
+		inline constexpr static size_t BodyPane = 3;
+
+		// 列の見出しは固定した列と残りの列、行の見出しは固定した行と残りの行に分けて描く
+		inline constexpr static std::array<size_t, 2> ColumnHeaderPanes{ CornerPane, FrozenRowsPane };
+		inline constexpr static std::array<size_t, 2> RowHeaderPanes{ CornerPane, FrozenColumnsPane };
+
+		// 時間の予算はこの件数の書き換えごとに確かめる。同じセルへの書き込みもこの件数の中でまとめる
+		inline constexpr static size_t PatchChunkSize = 256;
+
+		void initialize(const Size& sheetSize, const Size& visibleCellSize, const Point& viewPoint);
+		GridCellSource& getGridSource();
+		void updateScrollBar(bool wheelEnabled);
+		void updateScrollBarConstraints();
+		void syncSourceSize();
+		void applyPatches();
+		bool hasPendingPatches() const;
+		void toggleSortKey(size_t column, bool append);
+		void cancelBackgroundTasks();
+		void startSort();
+		void startFilter();
+		void applyRowTaskResults();
+		void eraseLeadingRows(size_t count);
+		void refilterRows();
+		bool mergePartialFilter(const RowFilter::PartialResult& result);
+		void updateRowView();
+		void startFind();
+		const Array<FindMatch>& getDisplayFindMatches();
+		bool moveToFindMatch(bool forward);
+		void startColumnStats();
+		void applyColumnStatsResult();
+		void invalidateColumnStats(size_t firstColumn, size_t lastColumn);
+		void invalidateRangeIndex(size_t firstColumn, size_t lastColumn);
+		void updateRangeSummary();
+		void updateScrollOffset();
+		void updateVisibleSpan();
+		void updateWindow();
+		void updateCells(const Pane* pane);
+		void updateSelectedRow(const Pane* pane);
+		void updateSelectedColumn(const Pane* pane);
+		bool isCellVisible(size_t row, size_t column) const;
+		bool isCellFullyVisible(size_t row, size_t column) const;
+		Size getCellAreaSize() const;
+		Size getFrozenSize() const;
+		const String* findFetchedCell(size_t row, size_t column) const;
+		StringView getRowName(size_t row, LabelBuffer& buffer) const;
+		StringView getColumnName(size_t column, LabelBuffer& buffer) const;
+		RedrawState captureRedrawState() const;
+		void drawSheet() const;
+		void drawCachedSheet() const;
+		void drawSheetHeader(const Pane& pane) const;
+		void drawSheetRows(const Pane& pane) const;
+		void drawCells(const Pane& pane) const;
+		void drawCellContents(const CellGrid::VisibleSpan& span) const;
+		void drawCellTile(const Rect& region) const;
+		void drawSelectedRow(const Pane& pane) const;
+		void drawSelectedColumn(const Pane& pane) const;
+		void drawGridLines() const;
+		std::shared_ptr<ICellSource> m_source;
+		std::shared_ptr<RowViewSource> m_rowView;
+		uint64 m_fetchedVersion = 0;
+		RectF m_viewArea;
+		RectF m_sheetArea;
+		SasaGUI::ScrollBar m_verticalScrollBar{ SasaGUI::Orientation::Vertical };
+		SasaGUI::ScrollBar m_horizontalScrollBar{ SasaGUI::Orientation::Horizontal };
+		Point m_scrollOffset{ 0, 0 };
+		CellGrid m_cellGrid;
+		size_t m_frozenRows = 0;
+		size_t m_frozenColumns = 0;
+		std::array<Pane, 4> m_panes;
+		HeaderLabels m_rowLabels;
+		// 供給元が捨てた先頭の行の数。行の名前は捨てた行も数えた、追加された順の番号で引く
+		size_t m_erasedRowCount = 0;
+		HeaderLabels m_columnLabels;
+		Font m_indexFont;
+		Font m_textFont;
+		mutable TextLayoutCache m_textLayoutCache;
+		mutable GridLineBatch m_gridLines;
+		bool m_tileCacheEnabled = false;
+		mutable TileRenderCache m_tileCache;
+		mutable CellGrid::VisibleSpan m_tileSpan;
+		// 描いてあるタイルを全て描き直すときに進める
+		uint64 m_tileDataVersion = 0;
+		uint64 m_tileSourceVersion = 0;
+		uint64 m_dataVersion = 0;
+		uint64 m_labelVersion = 0;
+		// フォントなど、タイルに描いたセルの見た目が変わるたびに進める
+		uint64 m_styleVersion = 0;
+		// 並べ替えの向きや検索語など、タイルの外に重ねて描くものが変わるたびに進める。タイルは描き直さない
+		uint64 m_overlayVersion = 0;
+		Optional<Point> m_hoveredCell;
+		Optional<Point> m_selectedCell;
+		Optional<Point> m_selectionEnd;
+		bool m_draggingSelection = false;
+		Optional<size_t> m_hoveredRow;
+		Optional<size_t> m_hoveredColumn;
+		Optional<size_t> m_selectedRow;
+		Optional<size_t> m_selectedColumn;
+		bool m_followTail = false;
+		std::shared_ptr<PatchQueue> m_patchQueue = std::make_shared<PatchQueue>();
+		Duration m_patchTimeBudget = SecondsF{ 0.002 };
+		// 取り出したまとまりのうち、次に反映する位置。予算を使い切ったら次のフレームでここから続ける
+		Array<Patch> m_patchBuffer;
+		size_t m_patchIndex = 0;
+		Array<SortKey> m_sortKeys;
+		Optional<Array<size_t>> m_sortedRows;
+		RowSorter m_rowSorter;
+		Array<FilterCondition> m_filters;
+		// 行が増えたときにその場で伸ばすので、 RowFilter の結果を複製して持つ
+		Optional<RowBitmap> m_filterBitmap;
+		// 書き換えた元の行。絞り込みの条件で判定し直す
+		Array<size_t> m_refilterRows;
+		RowFilter m_rowFilter;
+		String m_findQuery;
+		CellFinder m_finder;
+		// 検索の結果が表している供給元の版と行数。 SpreadSheet を通さずに変わったら探し直す
+		uint64 m_findSourceVersion = 0;
+		size_t m_findRowCount = 0;
+		// 見つかった位置を表示上の行の順に並べ直したもの。行の並びか見つかった数が変わったら作り直す
+		Array<FindMatch> m_displayFindMatches;
+		uint64 m_displayFindMatchesVersion = 0;
+		Optional<size_t> m_displayFindMatchCount;
+		HashTable<size_t, ColumnStats> m_columnStats;
+		// 集計した後に内容が変わった列。選択中なら、集計の手が空いたときに集計し直す
+		HashSet<size_t> m_staleStatsColumns;
+		uint64 m_statsSourceVersion = 0;
+		size_t m_statsColumn = 0;
+		ColumnStatsCalculator m_statsCalculator;
+		RangeAggregator m_rangeAggregator;
+		uint64 m_rangeIndexVersion = 0;
+		// 区間木が読んだ行数。これより行が増えただけなら、区間木は捨てずに伸ばす
+		size_t m_rangeIndexRowCount = 0;
+		Optional<RangeSummary> m_rangeSummary;
+		bool m_frameCacheEnabled = false;
+		mutable MSRenderTexture m_frame;
+		mutable Optional<RedrawState> m_drawnState;
+	};
+}
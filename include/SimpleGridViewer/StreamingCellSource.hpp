@@ -0,0 +1,55 @@
+﻿# pragma once
+# include "SimpleGridViewer/CellSource.hpp"
+
+namespace SimpleGridViewer
+{
+	// 行を末尾に追加していく ICellSource
+	// 行は最大 maxRows 行のリングバッファに保持し、あふれた分は古い行から捨てる
+	// 捨てた行のセルの文字列の領域は新しい行で再利用するので、メモリの使用量は増え続けない
+	class StreamingCellSource : public ICellSource
+	{
+	public:
+		StreamingCellSource(size_t columnCount, size_t maxRows);
+
+		size_t rowCount() const override;
+
+		size_t columnCount() const override;
+
+		uint64 version() const override;
+
+		void fetch(CellWindow& window) const override;
+
+		Optional<StringView> view(size_t row, size_t column) const override;
+
+		bool setCell(size_t row, size_t column, StringView value) override;
+
+		// 列数より多い値は無視し、足りない列は空にする
+		bool appendRow(std::span<const String> values) override;
+
+		bool appendRow(std::span<const StringView> values);
+
+		void clear();
+
+		size_t maxRows() const noexcept;
+
+	private:
+		template <class Type>
+		void appendRowImpl(std::span<const Type> values);
+
+		const String& cell(size_t row, size_t column) const;
+
+		size_t m_columnCount;
+
+		size_t m_maxRows;
+
+		// m_maxRows 行に達するまでは末尾に伸ばし、それ以降は m_head の行から上書きする
+		Array<String> m_cells;
+
+		// 最も古い行の位置
+		size_t m_head = 0;
+
+		size_t m_rowCount = 0;
+
+		uint64 m_version = 0;
+	};
+}
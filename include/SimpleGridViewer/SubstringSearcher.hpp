@@ -0,0 +1,29 @@
+﻿# pragma once
+
+namespace SimpleGridViewer
+{
+	// 決まった文字列を含むかどうかを調べる
+	// 検索語の先頭と末尾の文字を SIMD で複数の位置についてまとめて比べ、両方が一致した位置だけを全体で比べる
+	class SubstringSearcher
+	{
+	public:
+		SubstringSearcher() = default;
+
+		explicit SubstringSearcher(StringView needle);
+
+		bool isEmpty() const noexcept;
+
+		const String& needle() const noexcept;
+
+		// 検索語が空なら常に true
+		bool contains(StringView text) const noexcept;
+
+		// UTF-8 の文字列をそのまま調べる
+		bool contains(std::string_view utf8) const noexcept;
+
+	private:
+		String m_needle;
+
+		std::string m_utf8;
+	};
+}
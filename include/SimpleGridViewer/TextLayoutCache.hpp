@@ -0,0 +1,88 @@
+﻿# pragma once
+
+namespace SimpleGridViewer
+{
+	// 整形済みのグリフ列を保持する LRU キャッシュ
+	// 毎フレーム同じ文字列を整形し直さないために使う
+	class TextLayoutCache
+	{
+	public:
+		enum class Slot : uint8
+		{
+			Cell,
+			ColumnName,
+			RowName,
+		};
+
+		struct Key
+		{
+			Slot slot = Slot::Cell;
+			uint64 row = 0;
+			uint64 column = 0;
+
+			// 内容を表す値。セルは文字列のハッシュ、見出しはラベルのバージョン
+			// 内容が変わったら別のキーになるので、書き換えたセルの整形だけをやり直す
+			uint64 content = 0;
+
+			// 描画できる幅。これを超える部分は省略記号に置き換える
+			int32 clipWidth = 0;
+
+			bool operator==(const Key&) const = default;
+		};
+
+		struct Layout
+		{
+			Array<Glyph> glyphs;
+
+			// 各グリフのペン位置の X 座標
+			Array<double> penX;
+
+			double width = 0.0;
+
+			double height = 0.0;
+
+			void draw(const Vec2& pos, const ColorF& color) const;
+
+			void drawAt(const Vec2& center, const ColorF& color) const;
+		};
+
+		explicit TextLayoutCache(size_t capacity = 16384);
+
+		// キャッシュに無ければ font で text を整形して登録する
+		// 返す参照は次に get() を呼ぶまで有効
+		const Layout& get(const Key& key, const Font& font, StringView text);
+
+		void clear();
+
+		size_t size() const noexcept;
+
+		size_t capacity() const noexcept;
+
+		size_t hits() const noexcept;
+
+		size_t misses() const noexcept;
+
+		void resetCounters() noexcept;
+
+	private:
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const noexcept;
+		};
+
+		using Entry = std::pair<Key, Layout>;
+
+		static Layout MakeLayout(const Font& font, StringView text, int32 clipWidth);
+
+		size_t m_capacity;
+
+		// 先頭ほど最近使われたもの
+		std::list<Entry> m_entries;
+
+		HashTable<Key, std::list<Entry>::iterator, KeyHash> m_index;
+
+		size_t m_hits = 0;
+
+		size_t m_misses = 0;
+	};
+}
@@ -0,0 +1,93 @@
+﻿# pragma once
+
+namespace SimpleGridViewer
+{
+	// セルの領域を一定の大きさのタイルに分けて RenderTexture に描いておく LRU キャッシュ
+	// スクロールしても描いてあるタイルを貼り合わせるだけで済み、新しく見えたタイルだけを描く
+	// ソフトウェアのレンダラでも重くならないよう、マルチサンプルは使わず、テクスチャは作り直さずに使い回す
+	class TileRenderCache
+	{
+	public:
+		// タイルの 1 辺の長さ（ピクセル）
+		inline constexpr static int32 TileSize = 256;
+
+		// シートの左上を原点とする座標の region を描く。座標変換は呼び出し側で設定済み
+		using Renderer = std::function<void(const Rect& region)>;
+
+		explicit TileRenderCache(size_t capacity = 128);
+
+		// region と重なるタイル全体の範囲を返す
+		static Rect GetTileBounds(const Rect& region);
+
+		// viewport と重なるタイルを、シートの左上を原点とする座標に貼り合わせる
+		// まだ描いていないタイルと、 dataVersion, styleVersion, background が描いたときと違うタイルは render で描き直す
+		void draw(const Rect& viewport, uint64 dataVersion, uint64 styleVersion, const ColorF& background, const Renderer& render);
+
+		// region と重なるタイルを描き直す対象にする
+		void invalidate(const Rect& region);
+
+		// Y 座標が top 以降の部分を含むタイルを全て描き直す対象にする
+		void invalidateBelow(int32 top);
+
+		// 全てのタイルを捨てる。テクスチャは次に描くタイルで使い回す
+		void clear();
+
+		// テクスチャも含めて全て解放する
+		void release();
+
+		size_t size() const noexcept;
+
+		size_t capacity() const noexcept;
+
+		// 直前の draw() で描き直したタイルの数
+		size_t renderedCount() const noexcept;
+
+	private:
+		struct Key
+		{
+			// 列方向と行方向のタイルの番号
+			int32 x = 0;
+
+			int32 y = 0;
+
+			bool operator==(const Key&) const = default;
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const noexcept;
+		};
+
+		struct Tile
+		{
+			Key key;
+
+			RenderTexture texture;
+
+			uint64 dataVersion = 0;
+
+			uint64 styleVersion = 0;
+
+			// invalidate() されたら false
+			bool valid = false;
+		};
+
+		Tile& acquire(const Key& key);
+
+		void evict(size_t usedCount);
+
+		size_t m_capacity;
+
+		// 先頭ほど最近使われたもの
+		std::list<Tile> m_tiles;
+
+		HashTable<Key, std::list<Tile>::iterator, KeyHash> m_index;
+
+		// 捨てたタイルのテクスチャ
+		Array<RenderTexture> m_freeTextures;
+
+		ColorF m_background{ 0.0, 0.0 };
+
+		size_t m_renderedCount = 0;
+	};
+}
@@ -1,166 +1,309 @@
-﻿# pragma once
-# include "gridcell/GuiGridAxis.hpp"
-
-class CellGrid {
-public:
-
-	CellGrid() = default;
-
-	/// @brief 各列の幅と各行の高さを指定して CellGrid を作成します。
-	/// @param columnWidths 各列の幅（ピクセル）
-	/// @param rowHeights 各行の高さ（ピクセル）
-	CellGrid(const Array<int32>& columnWidths, const Array<int32>& rowHeights);
-
-	/// @brief 列の個数を返します。
-	/// @return 列の個数
-	[[nodiscard]]
-	size_t getColumnCount() const noexcept;
-
-	/// @brief 行の個数を返します。
-	/// @return 行の個数
-	[[nodiscard]]
-	size_t getRowCount() const noexcept;
-
-	/// @brief セルの個数が 0 であるかを返します。
-	/// @return セルの個数が 0 である場合 true, それ以外の場合は false
-	[[nodiscard]]
-	bool isEmpty() const noexcept;
-
-	/// @brief セルの個数を返します。
-	/// @return セルの個数
-	[[nodiscard]]
-	size_t getNumCells() const noexcept;
-
-	/// @brief 行と列の情報をクリアします。
-	void clear() noexcept;
-
-	/// @brief 各列の幅を返します。
-	/// @return 各列の幅（ピクセル）
-	[[nodiscard]]
-	const Array<int32>& getColumnWidths() const noexcept;
-
-	/// @brief 各行の高さを返します。
-	/// @return 各行の高さ（ピクセル）
-	[[nodiscard]]
-	const Array<int32>& getRowHeights() const noexcept;
-
-	/// @brief 列の幅を追加します。
-	/// @param width 列の幅（ピクセル）
-	/// @remark この関数を呼び出すと、列の個数が 1 増えます。
-	void addColumn(int32 width);
-
-	/// @brief 行の高さを追加します。
-	/// @param height 行の高さ（ピクセル）
-	/// @remark この関数を呼び出すと、行の個数が 1 増えます。
-	void addRow(int32 height);
-
-	/// @brief 指定した列を削除します。
-	/// @param column 列
-	void removeColumn(size_t column);
-
-	/// @brief 指定した行を削除します。
-	/// @param row 行
-	void removeRow(size_t row);
-
-	/// @brief 列を挿入します。
-	/// @param column 挿入する列の位置
-	/// @param width 列の幅（ピクセル）
-	void insertColumn(size_t column, int32 width);
-
-	/// @brief 行を挿入します。
-	/// @param row 挿入する行の位置
-	/// @param height 行の高さ（ピクセル）
-	void insertRow(size_t row, int32 height);
-
-	/// @brief 指定した列の幅を変更します。
-	/// @param column 列
-	/// @param width 列の幅（ピクセル）
-	void setColumnWidth(size_t column, int32 width) noexcept;
-
-	/// @brief 指定した行の高さを変更します。
-	/// @param row 行
-	/// @param height 行の高さ（ピクセル）
-	void setRowHeight(size_t row, int32 height) noexcept;
-
-	/// @brief 指定した列の幅を返します。
-	/// @param column 列
-	/// @return 列の幅（ピクセル）
-	[[nodiscard]]
-	int32 getColumnWidth(size_t column) const noexcept;
-
-	/// @brief 指定した行の高さを返します。
-	/// @param row 行
-	/// @return 行の高さ（ピクセル）
-	[[nodiscard]]
-	int32 getRowHeight(size_t row) const noexcept;
-
-	/// @brief 指定したインデックスのセルのサイズを返します。
-	/// @param column 列
-	/// @param row 行
-	/// @return セルのサイズ（ピクセル）
-	Size getCellSize(size_t column, size_t row) const noexcept;
-
-	/// @brief 全ての列の幅の合計を返します。
-	/// @return 全ての列の幅の合計（ピクセル）
-	[[nodiscard]]
-	int32 getTotalWidth() const noexcept;
-
-	/// @brief 全ての行の高さの合計を返します。
-	/// @return 全ての行の高さの合計（ピクセル）
-	[[nodiscard]]
-	int32 getTotalHeight() const noexcept;
-
-	/// @brief 指定した列が始まる X 座標を返します。
-	/// @param column 列
-	/// @return 指定した列が始まる X 座標（ピクセル）。列が存在しない場合は最後の列の終端の座標を返します。
-	[[nodiscard]]
-	int32 getCellX(size_t column) const noexcept;
-
-	/// @brief 指定した行が始まる Y 座標を返します。
-	/// @param row 行
-	/// @return 指定した行が始まる Y 座標（ピクセル）。行が存在しない場合は最後の行の終端の座標を返します。
-	[[nodiscard]]
-	int32 getCellY(size_t row) const noexcept;
-
-	/// @brief 指定したインデックスのセルの位置を返します。
-	/// @param column 列
-	/// @param row 行
-	/// @return セルの位置（ピクセル）
-	/// @remark セルの位置は、セルの左上隅の座標です。
-	[[nodiscard]]
-	Point getCellPosition(size_t column, size_t row) const noexcept;
-
-	/// @brief 指定したインデックスのセルの範囲を返します。
-	/// @param column 列
-	/// @param row 行
-	/// @return セルの範囲（ピクセル）
-	/// @remark セルの範囲は、セルの左上隅の座標とセルのサイズからなります。
-	[[nodiscard]]
-	Rect getCellRect(size_t column, size_t row) const noexcept;
-
-	/// @brief 指定した X 座標がどの列に属するかを返します。
-	/// @param x X 座標
-	/// @return 列のインデックス。指定した座標がどの列にも属さない場合は、none を返します。
-	[[nodiscard]]
-	Optional<size_t> getColumnIndex(int32 x) const noexcept;
-
-	/// @brief 指定した Y 座標がどの行に属するかを返します。
-	/// @param y Y 座標
-	/// @return 行のインデックス。指定した座標がどの行にも属さない場合は、none を返します。
-	[[nodiscard]]
-	Optional<size_t> getRowIndex(int32 y) const noexcept;
-
-	/// @brief 指定した座標がどのセルに属するかを返します。
-	/// @param pos 座標
-	/// @return セルのインデックス。指定した座標がどのセルにも属さない場合は、none を返します。
-	[[nodiscard]]
-	Optional<Point> getCellIndex(Point pos) const noexcept;
-
-private:
-
-	// 各列の幅（ピクセル）
-	GuiGridAxis m_columnWidths;
-
-	// 各行の高さ（ピクセル）
-	GuiGridAxis m_rowHeights;
-};
+﻿# pragma once
+# include "gridcell/TreeGridAxis.hpp"
+
+class CellGrid {
+public:
+
+	/// @brief 表示範囲に含まれる行と列、およびそれらの位置とサイズ
+	/// @remark 各配列の i 番目は、それぞれ firstColumn + i 列目、firstRow + i 行目に対応します。
+	struct VisibleSpan
+	{
+		size_t firstColumn = 0;
+
+		size_t lastColumn = 0;
+
+		size_t firstRow = 0;
+
+		size_t lastRow = 0;
+
+		// 各列が始まる X 座標（ピクセル）
+		Array<int32> xs;
+
+		// 各列の幅（ピクセル）
+		Array<int32> widths;
+
+		// 各行が始まる Y 座標（ピクセル）
+		Array<int32> ys;
+
+		// 各行の高さ（ピクセル）
+		Array<int32> heights;
+
+		/// @brief 表示範囲に含まれるセルが無いかを返します。
+		/// @return セルが無い場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool isEmpty() const noexcept
+		{
+			return (xs.isEmpty() || ys.isEmpty());
+		}
+
+		/// @brief 指定した列が表示範囲に含まれるかを返します。
+		/// @param column 列
+		/// @return 含まれる場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool containsColumn(size_t column) const noexcept
+		{
+			return (not xs.isEmpty() && firstColumn <= column && column <= lastColumn);
+		}
+
+		/// @brief 指定した行が表示範囲に含まれるかを返します。
+		/// @param row 行
+		/// @return 含まれる場合 true, それ以外の場合は false
+		[[nodiscard]]
+		bool containsRow(size_t row) const noexcept
+		{
+			return (not ys.isEmpty() && firstRow <= row && row <= lastRow);
+		}
+
+		/// @brief 表示範囲内のセルの範囲を返します。
+		/// @param column 列
+		/// @param row 行
+		/// @return セルの範囲（ピクセル）
+		/// @remark column と row は表示範囲に含まれている必要があります。
+		[[nodiscard]]
+		Rect getCellRect(size_t column, size_t row) const noexcept
+		{
+			const size_t i = column - firstColumn;
+			const size_t k = row - firstRow;
+			return Rect{ xs[i], ys[k], widths[i], heights[k] };
+		}
+	};
+
+	/// @brief 座標の上限（ピクセル）
+	/// @remark 行の高さや列の幅の合計は 64 ビットで保持しますが、座標は int32 で扱うため、この値を超える位置はこの値にそろえます。
+	/// 例えば行の高さが 20 ピクセルの場合、約 1 億 700 万行目以降の行には届きません。
+	inline static constexpr int32 MaxPosition = std::numeric_limits<int32>::max();
+
+	CellGrid() = default;
+
+	/// @brief 各列の幅と各行の高さを指定して CellGrid を作成します。
+	/// @param columnWidths 各列の幅（ピクセル）
+	/// @param rowHeights 各行の高さ（ピクセル）
+	CellGrid(const Array<int32>& columnWidths, const Array<int32>& rowHeights);
+
+	/// @brief 全ての列の幅と全ての行の高さが等しい CellGrid を作成します。
+	/// @param cellCount 列の個数と行の個数
+	/// @param cellSize 列の幅と行の高さ（ピクセル）
+	/// @remark 同じ幅が続く区間はまとめて保持されるため、行や列の個数によらず少ないメモリで済みます。
+	CellGrid(const Size& cellCount, const Size& cellSize);
+
+	/// @brief 列の個数を返します。
+	/// @return 列の個数
+	[[nodiscard]]
+	size_t getColumnCount() const noexcept;
+
+	/// @brief 行の個数を返します。
+	/// @return 行の個数
+	[[nodiscard]]
+	size_t getRowCount() const noexcept;
+
+	/// @brief セルの個数が 0 であるかを返します。
+	/// @return セルの個数が 0 である場合 true, それ以外の場合は false
+	[[nodiscard]]
+	bool isEmpty() const noexcept;
+
+	/// @brief セルの個数を返します。
+	/// @return セルの個数
+	[[nodiscard]]
+	size_t getNumCells() const noexcept;
+
+	/// @brief 行と列の情報をクリアします。
+	void clear() noexcept;
+
+	/// @brief 各列の幅を返します。
+	/// @return 各列の幅（ピクセル）
+	[[nodiscard]]
+	Array<int32> getColumnWidths() const;
+
+	/// @brief 各行の高さを返します。
+	/// @return 各行の高さ（ピクセル）
+	[[nodiscard]]
+	Array<int32> getRowHeights() const;
+
+	/// @brief 列の幅を追加します。
+	/// @param width 列の幅（ピクセル）
+	/// @remark この関数を呼び出すと、列の個数が 1 増えます。
+	void addColumn(int32 width);
+
+	/// @brief 行の高さを追加します。
+	/// @param height 行の高さ（ピクセル）
+	/// @remark この関数を呼び出すと、行の個数が 1 増えます。
+	void addRow(int32 height);
+
+	/// @brief 指定した列を削除します。
+	/// @param column 列
+	void removeColumn(size_t column);
+
+	/// @brief 指定した行を削除します。
+	/// @param row 行
+	void removeRow(size_t row);
+
+	/// @brief 列を挿入します。
+	/// @param column 挿入する列の位置
+	/// @param width 列の幅（ピクセル）
+	void insertColumn(size_t column, int32 width);
+
+	/// @brief 行を挿入します。
+	/// @param row 挿入する行の位置
+	/// @param height 行の高さ（ピクセル）
+	void insertRow(size_t row, int32 height);
+
+	/// @brief 複数の列の幅をまとめて追加します。
+	/// @param widths 各列の幅（ピクセル）
+	/// @remark この関数を呼び出すと、列の個数が widths.size() 増えます。
+	void addColumns(std::span<const int32> widths);
+
+	/// @brief 複数の行の高さをまとめて追加します。
+	/// @param heights 各行の高さ（ピクセル）
+	/// @remark この関数を呼び出すと、行の個数が heights.size() 増えます。
+	void addRows(std::span<const int32> heights);
+
+	/// @brief 同じ幅の列をまとめて追加します。
+	/// @param count 追加する列の個数
+	/// @param width 列の幅（ピクセル）
+	void addColumns(size_t count, int32 width);
+
+	/// @brief 同じ高さの行をまとめて追加します。
+	/// @param count 追加する行の個数
+	/// @param height 行の高さ（ピクセル）
+	void addRows(size_t count, int32 height);
+
+	/// @brief 指定した範囲の列を削除します。
+	/// @param first 削除する最初の列
+	/// @param last 削除する最後の列の次の列
+	void removeColumns(size_t first, size_t last);
+
+	/// @brief 指定した範囲の行を削除します。
+	/// @param first 削除する最初の行
+	/// @param last 削除する最後の行の次の行
+	void removeRows(size_t first, size_t last);
+
+	/// @brief 複数の列をまとめて挿入します。
+	/// @param column 挿入する列の位置
+	/// @param widths 各列の幅（ピクセル）
+	void insertColumns(size_t column, std::span<const int32> widths);
+
+	/// @brief 複数の行をまとめて挿入します。
+	/// @param row 挿入する行の位置
+	/// @param heights 各行の高さ（ピクセル）
+	void insertRows(size_t row, std::span<const int32> heights);
+
+	/// @brief 指定した列の幅を変更します。
+	/// @param column 列
+	/// @param width 列の幅（ピクセル）
+	void setColumnWidth(size_t column, int32 width) noexcept;
+
+	/// @brief 指定した行の高さを変更します。
+	/// @param row 行
+	/// @param height 行の高さ（ピクセル）
+	void setRowHeight(size_t row, int32 height) noexcept;
+
+	/// @brief 複数の列の幅をまとめて変更します。
+	/// @param widths 列と列の幅（ピクセル）の組
+	void setColumnWidths(std::span<const std::pair<size_t, int32>> widths);
+
+	/// @brief 複数の行の高さをまとめて変更します。
+	/// @param heights 行と行の高さ（ピクセル）の組
+	void setRowHeights(std::span<const std::pair<size_t, int32>> heights);
+
+	/// @brief 指定した列の幅を返します。
+	/// @param column 列
+	/// @return 列の幅（ピクセル）
+	[[nodiscard]]
+	int32 getColumnWidth(size_t column) const noexcept;
+
+	/// @brief 指定した行の高さを返します。
+	/// @param row 行
+	/// @return 行の高さ（ピクセル）
+	[[nodiscard]]
+	int32 getRowHeight(size_t row) const noexcept;
+
+	/// @brief 指定したインデックスのセルのサイズを返します。
+	/// @param column 列
+	/// @param row 行
+	/// @return セルのサイズ（ピクセル）
+	Size getCellSize(size_t column, size_t row) const noexcept;
+
+	/// @brief 全ての列の幅の合計を返します。
+	/// @return 全ての列の幅の合計（ピクセル）。 MaxPosition を超える場合は MaxPosition
+	[[nodiscard]]
+	int32 getTotalWidth() const noexcept;
+
+	/// @brief 列の幅や行の高さ、列や行の個数を変えるたびに増える値を返します。
+	/// @return 列の幅と行の高さの版
+	[[nodiscard]]
+	uint64 getSizeVersion() const noexcept;
+
+	/// @brief 全ての行の高さの合計を返します。
+	/// @return 全ての行の高さの合計（ピクセル）。 MaxPosition を超える場合は MaxPosition
+	[[nodiscard]]
+	int32 getTotalHeight() const noexcept;
+
+	/// @brief 指定した列が始まる X 座標を返します。
+	/// @param column 列
+	/// @return 指定した列が始まる X 座標（ピクセル）。列が存在しない場合は最後の列の終端の座標を返します。
+	[[nodiscard]]
+	int32 getCellX(size_t column) const noexcept;
+
+	/// @brief 指定した行が始まる Y 座標を返します。
+	/// @param row 行
+	/// @return 指定した行が始まる Y 座標（ピクセル）。行が存在しない場合は最後の行の終端の座標を返します。
+	[[nodiscard]]
+	int32 getCellY(size_t row) const noexcept;
+
+	/// @brief 指定したインデックスのセルの位置を返します。
+	/// @param column 列
+	/// @param row 行
+	/// @return セルの位置（ピクセル）
+	/// @remark セルの位置は、セルの左上隅の座標です。
+	[[nodiscard]]
+	Point getCellPosition(size_t column, size_t row) const noexcept;
+
+	/// @brief 指定したインデックスのセルの範囲を返します。
+	/// @param column 列
+	/// @param row 行
+	/// @return セルの範囲（ピクセル）
+	/// @remark セルの範囲は、セルの左上隅の座標とセルのサイズからなります。
+	[[nodiscard]]
+	Rect getCellRect(size_t column, size_t row) const noexcept;
+
+	/// @brief 指定した X 座標がどの列に属するかを返します。
+	/// @param x X 座標
+	/// @return 列のインデックス。指定した座標がどの列にも属さない場合は、none を返します。
+	[[nodiscard]]
+	Optional<size_t> getColumnIndex(int32 x) const noexcept;
+
+	/// @brief 指定した Y 座標がどの行に属するかを返します。
+	/// @param y Y 座標
+	/// @return 行のインデックス。指定した座標がどの行にも属さない場合は、none を返します。
+	[[nodiscard]]
+	Optional<size_t> getRowIndex(int32 y) const noexcept;
+
+	/// @brief 指定した座標がどのセルに属するかを返します。
+	/// @param pos 座標
+	/// @return セルのインデックス。指定した座標がどのセルにも属さない場合は、none を返します。
+	[[nodiscard]]
+	Optional<Point> getCellIndex(Point pos) const noexcept;
+
+	/// @brief 指定した範囲と重なる行と列を、それらの位置とサイズとともに返します。
+	/// @param viewport 範囲（ピクセル）
+	/// @return 範囲と重なる行と列
+	/// @remark 各軸について、両端の要素を posToIndex で 2 回探索し、その間の位置とサイズは getCellRanges の一度の探索と走査で求めます。
+	[[nodiscard]]
+	VisibleSpan queryVisible(const RectF& viewport) const;
+
+	/// @brief 指定した範囲と重なる行と列を、それらの位置とサイズとともに求めます。
+	/// @param viewport 範囲（ピクセル）
+	/// @param span 結果の格納先。配列の領域は再利用されます。
+	void queryVisible(const RectF& viewport, VisibleSpan& span) const;
+
+private:
+
+	// 各列の幅（ピクセル）
+	TreeGridAxis m_columnWidths;
+
+	// 各行の高さ（ピクセル）
+	TreeGridAxis m_rowHeights;
+
+	// 列の幅と行の高さの版
+	uint64 m_sizeVersion = 0;
+};
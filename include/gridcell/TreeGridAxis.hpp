@@ -0,0 +1,127 @@
+﻿# pragma once
+
+// 暗黙キーの Treap による軸
+// insert / erase / setWidth / posToIndex / indexToPos がすべて O(log n)
+// 連続する同じ幅はひとつのノード（ラン）にまとめるので、
+// 幅がそろっている区間はラン数 r に対して O(log r) の時間と O(r) のメモリで済む
+class TreeGridAxis {
+public:
+	// 1 要素の幅
+	using Coord = int32;
+
+	// 幅を足し合わせた位置。要素数が多いと Coord に収まらないので 64 ビットで持つ
+	using Position = int64;
+
+	TreeGridAxis();
+
+	TreeGridAxis(Array<Coord> init);
+
+	// 同じ幅が count 個並んだ軸
+	TreeGridAxis(size_t count, Coord width);
+
+	size_t size() const;
+
+	Position totalWidth() const;
+
+	bool isEmpty() const;
+
+	// 保持しているランの個数
+	size_t runCount() const;
+
+	void clear();
+
+	// lower bound
+	size_t posToIndex(Position x) const;
+
+	Position indexToPos(size_t at) const;
+
+	Coord getWidth(size_t at) const;
+
+	// ( left pos, width )
+	std::pair<Position, Coord> getCellRange(size_t at) const;
+
+	Array<Coord> getWidthArray() const;
+
+	// [first, last) の各要素の ( left pos, width ) を、一度の探索と通りがけ順の走査で求める
+	// 描画に使う座標なので位置は Coord で返し、Coord に収まらない位置は Coord の最大値にそろえる
+	void getCellRanges(size_t first, size_t last, Array<Coord>& positions, Array<Coord>& widths) const;
+
+	void insert(size_t at, Coord width);
+
+	void erase(size_t at);
+
+	// 範囲操作はまとめて部分木を組み立て、split / merge を一度だけ行う
+
+	void insertRange(size_t at, std::span<const Coord> widths);
+
+	// [first, last) を削除
+	void eraseRange(size_t first, size_t last);
+
+	void appendRange(std::span<const Coord> widths);
+
+	// 同じ幅の要素を count 個追加。ランのまま追加するので count に比例した処理はしない
+	void appendRun(size_t count, Coord width);
+
+	void setWidth(size_t at, Coord newWidth);
+
+	// ( index, width ) の組をまとめて適用する
+	void setWidths(std::span<const std::pair<size_t, Coord>> widths);
+
+private:
+
+	// 添字 0 は番兵（空の部分木）
+	using NodeIndex = uint32;
+
+	struct Node {
+		NodeIndex left = 0;
+		NodeIndex right = 0;
+		uint32 priority = 0;
+
+		// このランの 1 要素あたりの幅
+		Coord width = 0;
+
+		// このランの要素数
+		uint32 length = 0;
+
+		// 部分木の幅の合計
+		Position sum = 0;
+
+		// 部分木の要素数
+		size_t count = 0;
+	};
+
+	Array<Node> m_nodes;
+
+	// 再利用できるノード
+	Array<NodeIndex> m_free;
+
+	NodeIndex m_root = 0;
+
+	uint32 m_seed = 2463534242u;
+
+	uint32 nextPriority();
+
+	NodeIndex newNode(Coord width, uint32 length);
+
+	void deleteTree(NodeIndex node);
+
+	void pull(NodeIndex node);
+
+	// 先頭 at 個と残りに分割
+	// at がランの途中を指す場合はそのランを 2 つに分ける
+	std::pair<NodeIndex, NodeIndex> split(NodeIndex node, size_t at);
+
+	NodeIndex merge(NodeIndex left, NodeIndex right);
+
+	// merge に加えて、境界で隣り合うランの幅が同じなら 1 つにまとめる
+	NodeIndex join(NodeIndex left, NodeIndex right);
+
+	// ランの列から O(r) で Treap を組み立てる
+	NodeIndex build(std::span<const std::pair<Coord, uint32>> runs);
+
+	// 幅の列を連続する同じ幅ごとにランにまとめてから組み立てる
+	NodeIndex build(const Coord* widths, size_t count);
+
+	// at 番目の要素を含むランのノード
+	NodeIndex findNode(size_t at) const;
+};
@@ -263,6 +263,22 @@ namespace SasaGUI
 
 	double ScrollBar::viewportSize() const { return m_viewportSize; }
 
+	bool ScrollBar::isAnimating() const
+	{
+		if (m_thumbGrabbed || m_trackPressed)
+		{
+			return true;
+		}
+
+		// SmoothDamp は目標に漸近するだけなので、十分に近づいたら止まったとみなす
+		if ((0.01 < Abs(m_scrollTarget - m_value)) || (0.01 < Abs(m_scrollVelocity)))
+		{
+			return true;
+		}
+
+		return (not m_colorTransition.isZero()) && (not m_colorTransition.isOne());
+	}
+
 	void ScrollBar::updateLayout(Rect rect)
 	{
 		m_rect = rect;
@@ -0,0 +1,381 @@
+﻿# include "SimpleGridViewer/CellFinder.hpp"
+# include "SimpleGridViewer/ColumnarStore.hpp"
+# include "SimpleGridViewer/Parallel.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace
+	{
+		// 1 つの塊の行数
+		constexpr size_t ChunkRows = 1024;
+
+		// 整数の列の表示は数字と '-' だけなので、それ以外の文字を含む検索語には一致しない
+		bool CanMatchInt64(StringView query)
+		{
+			return std::all_of(query.begin(), query.end(), [](char32 c) { return ((U'0' <= c && c <= U'9') || (c == U'-')); });
+		}
+
+		// ColumnarStore の列ごとに、探す前に 1 度だけ用意しておくもの
+		struct ColumnPlan
+		{
+			// 調べなくても一致しないと分かっている列
+			bool skip = false;
+
+			// 辞書の列で、辞書の文字列ごとに一致するかどうか
+			Array<uint8> dictionaryMatches;
+		};
+
+		Array<ColumnPlan> MakePlans(const ColumnarStore& store, const SubstringSearcher& searcher)
+		{
+			Array<ColumnPlan> plans(store.columnCount());
+			for (size_t index = 0; index < plans.size(); ++index)
+			{
+				const Column& column = store.column(index);
+				switch (GetColumnType(column))
+				{
+				case ColumnType::Int64:
+					plans[index].skip = (not CanMatchInt64(searcher.needle()));
+					break;
+				case ColumnType::Dictionary:
+					for (const auto& entry : std::get<DictionaryColumn>(column).dictionary())
+					{
+						plans[index].dictionaryMatches.push_back(searcher.contains(StringView{ entry }));
+					}
+					break;
+				default:
+					break;
+				}
+			}
+			return plans;
+		}
+
+		void ScanColumnar(const ColumnarStore& store, const Array<ColumnPlan>& plans, const SubstringSearcher& searcher, size_t first, size_t last, Array<FindMatch>& out)
+		{
+			// 列ごとに調べてから、行優先の順に並べ直す
+			String text;
+			for (size_t index = 0; index < plans.size(); ++index)
+			{
+				if (plans[index].skip)
+				{
+					continue;
+				}
+
+				const Column& column = store.column(index);
+				switch (GetColumnType(column))
+				{
+				case ColumnType::Dictionary:
+					{
+						const auto& values = std::get<DictionaryColumn>(column);
+						const auto& matches = plans[index].dictionaryMatches;
+						for (size_t row = first; row < last; ++row)
+						{
+							if (matches[values.getCode(row)])
+							{
+								out.push_back({ row, index });
+							}
+						}
+						break;
+					}
+				case ColumnType::String:
+					{
+						const auto& values = std::get<StringColumn>(column);
+						for (size_t row = first; row < last; ++row)
+						{
+							if (searcher.contains(values.get(row)))
+							{
+								out.push_back({ row, index });
+							}
+						}
+						break;
+					}
+				default:
+					for (size_t row = first; row < last; ++row)
+					{
+						FormatCell(column, row, text);
+						if (searcher.contains(StringView{ text }))
+						{
+							out.push_back({ row, index });
+						}
+					}
+					break;
+				}
+			}
+			std::sort(out.begin(), out.end());
+		}
+
+		void ScanCells(const ICellSource& source, const SubstringSearcher& searcher, size_t first, size_t last, Array<FindMatch>& out);
+
+		// [first, last) 行を調べて、見つかった位置を行優先の順に out に加える
+		void ScanRows(const ICellSource& source, const ColumnarStore* store, const Array<ColumnPlan>& plans, const SubstringSearcher& searcher, size_t first, size_t last, Array<FindMatch>& out)
+		{
+			if (store)
+			{
+				ScanColumnar(*store, plans, searcher, first, last, out);
+			}
+			else
+			{
+				ScanCells(source, searcher, first, last, out);
+			}
+		}
+
+		void ScanCells(const ICellSource& source, const SubstringSearcher& searcher, size_t first, size_t last, Array<FindMatch>& out)
+		{
+			const size_t columnCount = source.columnCount();
+			CellWindow window;
+			window.reset({ first, last }, { 0, columnCount });
+			source.fetch(window);
+
+			for (size_t row = first; row < last; ++row)
+			{
+				for (size_t column = 0; column < columnCount; ++column)
+				{
+					if (searcher.contains(StringView{ window.at(row, column) }))
+					{
+						out.push_back({ row, column });
+					}
+				}
+			}
+		}
+	}
+
+	void CellFinder::start(std::shared_ptr<const ICellSource> source, StringView query, size_t threadCount)
+	{
+		assert(source);
+		cancel();
+
+		m_query = query;
+		if (m_query.isEmpty())
+		{
+			return;
+		}
+
+		m_searcher = SubstringSearcher{ m_query };
+		const size_t rowCount = source->rowCount();
+		m_rowCount = rowCount;
+		m_chunks = std::deque<Chunk>((rowCount + ChunkRows - 1) / ChunkRows);
+
+		m_thread.start([this, source = std::move(source), searcher = m_searcher, rowCount, threadCount = GetThreadCount(threadCount)](std::stop_token stopToken)
+		{
+			const auto* store = dynamic_cast<const ColumnarStore*>(source.get());
+			const Array<ColumnPlan> plans = (store ? MakePlans(*store, searcher) : Array<ColumnPlan>{});
+
+			// 塊は先頭から順に取り出されるので、上の行から結果が揃っていく
+			ParallelFor(m_chunks.size(), threadCount, [&](size_t index)
+			{
+				if (stopToken.stop_requested())
+				{
+					return;
+				}
+
+				Chunk& chunk = m_chunks[index];
+				const size_t first = (index * ChunkRows);
+				const size_t last = Min(first + ChunkRows, rowCount);
+				ScanRows(*source, store, plans, searcher, first, last, chunk.matches);
+
+				// 数えた一致は必ず getMatches() で取り出せるよう、公開してから数える
+				chunk.ready.store(true, std::memory_order_release);
+				m_matchCount += chunk.matches.size();
+				++m_finishedChunks;
+			});
+		});
+	}
+
+	void CellFinder::cancel()
+	{
+		m_thread.cancel();
+		m_appendedScan.cancel();
+
+		m_query.clear();
+		m_rowCount = 0;
+		m_chunks.clear();
+		m_finishedChunks = 0;
+		m_matchCount = 0;
+	}
+
+	void CellFinder::scanAppendedRows(std::shared_ptr<const ICellSource> source, size_t threadCount)
+	{
+		assert(source);
+		assert(not isBusy());
+
+		const size_t first = m_rowCount;
+		const size_t last = source->rowCount();
+		if (m_query.isEmpty() || (last <= first))
+		{
+			return;
+		}
+
+		m_appendedScan.start([source = std::move(source), searcher = m_searcher, first, last, threadCount = GetThreadCount(threadCount)](std::stop_token stopToken)
+			-> Optional<std::pair<size_t, Array<FindMatch>>>
+		{
+			const auto* store = dynamic_cast<const ColumnarStore*>(source.get());
+			const Array<ColumnPlan> plans = (store ? MakePlans(*store, searcher) : Array<ColumnPlan>{});
+
+			Array<Array<FindMatch>> pieces((last - first + ChunkRows - 1) / ChunkRows);
+			ParallelFor(pieces.size(), threadCount, [&](size_t index)
+			{
+				if (stopToken.stop_requested())
+				{
+					return;
+				}
+
+				const size_t pieceFirst = (first + index * ChunkRows);
+				ScanRows(*source, store, plans, searcher, pieceFirst, Min(pieceFirst + ChunkRows, last), pieces[index]);
+			});
+
+			if (stopToken.stop_requested())
+			{
+				return none;
+			}
+
+			Array<FindMatch> matches;
+			for (const auto& piece : pieces)
+			{
+				matches.insert(matches.end(), piece.begin(), piece.end());
+			}
+			return std::pair{ last, std::move(matches) };
+		});
+	}
+
+	bool CellFinder::mergeAppendedRows()
+	{
+		auto result = m_appendedScan.takeResult();
+		if (not result)
+		{
+			return false;
+		}
+
+		// 探しているスレッドは無いので、塊をこのスレッドで書き換えてよい
+		const auto& [rowCount, matches] = *result;
+		m_rowCount = rowCount;
+		while (m_chunks.size() < ((rowCount + ChunkRows - 1) / ChunkRows))
+		{
+			m_chunks.emplace_back().ready.store(true, std::memory_order_release);
+		}
+		for (const auto& match : matches)
+		{
+			m_chunks[match.row / ChunkRows].matches.push_back(match);
+		}
+		m_matchCount += matches.size();
+		m_finishedChunks = m_chunks.size();
+		return true;
+	}
+
+	void CellFinder::rescanCell(const ICellSource& source, size_t row, size_t column)
+	{
+		assert(not isBusy());
+		if (m_query.isEmpty() || (m_rowCount <= row))
+		{
+			return;
+		}
+
+		bool found;
+		if (const auto text = source.view(row, column))
+		{
+			found = m_searcher.contains(*text);
+		}
+		else
+		{
+			CellWindow window;
+			window.reset({ row, (row + 1) }, { column, (column + 1) });
+			source.fetch(window);
+			found = m_searcher.contains(StringView{ window.at(row, column) });
+		}
+
+		Array<FindMatch>& matches = m_chunks[row / ChunkRows].matches;
+		const FindMatch match{ row, column };
+		const auto it = std::lower_bound(matches.begin(), matches.end(), match);
+		const bool listed = ((it != matches.end()) && (*it == match));
+		if (found && (not listed))
+		{
+			matches.insert(it, match);
+			++m_matchCount;
+		}
+		else if ((not found) && listed)
+		{
+			matches.erase(it);
+			--m_matchCount;
+		}
+	}
+
+	bool CellFinder::isBusy() const noexcept
+	{
+		return (m_thread.isBusy() || m_appendedScan.isBusy());
+	}
+
+	const String& CellFinder::query() const noexcept
+	{
+		return m_query;
+	}
+
+	double CellFinder::getProgress() const noexcept
+	{
+		if (m_chunks.empty())
+		{
+			return 1.0;
+		}
+		return (static_cast<double>(m_finishedChunks) / m_chunks.size());
+	}
+
+	size_t CellFinder::getMatchCount() const noexcept
+	{
+		return m_matchCount;
+	}
+
+	bool CellFinder::isMatch(size_t row, size_t column) const
+	{
+		const size_t index = (row / ChunkRows);
+		if (m_chunks.size() <= index)
+		{
+			return false;
+		}
+
+		const Chunk& chunk = m_chunks[index];
+		if (not chunk.ready.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		return std::binary_search(chunk.matches.begin(), chunk.matches.end(), FindMatch{ row, column });
+	}
+
+	Array<FindMatch> CellFinder::getMatches() const
+	{
+		Array<FindMatch> matches;
+		matches.reserve(m_matchCount);
+		for (const auto& chunk : m_chunks)
+		{
+			if (chunk.ready.load(std::memory_order_acquire))
+			{
+				matches.insert(matches.end(), chunk.matches.begin(), chunk.matches.end());
+			}
+		}
+		return matches;
+	}
+
+	void CellFinder::eraseLeadingRows(size_t count)
+	{
+		assert(not isBusy());
+		if (m_chunks.empty() || (count == 0))
+		{
+			return;
+		}
+
+		// 塊は行の位置で分けているので、ずらした位置で分け直す
+		const Array<FindMatch> matches = getMatches();
+		m_rowCount -= Min(count, m_rowCount);
+		m_chunks = std::deque<Chunk>((m_rowCount + ChunkRows - 1) / ChunkRows);
+		m_matchCount = 0;
+		for (const auto& match : matches)
+		{
+			if (count <= match.row)
+			{
+				m_chunks[(match.row - count) / ChunkRows].matches.push_back({ (match.row - count), match.column });
+				++m_matchCount;
+			}
+		}
+		for (auto& chunk : m_chunks)
+		{
+			chunk.ready.store(true, std::memory_order_release);
+		}
+		m_finishedChunks = m_chunks.size();
+	}
+}
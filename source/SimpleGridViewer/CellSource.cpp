@@ -0,0 +1,162 @@
+﻿# include "SimpleGridViewer/CellSource.hpp"
+
+namespace SimpleGridViewer
+{
+	void CellWindow::reset(const IndexRange& rows, const IndexRange& columns)
+	{
+		m_rows = rows;
+		m_columns = columns;
+		m_cells.resize(rows.size() * columns.size());
+	}
+
+	const IndexRange& CellWindow::rows() const noexcept
+	{
+		return m_rows;
+	}
+
+	const IndexRange& CellWindow::columns() const noexcept
+	{
+		return m_columns;
+	}
+
+	bool CellWindow::contains(size_t row, size_t column) const noexcept
+	{
+		return (m_rows.contains(row) && m_columns.contains(column));
+	}
+
+	String& CellWindow::at(size_t row, size_t column)
+	{
+		assert(contains(row, column));
+		return m_cells[(row - m_rows.first) * m_columns.size() + (column - m_columns.first)];
+	}
+
+	const String& CellWindow::at(size_t row, size_t column) const
+	{
+		assert(contains(row, column));
+		return m_cells[(row - m_rows.first) * m_columns.size() + (column - m_columns.first)];
+	}
+
+	GridCellSource::GridCellSource(const Size& size)
+		: m_values(size) {}
+
+	GridCellSource::GridCellSource(Grid<String> values)
+		: m_values(std::move(values)) {}
+
+	size_t GridCellSource::rowCount() const
+	{
+		return m_values.height();
+	}
+
+	size_t GridCellSource::columnCount() const
+	{
+		return m_values.width();
+	}
+
+	uint64 GridCellSource::version() const
+	{
+		return m_version;
+	}
+
+	void GridCellSource::fetch(CellWindow& window) const
+	{
+		for (size_t row = window.rows().first; row < window.rows().last; ++row)
+		{
+			for (size_t column = window.columns().first; column < window.columns().last; ++column)
+			{
+				window.at(row, column) = m_values[row][column];
+			}
+		}
+	}
+
+	Optional<StringView> GridCellSource::view(size_t row, size_t column) const
+	{
+		if (row >= m_values.height() || column >= m_values.width())
+		{
+			return none;
+		}
+		return StringView{ m_values[row][column] };
+	}
+
+	bool GridCellSource::setCell(size_t row, size_t column, StringView value)
+	{
+		if (row >= m_values.height() || column >= m_values.width())
+		{
+			return false;
+		}
+		m_values[row][column].assign(value);
+		++m_version;
+		return true;
+	}
+
+	const Grid<String>& GridCellSource::values() const noexcept
+	{
+		return m_values;
+	}
+
+	void GridCellSource::setValues(const Grid<String>& values)
+	{
+		const size_t rowCount = Min(values.height(), m_values.height());
+		const size_t columnCount = Min(values.width(), m_values.width());
+
+		for (size_t row = 0; row < rowCount; ++row)
+		{
+			for (size_t column = 0; column < columnCount; ++column)
+			{
+				m_values[row][column] = values[row][column];
+			}
+		}
+		++m_version;
+	}
+
+	void GridCellSource::setValues(Grid<String>&& values)
+	{
+		if (values.size() == m_values.size())
+		{
+			m_values = std::move(values);
+			++m_version;
+			return;
+		}
+
+		const size_t rowCount = Min(values.height(), m_values.height());
+		const size_t columnCount = Min(values.width(), m_values.width());
+
+		for (size_t row = 0; row < rowCount; ++row)
+		{
+			for (size_t column = 0; column < columnCount; ++column)
+			{
+				m_values[row][column] = std::move(values[row][column]);
+			}
+		}
+		++m_version;
+	}
+
+	void GridCellSource::setRegion(const Point& topLeft, const Grid<String>& values)
+	{
+		const int64 firstRow = Max<int64>(topLeft.y, 0);
+		const int64 firstColumn = Max<int64>(topLeft.x, 0);
+		const int64 lastRow = Min<int64>(topLeft.y + static_cast<int64>(values.height()), m_values.height());
+		const int64 lastColumn = Min<int64>(topLeft.x + static_cast<int64>(values.width()), m_values.width());
+
+		if (lastRow <= firstRow || lastColumn <= firstColumn)
+		{
+			return;
+		}
+
+		for (int64 row = firstRow; row < lastRow; ++row)
+		{
+			const String* source = &values[row - topLeft.y][firstColumn - topLeft.x];
+			String* destination = &m_values[row][firstColumn];
+			std::copy(source, source + (lastColumn - firstColumn), destination);
+		}
+		++m_version;
+	}
+
+	Optional<String> GridCellSource::getValue(size_t row, size_t column) const
+	{
+		if (row >= m_values.height() || column >= m_values.width())
+		{
+			return none;
+		}
+		return m_values[row][column];
+	}
+}
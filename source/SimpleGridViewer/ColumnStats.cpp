@@ -0,0 +1,777 @@
+﻿# include <bit>
+# include "SimpleGridViewer/ColumnStats.hpp"
+# include "SimpleGridViewer/ColumnarStore.hpp"
+# include "SimpleGridViewer/Parallel.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace
+	{
+		// 中断に早く応じられるよう、スレッド数より細かく分ける
+		constexpr size_t ChunksPerThread = 4;
+
+		// double 以外の数値の列を変換しておく配列の大きさ
+		constexpr size_t ConvertBlockSize = 256;
+
+		// 行を 64 行単位で分けたときのチャンクの数
+		size_t GetChunkCount(size_t rowCount, size_t threadCount)
+		{
+			const size_t wordCount = ((rowCount + WordBits - 1) / WordBits);
+			return Clamp<size_t>((wordCount / MinChunkWords), 1, (threadCount * ChunksPerThread));
+		}
+
+		// chunkCount 個に分けたうちの index 番目のチャンクの行の範囲。境界は 64 の倍数になる
+		IndexRange GetChunkRange(size_t rowCount, size_t chunkCount, size_t index)
+		{
+			const size_t wordCount = ((rowCount + WordBits - 1) / WordBits);
+			return{ Min(rowCount, (wordCount * index / chunkCount * WordBits)), Min(rowCount, (wordCount * (index + 1) / chunkCount * WordBits)) };
+		}
+
+		// splitmix64 の仕上げ。下位のビットしか変わらない値も全体に散らす
+		uint64 MixHash(uint64 x) noexcept
+		{
+			x ^= (x >> 30);
+			x *= 0xbf58476d1ce4e5b9ull;
+			x ^= (x >> 27);
+			x *= 0x94d049bb133111ebull;
+			x ^= (x >> 31);
+			return x;
+		}
+
+		uint64 HashNumber(double value) noexcept
+		{
+			// -0.0 と 0.0 を同じ値として数える
+			return MixHash(std::bit_cast<uint64>(value + 0.0));
+		}
+
+		struct Moments
+		{
+			size_t count = 0;
+
+			double sum = 0.0;
+
+			double min = std::numeric_limits<double>::infinity();
+
+			double max = -std::numeric_limits<double>::infinity();
+
+			void merge(const Moments& other) noexcept
+			{
+				count += other.count;
+				sum += other.sum;
+				min = Min(min, other.min);
+				max = Max(max, other.max);
+			}
+		};
+
+		// values の合計と最小・最大を moments に加える
+		void Accumulate(const double* values, size_t count, Moments& moments) noexcept
+		{
+			size_t i = 0;
+			double sum = 0.0;
+			double min = moments.min;
+			double max = moments.max;
+
+		# if SIMPLEGRIDVIEWER_AVX2
+			if (8 <= count)
+			{
+				// 加算の依存を切るため、合計は 2 本に分けて足す
+				__m256d sum0 = _mm256_setzero_pd();
+				__m256d sum1 = _mm256_setzero_pd();
+				__m256d min4 = _mm256_set1_pd(min);
+				__m256d max4 = _mm256_set1_pd(max);
+				for (; (i + 8) <= count; i += 8)
+				{
+					const __m256d v0 = _mm256_loadu_pd(values + i);
+					const __m256d v1 = _mm256_loadu_pd(values + i + 4);
+					sum0 = _mm256_add_pd(sum0, v0);
+					sum1 = _mm256_add_pd(sum1, v1);
+					min4 = _mm256_min_pd(min4, _mm256_min_pd(v0, v1));
+					max4 = _mm256_max_pd(max4, _mm256_max_pd(v0, v1));
+				}
+
+				alignas(32) double lanes[3][4];
+				_mm256_store_pd(lanes[0], _mm256_add_pd(sum0, sum1));
+				_mm256_store_pd(lanes[1], min4);
+				_mm256_store_pd(lanes[2], max4);
+				for (size_t k = 0; k < 4; ++k)
+				{
+					sum += lanes[0][k];
+					min = Min(min, lanes[1][k]);
+					max = Max(max, lanes[2][k]);
+				}
+			}
+		# elif SIMPLEGRIDVIEWER_SSE2
+			if (4 <= count)
+			{
+				__m128d sum0 = _mm_setzero_pd();
+				__m128d sum1 = _mm_setzero_pd();
+				__m128d min2 = _mm_set1_pd(min);
+				__m128d max2 = _mm_set1_pd(max);
+				for (; (i + 4) <= count; i += 4)
+				{
+					const __m128d v0 = _mm_loadu_pd(values + i);
+					const __m128d v1 = _mm_loadu_pd(values + i + 2);
+					sum0 = _mm_add_pd(sum0, v0);
+					sum1 = _mm_add_pd(sum1, v1);
+					min2 = _mm_min_pd(min2, _mm_min_pd(v0, v1));
+					max2 = _mm_max_pd(max2, _mm_max_pd(v0, v1));
+				}
+
+				alignas(16) double lanes[3][2];
+				_mm_store_pd(lanes[0], _mm_add_pd(sum0, sum1));
+				_mm_store_pd(lanes[1], min2);
+				_mm_store_pd(lanes[2], max2);
+				for (size_t k = 0; k < 2; ++k)
+				{
+					sum += lanes[0][k];
+					min = Min(min, lanes[1][k]);
+					max = Max(max, lanes[2][k]);
+				}
+			}
+		# endif
+
+			for (; i < count; ++i)
+			{
+				sum += values[i];
+				min = Min(min, values[i]);
+				max = Max(max, values[i]);
+			}
+
+			moments.count += count;
+			moments.sum += sum;
+			moments.min = min;
+			moments.max = max;
+		}
+
+		// 平均からの差の 2 乗の合計。分散は 1 回目に平均を求めてから 2 回目に求めると、桁落ちしにくい
+		double SumSquaredDeviations(const double* values, size_t count, double mean) noexcept
+		{
+			size_t i = 0;
+			double result = 0.0;
+
+		# if SIMPLEGRIDVIEWER_AVX2
+			if (8 <= count)
+			{
+				const __m256d mean4 = _mm256_set1_pd(mean);
+				__m256d sum0 = _mm256_setzero_pd();
+				__m256d sum1 = _mm256_setzero_pd();
+				for (; (i + 8) <= count; i += 8)
+				{
+					const __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(values + i), mean4);
+					const __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(values + i + 4), mean4);
+					sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(d0, d0));
+					sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(d1, d1));
+				}
+
+				alignas(32) double lanes[4];
+				_mm256_store_pd(lanes, _mm256_add_pd(sum0, sum1));
+				result = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+			}
+		# elif SIMPLEGRIDVIEWER_SSE2
+			if (4 <= count)
+			{
+				const __m128d mean2 = _mm_set1_pd(mean);
+				__m128d sum0 = _mm_setzero_pd();
+				__m128d sum1 = _mm_setzero_pd();
+				for (; (i + 4) <= count; i += 4)
+				{
+					const __m128d d0 = _mm_sub_pd(_mm_loadu_pd(values + i), mean2);
+					const __m128d d1 = _mm_sub_pd(_mm_loadu_pd(values + i + 2), mean2);
+					sum0 = _mm_add_pd(sum0, _mm_mul_pd(d0, d0));
+					sum1 = _mm_add_pd(sum1, _mm_mul_pd(d1, d1));
+				}
+
+				alignas(16) double lanes[2];
+				_mm_store_pd(lanes, _mm_add_pd(sum0, sum1));
+				result = (lanes[0] + lanes[1]);
+			}
+		# endif
+
+			for (; i < count; ++i)
+			{
+				const double d = (values[i] - mean);
+				result += (d * d);
+			}
+			return result;
+		}
+
+		// [begin, end) のうち値のある行が連続する範囲ごとに function(first, last) を呼ぶ
+		template <class Function>
+		void ForEachValidRun(const ValidityBitmap& validity, size_t begin, size_t end, Function function)
+		{
+			const auto& words = validity.words();
+			if (words.isEmpty())
+			{
+				if (begin < end)
+				{
+					function(begin, end);
+				}
+				return;
+			}
+
+			// value のビットが次に現れる行。無ければ end
+			const auto find = [&](size_t row, bool value)
+			{
+				while (row < end)
+				{
+					const uint64 word = (value ? words[row / WordBits] : ~words[row / WordBits]);
+					const uint64 bits = (word >> (row % WordBits));
+					if (bits)
+					{
+						return Min(end, (row + std::countr_zero(bits)));
+					}
+					row = ((row / WordBits + 1) * WordBits);
+				}
+				return end;
+			};
+
+			for (size_t row = find(begin, true); row < end;)
+			{
+				const size_t last = find(row, false);
+				function(row, last);
+				row = find(last, true);
+			}
+		}
+
+		// values[first, last) を double の配列として function(const double*, size_t) に渡す
+		template <class Type, class Function>
+		void ForEachDoubleBlock(const Type* values, size_t first, size_t last, Function function)
+		{
+			if constexpr (std::is_same_v<Type, double>)
+			{
+				function((values + first), (last - first));
+			}
+			else
+			{
+				double buffer[ConvertBlockSize];
+				for (size_t i = first; i < last; i += ConvertBlockSize)
+				{
+					const size_t count = Min(ConvertBlockSize, (last - i));
+					for (size_t k = 0; k < count; ++k)
+					{
+						buffer[k] = static_cast<double>(values[i + k]);
+					}
+					function(buffer, count);
+				}
+			}
+		}
+
+		struct Partial
+		{
+			Moments moments;
+
+			double deviations = 0.0;
+
+			HyperLogLog sketch;
+		};
+
+		// 数値の集計結果を stats に書き込む
+		void SetNumericStats(const Moments& moments, double deviations, ColumnStats& stats)
+		{
+			stats.numeric = true;
+			stats.count = moments.count;
+			if (moments.count == 0)
+			{
+				return;
+			}
+
+			stats.min = moments.min;
+			stats.max = moments.max;
+			stats.sum = moments.sum;
+			stats.mean = (moments.sum / moments.count);
+			stats.stddev = ((1 < moments.count) ? std::sqrt(deviations / (moments.count - 1)) : 0.0);
+		}
+
+		size_t ToDistinctCount(const HyperLogLog& sketch, size_t count)
+		{
+			return Min(count, static_cast<size_t>(std::llround(sketch.estimate())));
+		}
+
+		template <class Type>
+		bool ComputeNumeric(const NumericColumn<Type>& column, size_t rowCount, size_t threadCount, std::stop_token stopToken, ColumnStats& stats)
+		{
+			const Type* values = column.values().data();
+			const ValidityBitmap& validity = column.validity();
+			const size_t chunkCount = GetChunkCount(rowCount, threadCount);
+			Array<Partial> partials(chunkCount);
+
+			ParallelFor(chunkCount, threadCount, [&](size_t i)
+			{
+				if (stopToken.stop_requested())
+				{
+					return;
+				}
+
+				const IndexRange range = GetChunkRange(rowCount, chunkCount, i);
+				Partial& partial = partials[i];
+				ForEachValidRun(validity, range.first, range.last, [&](size_t first, size_t last)
+				{
+					ForEachDoubleBlock(values, first, last, [&](const double* block, size_t count)
+					{
+						Accumulate(block, count, partial.moments);
+						for (size_t k = 0; k < count; ++k)
+						{
+							partial.sketch.add(HashNumber(block[k]));
+						}
+					});
+				});
+			});
+
+			Moments moments;
+			HyperLogLog sketch;
+			for (const auto& partial : partials)
+			{
+				moments.merge(partial.moments);
+				sketch.merge(partial.sketch);
+			}
+			const double mean = (moments.count ? (moments.sum / moments.count) : 0.0);
+
+			ParallelFor(chunkCount, threadCount, [&](size_t i)
+			{
+				if (stopToken.stop_requested())
+				{
+					return;
+				}
+
+				const IndexRange range = GetChunkRange(rowCount, chunkCount, i);
+				ForEachValidRun(validity, range.first, range.last, [&](size_t first, size_t last)
+				{
+					ForEachDoubleBlock(values, first, last, [&](const double* block, size_t count)
+					{
+						partials[i].deviations += SumSquaredDeviations(block, count, mean);
+					});
+				});
+			});
+
+			if (stopToken.stop_requested())
+			{
+				return false;
+			}
+
+			double deviations = 0.0;
+			for (const auto& partial : partials)
+			{
+				deviations += partial.deviations;
+			}
+
+			SetNumericStats(moments, deviations, stats);
+			stats.nullCount = (rowCount - moments.count);
+			stats.distinctCount = ToDistinctCount(sketch, moments.count);
+			return true;
+		}
+
+		bool ComputeBool(const BoolColumn& column, size_t rowCount, std::stop_token stopToken, ColumnStats& stats)
+		{
+			size_t count = 0;
+			size_t trueCount = 0;
+			for (size_t row = 0; row < rowCount; ++row)
+			{
+				if (((row % (FetchRows * 16)) == 0) && stopToken.stop_requested())
+				{
+					return false;
+				}
+
+				if (not column.isNull(row))
+				{
+					++count;
+					trueCount += column.get(row);
+				}
+			}
+
+			// 0 と 1 だけなので、平均からの差の 2 乗の合計は式で求まる
+			Moments moments;
+			moments.count = count;
+			moments.sum = static_cast<double>(trueCount);
+			moments.min = ((trueCount < count) ? 0.0 : 1.0);
+			moments.max = (trueCount ? 1.0 : 0.0);
+			const double mean = (count ? (moments.sum / count) : 0.0);
+
+			SetNumericStats(moments, (trueCount * (1.0 - mean)), stats);
+			stats.nullCount = (rowCount - count);
+			stats.distinctCount = ((trueCount != 0) + (trueCount != count));
+			return true;
+		}
+
+		// 辞書の各文字列が使われているかを調べれば、異なる値の数は正確に求まる
+		bool ComputeDictionary(const DictionaryColumn& column, size_t rowCount, size_t threadCount, std::stop_token stopToken, ColumnStats& stats)
+		{
+			const auto& dictionary = column.dictionary();
+			const auto& codes = column.codes();
+			const size_t chunkCount = GetChunkCount(rowCount, threadCount);
+			Array<Array<uint8>> used(chunkCount, Array<uint8>(dictionary.size()));
+
+			ParallelFor(chunkCount, threadCount, [&](size_t i)
+			{
+				if (stopToken.stop_requested())
+				{
+					return;
+				}
+
+				const IndexRange range = GetChunkRange(rowCount, chunkCount, i);
+				ForEachValidRun(column.validity(), range.first, range.last, [&](size_t first, size_t last)
+				{
+					for (size_t row = first; row < last; ++row)
+					{
+						used[i][codes[row]] = 1;
+					}
+				});
+			});
+
+			if (stopToken.stop_requested())
+			{
+				return false;
+			}
+
+			// 値のあるセルの数は符号ごとの出現数を数えずに、空の文字列の分だけを数え直す
+			size_t emptyCount = 0;
+			const auto emptyCode = std::find(dictionary.begin(), dictionary.end(), String{});
+			if (emptyCode != dictionary.end())
+			{
+				const DictionaryColumn::Code code = static_cast<DictionaryColumn::Code>(emptyCode - dictionary.begin());
+				ForEachValidRun(column.validity(), 0, rowCount, [&](size_t first, size_t last)
+				{
+					emptyCount += std::count(codes.begin() + first, codes.begin() + last, code);
+				});
+			}
+
+			const String* min = nullptr;
+			const String* max = nullptr;
+			for (size_t code = 0; code < dictionary.size(); ++code)
+			{
+				const bool isUsed = std::any_of(used.begin(), used.end(), [&](const Array<uint8>& chunk) { return chunk[code]; });
+				if ((not isUsed) || dictionary[code].isEmpty())
+				{
+					continue;
+				}
+
+				++stats.distinctCount;
+				if ((not min) || (dictionary[code] < *min))
+				{
+					min = &dictionary[code];
+				}
+				if ((not max) || (*max < dictionary[code]))
+				{
+					max = &dictionary[code];
+				}
+			}
+
+			stats.nullCount = (column.validity().nullCount() + emptyCount);
+			stats.count = (rowCount - stats.nullCount);
+			stats.minText = (min ? *min : String{});
+			stats.maxText = (max ? *max : String{});
+			return true;
+		}
+
+		bool ComputeString(const StringColumn& column, size_t rowCount, size_t threadCount, std::stop_token stopToken, ColumnStats& stats)
+		{
+			struct TextPartial
+			{
+				size_t count = 0;
+
+				Optional<std::string_view> min;
+
+				Optional<std::string_view> max;
+
+				HyperLogLog sketch;
+			};
+
+			const size_t chunkCount = GetChunkCount(rowCount, threadCount);
+			Array<TextPartial> partials(chunkCount);
+
+			ParallelFor(chunkCount, threadCount, [&](size_t i)
+			{
+				if (stopToken.stop_requested())
+				{
+					return;
+				}
+
+				// UTF-8 のバイト列の大小は Unicode の符号位置の大小と一致するので、変換せずに比べる
+				const IndexRange range = GetChunkRange(rowCount, chunkCount, i);
+				TextPartial& partial = partials[i];
+				ForEachValidRun(column.validity(), range.first, range.last, [&](size_t first, size_t last)
+				{
+					for (size_t row = first; row < last; ++row)
+					{
+						const std::string_view value = column.get(row);
+						if (value.empty())
+						{
+							continue;
+						}
+
+						++partial.count;
+						partial.min = (partial.min ? Min(*partial.min, value) : value);
+						partial.max = (partial.max ? Max(*partial.max, value) : value);
+						partial.sketch.add(MixHash(std::hash<std::string_view>{}(value)));
+					}
+				});
+			});
+
+			if (stopToken.stop_requested())
+			{
+				return false;
+			}
+
+			TextPartial total;
+			for (const auto& partial : partials)
+			{
+				total.count += partial.count;
+				if (partial.min)
+				{
+					total.min = (total.min ? Min(*total.min, *partial.min) : *partial.min);
+					total.max = (total.max ? Max(*total.max, *partial.max) : *partial.max);
+				}
+				total.sketch.merge(partial.sketch);
+			}
+
+			stats.count = total.count;
+			stats.nullCount = (rowCount - total.count);
+			stats.minText = (total.min ? Unicode::FromUTF8(*total.min) : String{});
+			stats.maxText = (total.max ? Unicode::FromUTF8(*total.max) : String{});
+			stats.distinctCount = ToDistinctCount(total.sketch, total.count);
+			return true;
+		}
+
+		// 文字列を 1 つずつ数値に変換して集計する
+		bool ComputeGeneric(const ICellSource& source, size_t column, size_t threadCount, std::stop_token stopToken, ColumnStats& stats)
+		{
+			struct TextPartial
+			{
+				size_t count = 0;
+
+				String min;
+
+				String max;
+
+				HyperLogLog sketch;
+
+				// 全て数値として解釈できる間だけ値を溜める
+				bool numeric = true;
+
+				Array<double> values;
+
+				Moments moments;
+
+				double deviations = 0.0;
+			};
+
+			const size_t rowCount = source.rowCount();
+			const size_t chunkCount = GetChunkCount(rowCount, threadCount);
+			Array<TextPartial> partials(chunkCount);
+
+			ParallelFor(chunkCount, threadCount, [&](size_t i)
+			{
+				const IndexRange range = GetChunkRange(rowCount, chunkCount, i);
+				TextPartial& partial = partials[i];
+				CellWindow window;
+				for (size_t first = range.first; first < range.last; first += FetchRows)
+				{
+					if (stopToken.stop_requested())
+					{
+						return;
+					}
+
+					const size_t last = Min(range.last, (first + FetchRows));
+					window.reset({ first, last }, { column, (column + 1) });
+					source.fetch(window);
+
+					for (size_t row = first; row < last; ++row)
+					{
+						const String& value = window.at(row, column);
+						if (value.isEmpty())
+						{
+							continue;
+						}
+
+						if ((partial.count == 0) || (value < partial.min))
+						{
+							partial.min = value;
+						}
+						if ((partial.count == 0) || (partial.max < value))
+						{
+							partial.max = value;
+						}
+						++partial.count;
+						partial.sketch.add(MixHash(std::hash<StringView>{}(value)));
+
+						if (partial.numeric)
+						{
+							if (const auto number = ParseOpt<double>(value))
+							{
+								partial.values.push_back(*number);
+							}
+							else
+							{
+								partial.numeric = false;
+								partial.values = Array<double>{};
+							}
+						}
+					}
+				}
+
+				Accumulate(partial.values.data(), partial.values.size(), partial.moments);
+			});
+
+			if (stopToken.stop_requested())
+			{
+				return false;
+			}
+
+			TextPartial total;
+			for (const auto& partial : partials)
+			{
+				if (partial.count)
+				{
+					if ((total.count == 0) || (partial.min < total.min))
+					{
+						total.min = partial.min;
+					}
+					if ((total.count == 0) || (total.max < partial.max))
+					{
+						total.max = partial.max;
+					}
+				}
+				total.count += partial.count;
+				total.numeric = (total.numeric && partial.numeric);
+				total.moments.merge(partial.moments);
+				total.sketch.merge(partial.sketch);
+			}
+
+			stats.count = total.count;
+			stats.nullCount = (rowCount - total.count);
+			stats.distinctCount = ToDistinctCount(total.sketch, total.count);
+
+			if (total.numeric && total.count)
+			{
+				const double mean = (total.moments.sum / total.moments.count);
+				ParallelFor(chunkCount, threadCount, [&](size_t i)
+				{
+					partials[i].deviations = SumSquaredDeviations(partials[i].values.data(), partials[i].values.size(), mean);
+				});
+
+				for (const auto& partial : partials)
+				{
+					total.deviations += partial.deviations;
+				}
+				SetNumericStats(total.moments, total.deviations, stats);
+			}
+			else
+			{
+				stats.minText = std::move(total.min);
+				stats.maxText = std::move(total.max);
+			}
+			return true;
+		}
+	}
+
+	void HyperLogLog::add(uint64 hash) noexcept
+	{
+		// 上位のビットでレジスタを選び、残りのビットの先頭の 0 の数を記録する
+		const size_t index = static_cast<size_t>(hash >> (64 - Precision));
+		const uint64 rest = ((hash << Precision) | (uint64{ 1 } << (Precision - 1)));
+		const uint8 rank = static_cast<uint8>(std::countl_zero(rest) + 1);
+		m_registers[index] = Max(m_registers[index], rank);
+	}
+
+	void HyperLogLog::merge(const HyperLogLog& other) noexcept
+	{
+		for (size_t i = 0; i < RegisterCount; ++i)
+		{
+			m_registers[i] = Max(m_registers[i], other.m_registers[i]);
+		}
+	}
+
+	double HyperLogLog::estimate() const noexcept
+	{
+		constexpr double m = static_cast<double>(RegisterCount);
+		const double alpha = (0.7213 / (1.0 + 1.079 / m));
+
+		double sum = 0.0;
+		size_t zeros = 0;
+		for (const uint8 value : m_registers)
+		{
+			sum += std::ldexp(1.0, -static_cast<int32>(value));
+			zeros += (value == 0);
+		}
+
+		// 値が少ない間は、空のレジスタの割合から見積もる方が正確
+		const double estimate = (alpha * m * m / sum);
+		if ((estimate <= (2.5 * m)) && zeros)
+		{
+			return (m * std::log(m / zeros));
+		}
+		return estimate;
+	}
+
+	void ColumnStatsCalculator::start(std::shared_ptr<const ICellSource> source, size_t column, size_t threadCount)
+	{
+		assert(source);
+		m_task.start([source = std::move(source), column, threadCount](std::stop_token stopToken)
+		{
+			return Compute(*source, column, threadCount, stopToken);
+		});
+	}
+
+	void ColumnStatsCalculator::cancel()
+	{
+		m_task.cancel();
+	}
+
+	bool ColumnStatsCalculator::isBusy() const noexcept
+	{
+		return m_task.isBusy();
+	}
+
+	Optional<ColumnStats> ColumnStatsCalculator::takeResult()
+	{
+		return m_task.takeResult();
+	}
+
+	Optional<ColumnStats> ColumnStatsCalculator::Compute(const ICellSource& source, size_t column, size_t threadCount, std::stop_token stopToken)
+	{
+		if (source.columnCount() <= column)
+		{
+			return none;
+		}
+
+		threadCount = GetThreadCount(threadCount);
+		const size_t rowCount = source.rowCount();
+
+		ColumnStats stats;
+		stats.column = column;
+
+		bool completed;
+		if (const auto* store = dynamic_cast<const ColumnarStore*>(&source))
+		{
+			completed = std::visit([&](const auto& values)
+			{
+				using Values = std::decay_t<decltype(values)>;
+				if constexpr (std::is_same_v<Values, Int64Column> || std::is_same_v<Values, DoubleColumn>)
+				{
+					return ComputeNumeric(values, rowCount, threadCount, stopToken, stats);
+				}
+				else if constexpr (std::is_same_v<Values, BoolColumn>)
+				{
+					return ComputeBool(values, rowCount, stopToken, stats);
+				}
+				else if constexpr (std::is_same_v<Values, DictionaryColumn>)
+				{
+					return ComputeDictionary(values, rowCount, threadCount, stopToken, stats);
+				}
+				else
+				{
+					return ComputeString(values, rowCount, threadCount, stopToken, stats);
+				}
+			}, store->column(column));
+		}
+		else
+		{
+			completed = ComputeGeneric(source, column, threadCount, stopToken, stats);
+		}
+
+		if (not completed)
+		{
+			return none;
+		}
+		return stats;
+	}
+}
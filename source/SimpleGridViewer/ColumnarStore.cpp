@@ -0,0 +1,954 @@
+﻿# include <charconv>
+# include "SimpleGridViewer/ColumnarStore.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace
+	{
+		constexpr size_t BitsPerWord = 64;
+
+		bool GetBit(const Array<uint64>& bits, size_t index) noexcept
+		{
+			return ((bits[index / BitsPerWord] >> (index % BitsPerWord)) & 1);
+		}
+
+		void SetBit(Array<uint64>& bits, size_t index, bool value) noexcept
+		{
+			const uint64 mask = (uint64{ 1 } << (index % BitsPerWord));
+			if (value)
+			{
+				bits[index / BitsPerWord] |= mask;
+			}
+			else
+			{
+				bits[index / BitsPerWord] &= ~mask;
+			}
+		}
+
+		void PushBit(Array<uint64>& bits, size_t& size, bool value)
+		{
+			if ((size % BitsPerWord) == 0)
+			{
+				bits.push_back(0);
+			}
+			SetBit(bits, size++, value);
+		}
+
+		// 数値を整形したときの最大の長さより長い文字列は、整形し直しても元に戻らない
+		constexpr size_t NumberTextLength = 64;
+
+		// ASCII の範囲の文字だけを char に詰め直す。収まらなければ false
+		bool ToAscii(StringView text, char (&buffer)[NumberTextLength], std::string_view& result) noexcept
+		{
+			if (NumberTextLength < text.size())
+			{
+				return false;
+			}
+			for (size_t i = 0; i < text.size(); ++i)
+			{
+				if (0x7F < text[i])
+				{
+					return false;
+				}
+				buffer[i] = static_cast<char>(text[i]);
+			}
+			result = std::string_view{ buffer, text.size() };
+			return true;
+		}
+
+		std::string_view FormatNumber(int64 value, char (&buffer)[NumberTextLength]) noexcept
+		{
+			const auto [ptr, ec] = std::to_chars(buffer, buffer + NumberTextLength, value);
+			return std::string_view{ buffer, ((ec == std::errc{}) ? static_cast<size_t>(ptr - buffer) : 0) };
+		}
+
+		// 元の値に戻る最短の桁数で整形する。極端に大きいか小さい値以外は指数表記にしない
+		std::string_view FormatNumber(double value, char (&buffer)[NumberTextLength]) noexcept
+		{
+			const double magnitude = std::abs(value);
+			const bool fixed = ((value == 0.0) || ((1e-6 <= magnitude) && (magnitude < 1e21)));
+			const auto [ptr, ec] = (fixed
+				? std::to_chars(buffer, buffer + NumberTextLength, value, std::chars_format::fixed)
+				: std::to_chars(buffer, buffer + NumberTextLength, value));
+			return std::string_view{ buffer, ((ec == std::errc{}) ? static_cast<size_t>(ptr - buffer) : 0) };
+		}
+
+		template <class Type>
+		Optional<Type> ParseNumber(std::string_view text) noexcept
+		{
+			if (text.empty() || NumberTextLength < text.size())
+			{
+				return none;
+			}
+			Type value{};
+			const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+			if (ec != std::errc{} || ptr != (text.data() + text.size()))
+			{
+				return none;
+			}
+
+			char buffer[NumberTextLength];
+			if (FormatNumber(value, buffer) != text)
+			{
+				return none;
+			}
+			return value;
+		}
+
+		// スタック上のバッファで整形してから out に書き込む。 out の確保済みの領域は再利用される
+		template <class Type>
+		void FormatNumber(Type value, String& out)
+		{
+			char buffer[NumberTextLength];
+			const std::string_view text = FormatNumber(value, buffer);
+
+			out.resize(text.size());
+			for (size_t i = 0; i < text.size(); ++i)
+			{
+				out[i] = static_cast<char32>(text[i]);
+			}
+		}
+
+		// 2^53 以下の整数は double でも同じ桁の文字列に整形されるので、 double として読み直さなくてよい
+		bool IsExactInDouble(int64 value) noexcept
+		{
+			constexpr int64 Limit = (int64{ 1 } << 53);
+			return ((-Limit <= value) && (value <= Limit));
+		}
+
+		// 列の値から型を推定する
+		ColumnType InferColumnType(const Grid<String>& values, size_t column)
+		{
+			ColumnTypeInference inference;
+			HashSet<StringView> distinct;
+
+			for (size_t row = 0; row < values.height(); ++row)
+			{
+				const String& text = values[row][column];
+				if (text.isEmpty())
+				{
+					continue;
+				}
+
+				inference.add(StringView{ text });
+
+				if (distinct.size() <= DictionaryLimit)
+				{
+					distinct.insert(text);
+				}
+			}
+
+			if (const auto type = inference.getType())
+			{
+				return *type;
+			}
+			else if (UseDictionary(distinct.size(), values.height()))
+			{
+				return ColumnType::Dictionary;
+			}
+			return ColumnType::String;
+		}
+
+		Column MakeColumn(const Grid<String>& values, size_t column)
+		{
+			const size_t rowCount = values.height();
+
+			switch (InferColumnType(values, column))
+			{
+			case ColumnType::Int64:
+			{
+				Int64Column result;
+				result.reserve(rowCount);
+				for (size_t row = 0; row < rowCount; ++row)
+				{
+					if (const auto value = ParseInt64(StringView{ values[row][column] }))
+					{
+						result.push(*value);
+					}
+					else
+					{
+						result.pushNull();
+					}
+				}
+				return result;
+			}
+			case ColumnType::Double:
+			{
+				DoubleColumn result;
+				result.reserve(rowCount);
+				for (size_t row = 0; row < rowCount; ++row)
+				{
+					if (const auto value = ParseDouble(StringView{ values[row][column] }))
+					{
+						result.push(*value);
+					}
+					else
+					{
+						result.pushNull();
+					}
+				}
+				return result;
+			}
+			case ColumnType::Bool:
+			{
+				BoolColumn result;
+				result.reserve(rowCount);
+				for (size_t row = 0; row < rowCount; ++row)
+				{
+					if (const auto value = ParseBool(StringView{ values[row][column] }))
+					{
+						result.push(*value);
+					}
+					else
+					{
+						result.pushNull();
+					}
+				}
+				return result;
+			}
+			case ColumnType::Dictionary:
+			{
+				DictionaryColumn result;
+				result.reserve(rowCount);
+				for (size_t row = 0; row < rowCount; ++row)
+				{
+					result.push(values[row][column]);
+				}
+				return result;
+			}
+			default:
+			{
+				StringColumn result;
+				result.reserve(rowCount, 0);
+				for (size_t row = 0; row < rowCount; ++row)
+				{
+					result.push(StringView{ values[row][column] });
+				}
+				return result;
+			}
+			}
+		}
+	}
+
+	size_t ValidityBitmap::size() const noexcept
+	{
+		return m_size;
+	}
+
+	size_t ValidityBitmap::nullCount() const noexcept
+	{
+		return m_nullCount;
+	}
+
+	bool ValidityBitmap::isValid(size_t index) const noexcept
+	{
+		return (m_bits.isEmpty() || GetBit(m_bits, index));
+	}
+
+	const Array<uint64>& ValidityBitmap::words() const noexcept
+	{
+		return m_bits;
+	}
+
+	void ValidityBitmap::push(bool valid)
+	{
+		if (m_bits.isEmpty())
+		{
+			if (valid)
+			{
+				++m_size;
+				return;
+			}
+
+			// 最初の null で、それまでの分をすべて有効としてビット列を作る
+			m_bits.assign(((m_size + BitsPerWord - 1) / BitsPerWord), ~uint64{ 0 });
+		}
+
+		PushBit(m_bits, m_size, valid);
+		m_nullCount += (not valid);
+	}
+
+	void ValidityBitmap::set(size_t index, bool valid)
+	{
+		if (isValid(index) == valid)
+		{
+			return;
+		}
+
+		if (m_bits.isEmpty())
+		{
+			m_bits.assign(((m_size + BitsPerWord - 1) / BitsPerWord), ~uint64{ 0 });
+		}
+
+		SetBit(m_bits, index, valid);
+
+		if (valid)
+		{
+			--m_nullCount;
+		}
+		else
+		{
+			++m_nullCount;
+		}
+	}
+
+	void ValidityBitmap::reserve(size_t size)
+	{
+		if (m_bits)
+		{
+			m_bits.reserve((size + BitsPerWord - 1) / BitsPerWord);
+		}
+	}
+
+	void ValidityBitmap::append(const ValidityBitmap& other)
+	{
+		if (other.m_nullCount == 0 && m_bits.isEmpty())
+		{
+			m_size += other.m_size;
+			return;
+		}
+
+		for (size_t i = 0; i < other.m_size; ++i)
+		{
+			push(other.isValid(i));
+		}
+	}
+
+	size_t ValidityBitmap::memoryUsage() const noexcept
+	{
+		return (m_bits.capacity() * sizeof(uint64));
+	}
+
+	size_t BoolColumn::size() const noexcept
+	{
+		return m_size;
+	}
+
+	bool BoolColumn::isNull(size_t row) const noexcept
+	{
+		return not m_validity.isValid(row);
+	}
+
+	bool BoolColumn::get(size_t row) const noexcept
+	{
+		return GetBit(m_bits, row);
+	}
+
+	const ValidityBitmap& BoolColumn::validity() const noexcept
+	{
+		return m_validity;
+	}
+
+	void BoolColumn::reserve(size_t size)
+	{
+		m_bits.reserve((size + BitsPerWord - 1) / BitsPerWord);
+		m_validity.reserve(size);
+	}
+
+	void BoolColumn::push(bool value)
+	{
+		PushBit(m_bits, m_size, value);
+		m_validity.push(true);
+	}
+
+	void BoolColumn::pushNull()
+	{
+		PushBit(m_bits, m_size, false);
+		m_validity.push(false);
+	}
+
+	void BoolColumn::set(size_t row, bool value)
+	{
+		SetBit(m_bits, row, value);
+		m_validity.set(row, true);
+	}
+
+	void BoolColumn::setNull(size_t row)
+	{
+		SetBit(m_bits, row, false);
+		m_validity.set(row, false);
+	}
+
+	void BoolColumn::append(const BoolColumn& other)
+	{
+		for (size_t i = 0; i < other.m_size; ++i)
+		{
+			PushBit(m_bits, m_size, other.get(i));
+		}
+		m_validity.append(other.m_validity);
+	}
+
+	size_t BoolColumn::memoryUsage() const noexcept
+	{
+		return (m_bits.capacity() * sizeof(uint64) + m_validity.memoryUsage());
+	}
+
+	size_t DictionaryColumn::size() const noexcept
+	{
+		return m_codes.size();
+	}
+
+	bool DictionaryColumn::isNull(size_t row) const noexcept
+	{
+		return not m_validity.isValid(row);
+	}
+
+	const String& DictionaryColumn::get(size_t row) const noexcept
+	{
+		return m_dictionary[m_codes[row]];
+	}
+
+	DictionaryColumn::Code DictionaryColumn::getCode(size_t row) const noexcept
+	{
+		return m_codes[row];
+	}
+
+	const Array<DictionaryColumn::Code>& DictionaryColumn::codes() const noexcept
+	{
+		return m_codes;
+	}
+
+	const Array<String>& DictionaryColumn::dictionary() const noexcept
+	{
+		return m_dictionary;
+	}
+
+	const ValidityBitmap& DictionaryColumn::validity() const noexcept
+	{
+		return m_validity;
+	}
+
+	void DictionaryColumn::reserve(size_t size)
+	{
+		m_codes.reserve(size);
+		m_validity.reserve(size);
+	}
+
+	void DictionaryColumn::push(StringView value)
+	{
+		m_codes.push_back(encode(value));
+		m_validity.push(true);
+	}
+
+	void DictionaryColumn::pushCode(Code code)
+	{
+		assert(code < m_dictionary.size());
+		m_codes.push_back(code);
+		m_validity.push(true);
+	}
+
+	void DictionaryColumn::pushNull()
+	{
+		m_codes.push_back(encode(U""));
+		m_validity.push(false);
+	}
+
+	void DictionaryColumn::set(size_t row, StringView value)
+	{
+		m_codes[row] = encode(value);
+		m_validity.set(row, true);
+	}
+
+	void DictionaryColumn::setNull(size_t row)
+	{
+		m_codes[row] = encode(U"");
+		m_validity.set(row, false);
+	}
+
+	void DictionaryColumn::append(const DictionaryColumn& other)
+	{
+		// other の符号を this の符号に付け替える
+		Array<Code> remap(other.m_dictionary.size());
+		for (size_t i = 0; i < other.m_dictionary.size(); ++i)
+		{
+			remap[i] = encode(other.m_dictionary[i]);
+		}
+
+		m_codes.reserve(m_codes.size() + other.m_codes.size());
+		for (const Code code : other.m_codes)
+		{
+			m_codes.push_back(remap[code]);
+		}
+		m_validity.append(other.m_validity);
+	}
+
+	size_t DictionaryColumn::memoryUsage() const noexcept
+	{
+		size_t dictionaryBytes = 0;
+		for (const auto& value : m_dictionary)
+		{
+			dictionaryBytes += (sizeof(String) + value.capacity() * sizeof(char32));
+		}
+
+		// m_lookup も同じ文字列をキーとして持つので、概算で同じ量を足す
+		return (m_codes.capacity() * sizeof(Code) + m_validity.memoryUsage()
+			+ dictionaryBytes * 2 + m_lookup.size() * sizeof(Code));
+	}
+
+	DictionaryColumn::Code DictionaryColumn::encode(StringView value)
+	{
+		// HashTable<String, ...> の find は StringView を直接受け取れないので、一度 String にする
+		String key{ value };
+		if (auto it = m_lookup.find(key); it != m_lookup.end())
+		{
+			return it->second;
+		}
+
+		const Code code = static_cast<Code>(m_dictionary.size());
+		m_dictionary.push_back(key);
+		m_lookup.emplace(std::move(key), code);
+		return code;
+	}
+
+	size_t StringColumn::size() const noexcept
+	{
+		return (m_offsets.size() - 1);
+	}
+
+	bool StringColumn::isNull(size_t row) const noexcept
+	{
+		return not m_validity.isValid(row);
+	}
+
+	std::string_view StringColumn::get(size_t row) const noexcept
+	{
+		if (isRelocated(row))
+		{
+			const auto& [first, last] = m_relocated.find(row)->second;
+			return std::string_view{ m_overflow }.substr(static_cast<size_t>(first), static_cast<size_t>(last - first));
+		}
+
+		const size_t first = static_cast<size_t>(m_offsets[row]);
+		const size_t last = static_cast<size_t>(m_offsets[row + 1]);
+		return std::string_view{ m_blob }.substr(first, (last - first));
+	}
+
+	const ValidityBitmap& StringColumn::validity() const noexcept
+	{
+		return m_validity;
+	}
+
+	void StringColumn::reserve(size_t size, size_t bytes)
+	{
+		m_offsets.reserve(size + 1);
+		m_blob.reserve(bytes);
+		m_validity.reserve(size);
+	}
+
+	void StringColumn::push(std::string_view utf8)
+	{
+		m_blob.append(utf8);
+		m_offsets.push_back(m_blob.size());
+		m_validity.push(true);
+	}
+
+	void StringColumn::push(StringView value)
+	{
+		push(std::string_view{ Unicode::ToUTF8(value) });
+	}
+
+	void StringColumn::pushNull()
+	{
+		m_offsets.push_back(m_blob.size());
+		m_validity.push(false);
+	}
+
+	void StringColumn::set(size_t row, StringView value)
+	{
+		const std::string utf8 = Unicode::ToUTF8(value);
+		const size_t first = static_cast<size_t>(m_offsets[row]);
+		const size_t last = static_cast<size_t>(m_offsets[row + 1]);
+		m_validity.set(row, true);
+
+		// 途中の行の長さを変えると後ろを全てずらすことになるので、値を m_overflow に足す
+		if (((row + 1) < size()) && (utf8.size() != (last - first)))
+		{
+			if (m_relocatedBits.size() <= (row / BitsPerWord))
+			{
+				m_relocatedBits.resize(((size() + BitsPerWord - 1) / BitsPerWord), 0);
+			}
+			SetBit(m_relocatedBits, row, true);
+			m_relocated[row] = { m_overflow.size(), (m_overflow.size() + utf8.size()) };
+			m_overflow.append(utf8);
+
+			// 詰め直す手間が、それまでに足した値の分を超えないようにする
+			if ((m_blob.size() + m_offsets.size()) < (m_overflow.size() + m_relocated.size()))
+			{
+				compact();
+			}
+			return;
+		}
+
+		unrelocate(row);
+		m_blob.replace(first, (last - first), utf8);
+
+		const int64 diff = (static_cast<int64>(utf8.size()) - static_cast<int64>(last - first));
+		if (diff != 0)
+		{
+			for (size_t i = (row + 1); i < m_offsets.size(); ++i)
+			{
+				m_offsets[i] = static_cast<uint64>(static_cast<int64>(m_offsets[i]) + diff);
+			}
+		}
+	}
+
+	void StringColumn::setNull(size_t row)
+	{
+		set(row, U"");
+		m_validity.set(row, false);
+	}
+
+	void StringColumn::append(const StringColumn& other)
+	{
+		if (not other.m_relocated.empty())
+		{
+			StringColumn compacted = other;
+			compacted.compact();
+			append(compacted);
+			return;
+		}
+
+		const uint64 base = m_blob.size();
+		m_blob.append(other.m_blob);
+		m_offsets.reserve(m_offsets.size() + other.size());
+		for (size_t i = 1; i < other.m_offsets.size(); ++i)
+		{
+			m_offsets.push_back(base + other.m_offsets[i]);
+		}
+		m_validity.append(other.m_validity);
+	}
+
+	size_t StringColumn::memoryUsage() const noexcept
+	{
+		return (m_blob.capacity() + m_offsets.capacity() * sizeof(uint64) + m_validity.memoryUsage()
+			+ m_overflow.capacity() + m_relocated.size() * (sizeof(size_t) + sizeof(std::pair<uint64, uint64>)) + m_relocatedBits.capacity() * sizeof(uint64));
+	}
+
+	bool StringColumn::isRelocated(size_t row) const noexcept
+	{
+		return (((row / BitsPerWord) < m_relocatedBits.size()) && GetBit(m_relocatedBits, row));
+	}
+
+	void StringColumn::unrelocate(size_t row)
+	{
+		if (isRelocated(row))
+		{
+			SetBit(m_relocatedBits, row, false);
+			m_relocated.erase(row);
+		}
+	}
+
+	void StringColumn::compact()
+	{
+		std::string blob;
+		blob.reserve(m_blob.size() + m_overflow.size());
+		Array<uint64> offsets;
+		offsets.reserve(m_offsets.size());
+		offsets.push_back(0);
+		for (size_t row = 0; row < size(); ++row)
+		{
+			blob.append(get(row));
+			offsets.push_back(blob.size());
+		}
+
+		m_blob = std::move(blob);
+		m_offsets = std::move(offsets);
+		m_overflow = std::string{};
+		m_relocated = {};
+		m_relocatedBits = {};
+	}
+
+	ColumnType GetColumnType(const Column& column) noexcept
+	{
+		return static_cast<ColumnType>(column.index());
+	}
+
+	size_t GetColumnSize(const Column& column) noexcept
+	{
+		return std::visit([](const auto& c) { return c.size(); }, column);
+	}
+
+	bool IsNull(const Column& column, size_t row) noexcept
+	{
+		return std::visit([row](const auto& c) { return c.isNull(row); }, column);
+	}
+
+	void FormatCell(const Column& column, size_t row, String& out)
+	{
+		if (GetColumnSize(column) <= row || IsNull(column, row))
+		{
+			out.clear();
+			return;
+		}
+
+		switch (GetColumnType(column))
+		{
+		case ColumnType::Int64:
+			FormatNumber(std::get<Int64Column>(column).get(row), out);
+			break;
+		case ColumnType::Double:
+			FormatNumber(std::get<DoubleColumn>(column).get(row), out);
+			break;
+		case ColumnType::Bool:
+			out = (std::get<BoolColumn>(column).get(row) ? U"true" : U"false");
+			break;
+		case ColumnType::Dictionary:
+			out = std::get<DictionaryColumn>(column).get(row);
+			break;
+		case ColumnType::String:
+			out = Unicode::FromUTF8(std::get<StringColumn>(column).get(row));
+			break;
+		}
+	}
+
+	Optional<int64> ParseInt64(std::string_view text) noexcept
+	{
+		return ParseNumber<int64>(text);
+	}
+
+	Optional<int64> ParseInt64(StringView text) noexcept
+	{
+		char buffer[NumberTextLength];
+		std::string_view ascii;
+		return (ToAscii(text, buffer, ascii) ? ParseInt64(ascii) : none);
+	}
+
+	Optional<double> ParseDouble(std::string_view text) noexcept
+	{
+		return ParseNumber<double>(text);
+	}
+
+	Optional<double> ParseDouble(StringView text) noexcept
+	{
+		char buffer[NumberTextLength];
+		std::string_view ascii;
+		return (ToAscii(text, buffer, ascii) ? ParseDouble(ascii) : none);
+	}
+
+	Optional<bool> ParseBool(std::string_view text) noexcept
+	{
+		if (text == "true")
+		{
+			return true;
+		}
+		if (text == "false")
+		{
+			return false;
+		}
+		return none;
+	}
+
+	Optional<bool> ParseBool(StringView text) noexcept
+	{
+		if (text == U"true")
+		{
+			return true;
+		}
+		if (text == U"false")
+		{
+			return false;
+		}
+		return none;
+	}
+
+	void ColumnTypeInference::add(std::string_view text) noexcept
+	{
+		if (m_isInt64 || m_isDouble)
+		{
+			const Optional<int64> integer = (m_isInt64 ? ParseInt64(text) : none);
+			m_isInt64 = integer.has_value();
+			m_isDouble = (m_isDouble && ((integer && IsExactInDouble(*integer)) || ParseDouble(text).has_value()));
+		}
+		m_isBool = (m_isBool && ParseBool(text).has_value());
+	}
+
+	void ColumnTypeInference::add(StringView text) noexcept
+	{
+		char buffer[NumberTextLength];
+		std::string_view ascii;
+		if (ToAscii(text, buffer, ascii))
+		{
+			add(ascii);
+		}
+		else
+		{
+			m_isInt64 = m_isDouble = m_isBool = false;
+		}
+	}
+
+	void ColumnTypeInference::merge(const ColumnTypeInference& other) noexcept
+	{
+		m_isInt64 = (m_isInt64 && other.m_isInt64);
+		m_isDouble = (m_isDouble && other.m_isDouble);
+		m_isBool = (m_isBool && other.m_isBool);
+	}
+
+	Optional<ColumnType> ColumnTypeInference::getType() const noexcept
+	{
+		if (m_isInt64)
+		{
+			return ColumnType::Int64;
+		}
+		else if (m_isDouble)
+		{
+			return ColumnType::Double;
+		}
+		else if (m_isBool)
+		{
+			return ColumnType::Bool;
+		}
+		return none;
+	}
+
+	ColumnarStore ColumnarStore::FromGrid(const Grid<String>& values)
+	{
+		ColumnarStore store;
+		for (size_t column = 0; column < values.width(); ++column)
+		{
+			store.addColumn(Format(column), MakeColumn(values, column));
+		}
+		store.m_rowCount = values.height();
+		return store;
+	}
+
+	size_t ColumnarStore::addColumn(const String& name, Column column)
+	{
+		m_rowCount = Max(m_rowCount, GetColumnSize(column));
+		m_columns.push_back(std::move(column));
+		m_names.push_back(name);
+		++m_version;
+		return (m_columns.size() - 1);
+	}
+
+	size_t ColumnarStore::rowCount() const
+	{
+		return m_rowCount;
+	}
+
+	size_t ColumnarStore::columnCount() const
+	{
+		return m_columns.size();
+	}
+
+	uint64 ColumnarStore::version() const
+	{
+		return m_version;
+	}
+
+	void ColumnarStore::fetch(CellWindow& window) const
+	{
+		// 列ごとに型の分岐を済ませてから、表示中の行だけを文字列にする
+		for (size_t column = window.columns().first; column < window.columns().last; ++column)
+		{
+			const Column& values = m_columns[column];
+			for (size_t row = window.rows().first; row < window.rows().last; ++row)
+			{
+				FormatCell(values, row, window.at(row, column));
+			}
+		}
+	}
+
+	Optional<StringView> ColumnarStore::view(size_t row, size_t column) const
+	{
+		if (m_columns.size() <= column)
+		{
+			return none;
+		}
+
+		const auto* values = std::get_if<DictionaryColumn>(&m_columns[column]);
+		if (not values || values->size() <= row || values->isNull(row))
+		{
+			return none;
+		}
+		return StringView{ values->get(row) };
+	}
+
+	bool ColumnarStore::setCell(size_t row, size_t column, StringView value)
+	{
+		if (m_columns.size() <= column || GetColumnSize(m_columns[column]) <= row)
+		{
+			return false;
+		}
+
+		const auto setTyped = [&](auto& values, const auto& parsed)
+		{
+			if (value.isEmpty())
+			{
+				values.setNull(row);
+				return true;
+			}
+			if (not parsed)
+			{
+				return false;
+			}
+			values.set(row, *parsed);
+			return true;
+		};
+
+		bool accepted = true;
+		switch (GetColumnType(m_columns[column]))
+		{
+		case ColumnType::Int64:
+			accepted = setTyped(std::get<Int64Column>(m_columns[column]), ParseInt64(value));
+			break;
+		case ColumnType::Double:
+			accepted = setTyped(std::get<DoubleColumn>(m_columns[column]), ParseDouble(value));
+			break;
+		case ColumnType::Bool:
+			accepted = setTyped(std::get<BoolColumn>(m_columns[column]), ParseBool(value));
+			break;
+		case ColumnType::Dictionary:
+			std::get<DictionaryColumn>(m_columns[column]).set(row, value);
+			break;
+		case ColumnType::String:
+			std::get<StringColumn>(m_columns[column]).set(row, value);
+			break;
+		}
+
+		if (accepted)
+		{
+			++m_version;
+		}
+		return accepted;
+	}
+
+	const Column& ColumnarStore::column(size_t index) const
+	{
+		return m_columns[index];
+	}
+
+	Column& ColumnarStore::column(size_t index)
+	{
+		return m_columns[index];
+	}
+
+	ColumnType ColumnarStore::columnType(size_t index) const
+	{
+		return GetColumnType(m_columns[index]);
+	}
+
+	const Array<String>& ColumnarStore::columnNames() const noexcept
+	{
+		return m_names;
+	}
+
+	void ColumnarStore::markModified()
+	{
+		m_rowCount = 0;
+		for (const auto& column : m_columns)
+		{
+			m_rowCount = Max(m_rowCount, GetColumnSize(column));
+		}
+		++m_version;
+	}
+
+	size_t ColumnarStore::memoryUsage() const noexcept
+	{
+		size_t bytes = 0;
+		for (const auto& column : m_columns)
+		{
+			bytes += std::visit([](const auto& c) { return c.memoryUsage(); }, column);
+		}
+		return bytes;
+	}
+}
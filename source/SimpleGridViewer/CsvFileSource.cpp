@@ -0,0 +1,345 @@
+﻿# include "SimpleGridViewer/CsvFileSource.hpp"
+# include "SimpleGridViewer/CsvRowScanner.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace
+	{
+		struct Field
+		{
+			std::string_view text;
+
+			// 次のフィールドか次の行の先頭
+			size_t next = 0;
+
+			bool endOfRow = false;
+		};
+
+		// pos から始まる 1 つのフィールドを読む
+		// 引用符の中の "" を含む場合だけ unescaped に書き出して、それを指す
+		Field ReadField(std::string_view data, size_t pos, char delimiter, std::string& unescaped)
+		{
+			const size_t size = data.size();
+			Field field;
+
+			if (pos < size && data[pos] == '"')
+			{
+				const size_t begin = ++pos;
+				bool escaped = false;
+				while (pos < size)
+				{
+					if (data[pos] == '"')
+					{
+						if ((pos + 1) < size && data[pos + 1] == '"')
+						{
+							escaped = true;
+							pos += 2;
+							continue;
+						}
+						break;
+					}
+					++pos;
+				}
+
+				const std::string_view quoted = data.substr(begin, (pos - begin));
+				if (escaped)
+				{
+					unescaped.clear();
+					for (size_t i = 0; i < quoted.size(); ++i)
+					{
+						unescaped.push_back(quoted[i]);
+						i += (quoted[i] == '"');
+					}
+					field.text = unescaped;
+				}
+				else
+				{
+					field.text = quoted;
+				}
+
+				// 閉じる引用符の後ろにある余計な文字は読み飛ばす
+				while (pos < size && data[pos] != delimiter && data[pos] != '\n')
+				{
+					++pos;
+				}
+			}
+			else
+			{
+				const size_t begin = pos;
+				while (pos < size && data[pos] != delimiter && data[pos] != '\n')
+				{
+					++pos;
+				}
+
+				size_t end = pos;
+				if (begin < end && (pos == size || data[pos] == '\n') && data[end - 1] == '\r')
+				{
+					--end;
+				}
+				field.text = data.substr(begin, (end - begin));
+			}
+
+			if (size <= pos)
+			{
+				field.next = size;
+				field.endOfRow = true;
+			}
+			else
+			{
+				field.next = (pos + 1);
+				field.endOfRow = (data[pos] == '\n');
+			}
+			return field;
+		}
+
+		// フィールドの先頭の pos から、次の行の先頭を返す
+		size_t SkipRow(std::string_view data, size_t pos, char delimiter)
+		{
+			CsvRowScanner scanner{ delimiter };
+			for (; pos < data.size(); ++pos)
+			{
+				if (scanner.next(data[pos]) == CsvRowScanner::Token::EndOfRow)
+				{
+					return (pos + 1);
+				}
+			}
+			return data.size();
+		}
+	}
+
+	CsvFileSource::~CsvFileSource()
+	{
+		close();
+	}
+
+	bool CsvFileSource::open(FilePathView path)
+	{
+		const String extension = FileSystem::Extension(path);
+		const char delimiter = ((extension == U"tsv" || extension == U"tab") ? '\t' : ',');
+		return open(path, delimiter);
+	}
+
+	bool CsvFileSource::open(FilePathView path, char delimiter)
+	{
+		close();
+
+		if (not m_file.open(path))
+		{
+			return false;
+		}
+
+		m_delimiter = delimiter;
+		m_dataStart = (m_file.view().starts_with("\xEF\xBB\xBF") ? 3 : 0);
+		m_indexing = true;
+		++m_version;
+
+		m_indexer = std::jthread{ [this](std::stop_token stopToken) { buildIndex(stopToken); } };
+
+		// 最初の画面に表示する分の索引ができるまで待つ
+		// 行が長くても PublishBytes を読むごとに公開されるので、ファイルの大きさには依存しない
+		m_publishCount.wait(0);
+		return true;
+	}
+
+	void CsvFileSource::close()
+	{
+		if (m_indexer.joinable())
+		{
+			m_indexer.request_stop();
+			m_indexer.join();
+		}
+
+		m_file.close();
+		m_dataStart = 0;
+		{
+			std::lock_guard lock{ m_indexMutex };
+			m_checkpoints.clear();
+		}
+		m_rowCount = 0;
+		m_columnCount = 0;
+		m_indexedBytes = 0;
+		m_indexing = false;
+		m_publishCount = 0;
+	}
+
+	bool CsvFileSource::isOpen() const noexcept
+	{
+		return m_file.isOpen();
+	}
+
+	bool CsvFileSource::isIndexing() const noexcept
+	{
+		return m_indexing;
+	}
+
+	double CsvFileSource::getIndexProgress() const noexcept
+	{
+		if (m_file.size() == 0)
+		{
+			return (m_indexing ? 0.0 : 1.0);
+		}
+		return (static_cast<double>(m_indexedBytes) / m_file.size());
+	}
+
+	char CsvFileSource::delimiter() const noexcept
+	{
+		return m_delimiter;
+	}
+
+	size_t CsvFileSource::rowCount() const
+	{
+		return m_rowCount.load(std::memory_order_acquire);
+	}
+
+	size_t CsvFileSource::columnCount() const
+	{
+		return m_columnCount.load(std::memory_order_acquire);
+	}
+
+	uint64 CsvFileSource::version() const
+	{
+		// 索引が進んでも既存の行の内容は変わらない
+		return m_version;
+	}
+
+	void CsvFileSource::fetch(CellWindow& window) const
+	{
+		const IndexRange& rows = window.rows();
+		const IndexRange& columns = window.columns();
+		if (rows.isEmpty() || columns.isEmpty())
+		{
+			return;
+		}
+
+		const std::string_view data = m_file.view();
+		std::string unescaped;
+		size_t pos = findRowStart(rows.first);
+
+		for (size_t row = rows.first; row < rows.last; ++row)
+		{
+			size_t column = 0;
+			bool endOfRow = false;
+
+			// 表示する列より右は解析せずに次の行まで読み飛ばす
+			while (not endOfRow && column < columns.last)
+			{
+				const Field field = ReadField(data, pos, m_delimiter, unescaped);
+				if (columns.contains(column))
+				{
+					window.at(row, column) = Unicode::FromUTF8(field.text);
+				}
+				pos = field.next;
+				endOfRow = field.endOfRow;
+				++column;
+			}
+
+			for (; column < columns.last; ++column)
+			{
+				if (columns.contains(column))
+				{
+					window.at(row, column).clear();
+				}
+			}
+
+			if (not endOfRow)
+			{
+				pos = SkipRow(data, pos, m_delimiter);
+			}
+		}
+	}
+
+	void CsvFileSource::buildIndex(std::stop_token stopToken)
+	{
+		const std::string_view data = m_file.view();
+		const char delimiter = m_delimiter;
+
+		Array<uint64> pending;
+		size_t rows = 0;
+		size_t publishedRows = 0;
+		size_t maxFields = 0;
+
+		const auto publish = [&](size_t indexedBytes)
+		{
+			{
+				std::lock_guard lock{ m_indexMutex };
+				m_checkpoints.insert(m_checkpoints.end(), pending.begin(), pending.end());
+			}
+			pending.clear();
+			publishedRows = rows;
+
+			m_columnCount.store(maxFields, std::memory_order_release);
+			m_rowCount.store(rows, std::memory_order_release);
+			m_indexedBytes = indexedBytes;
+			++m_publishCount;
+			m_publishCount.notify_all();
+		};
+
+		CsvRowScanner scanner{ delimiter };
+		size_t fields = 1;
+		size_t rowStart = m_dataStart;
+		size_t publishAt = (m_dataStart + PublishBytes);
+
+		for (size_t pos = m_dataStart; pos < data.size(); ++pos)
+		{
+			const CsvRowScanner::Token token = scanner.next(data[pos]);
+			if (token == CsvRowScanner::Token::Delimiter)
+			{
+				++fields;
+			}
+			else if (token == CsvRowScanner::Token::EndOfRow)
+			{
+				if ((rows % Stride) == 0)
+				{
+					pending.push_back(rowStart);
+				}
+				++rows;
+				maxFields = Max(maxFields, fields);
+				fields = 1;
+				rowStart = (pos + 1);
+			}
+
+			// 閉じていない引用符などで改行が長い間現れなくても、読んだ分ごとに公開して止められるようにする
+			if (((token == CsvRowScanner::Token::EndOfRow) && (PublishRows <= (rows - publishedRows))) || (publishAt <= pos))
+			{
+				publish(pos + 1);
+				publishAt = (pos + PublishBytes);
+
+				if (stopToken.stop_requested())
+				{
+					m_indexing = false;
+					return;
+				}
+			}
+		}
+
+		// 改行で終わっていない最後の行
+		if (rowStart < data.size())
+		{
+			if ((rows % Stride) == 0)
+			{
+				pending.push_back(rowStart);
+			}
+			++rows;
+			maxFields = Max(maxFields, fields);
+		}
+
+		publish(data.size());
+		m_indexing = false;
+	}
+
+	size_t CsvFileSource::findRowStart(size_t row) const
+	{
+		size_t pos;
+		{
+			std::lock_guard lock{ m_indexMutex };
+			pos = static_cast<size_t>(m_checkpoints[row / Stride]);
+		}
+
+		const std::string_view data = m_file.view();
+		for (size_t i = 0; i < (row % Stride); ++i)
+		{
+			pos = SkipRow(data, pos, m_delimiter);
+		}
+		return pos;
+	}
+}
@@ -0,0 +1,633 @@
+﻿# include <bit>
+# include "SimpleGridViewer/CsvParser.hpp"
+# include "SimpleGridViewer/CsvRowScanner.hpp"
+# include "SimpleGridViewer/MappedFile.hpp"
+# include "SimpleGridViewer/Parallel.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace
+	{
+		constexpr size_t BlockSize = 64;
+
+		// 1 つの塊の最小の大きさ
+		constexpr size_t MinChunkSize = (1 << 20);
+
+		// 64 バイトの各位置が、引用符・区切り文字・改行かどうかのビット列
+		struct BlockMasks
+		{
+			uint64 quote = 0;
+
+			uint64 delimiter = 0;
+
+			uint64 newline = 0;
+		};
+
+	# if SIMPLEGRIDVIEWER_AVX2
+
+		BlockMasks Classify(const char* p, char delimiter) noexcept
+		{
+			const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+
+			const auto match = [&](char c)
+			{
+				const __m256i v = _mm256_set1_epi8(c);
+				const uint64 l = static_cast<uint32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, v)));
+				const uint64 h = static_cast<uint32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, v)));
+				return (l | (h << 32));
+			};
+
+			return{ match('"'), match(delimiter), match('\n') };
+		}
+
+	# elif SIMPLEGRIDVIEWER_SSE2
+
+		BlockMasks Classify(const char* p, char delimiter) noexcept
+		{
+			__m128i chunks[4];
+			for (size_t i = 0; i < 4; ++i)
+			{
+				chunks[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+			}
+
+			const auto match = [&](char c)
+			{
+				const __m128i v = _mm_set1_epi8(c);
+				uint64 mask = 0;
+				for (size_t i = 0; i < 4; ++i)
+				{
+					mask |= (static_cast<uint64>(static_cast<uint16>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], v)))) << (i * 16));
+				}
+				return mask;
+			};
+
+			return{ match('"'), match(delimiter), match('\n') };
+		}
+
+	# else
+
+		BlockMasks Classify(const char* p, char delimiter) noexcept
+		{
+			BlockMasks masks;
+			for (size_t i = 0; i < BlockSize; ++i)
+			{
+				masks.quote |= (static_cast<uint64>(p[i] == '"') << i);
+				masks.delimiter |= (static_cast<uint64>(p[i] == delimiter) << i);
+				masks.newline |= (static_cast<uint64>(p[i] == '\n') << i);
+			}
+			return masks;
+		}
+
+	# endif
+
+		using ScanState = CsvRowScanner::State;
+
+		// 各ビットを、そこまでのビットの排他的論理和にする
+		// 引用の始まりと終わりの引用符のビット列に適用すると、引用の内側が 1 になる
+		constexpr uint64 PrefixXor(uint64 x) noexcept
+		{
+			x ^= (x << 1);
+			x ^= (x << 2);
+			x ^= (x << 4);
+			x ^= (x << 8);
+			x ^= (x << 16);
+			x ^= (x << 32);
+			return x;
+		}
+
+		// 先頭の length バイトを読んで state を進め、引用の内側のビット列を返す。 CsvRowScanner と同じ規則で読む
+		// 引用の外の引用符は、フィールドの先頭か閉じた引用符の直後 ("") にある場合だけ引用を始める
+		// 引用符の無いブロックでは、引用符ごとの判定は行わない
+		uint64 ScanQuotes(const BlockMasks& masks, size_t length, ScanState& state) noexcept
+		{
+			const uint64 boundary = (masks.delimiter | masks.newline);
+			bool quoted = (state == ScanState::Quoted);
+
+			// 引用を始めたり閉じたりする引用符
+			uint64 toggles = 0;
+			if (masks.quote)
+			{
+				const uint64 fieldStarts = ((boundary << 1) | uint64{ state == ScanState::FieldStart });
+				uint64 afterClose = uint64{ state == ScanState::QuoteInQuoted };
+				for (uint64 quotes = masks.quote; quotes; quotes &= (quotes - 1))
+				{
+					const uint64 bit = (quotes & (~quotes + 1));
+					if (quoted)
+					{
+						toggles |= bit;
+						afterClose = (bit << 1);
+						quoted = false;
+					}
+					else if ((fieldStarts | afterClose) & bit)
+					{
+						toggles |= bit;
+						quoted = true;
+					}
+				}
+			}
+
+			const uint64 inside = (PrefixXor(toggles) ^ ((state == ScanState::Quoted) ? ~uint64{ 0 } : 0));
+
+			// 次のブロックの先頭での状態は、最後に読んだバイトで決まる
+			if (length)
+			{
+				const size_t last = (length - 1);
+				if ((inside >> last) & 1)
+				{
+					state = ScanState::Quoted;
+				}
+				else if ((toggles >> last) & 1)
+				{
+					state = ScanState::QuoteInQuoted;
+				}
+				else if ((boundary >> last) & 1)
+				{
+					state = ScanState::FieldStart;
+				}
+				else
+				{
+					state = ScanState::Unquoted;
+				}
+			}
+			return inside;
+		}
+
+		// 末尾が 64 バイトに満たないブロックは、構造を持たない文字で埋めて判定する
+		BlockMasks ClassifyAt(std::string_view data, size_t pos, size_t end, char delimiter) noexcept
+		{
+			if ((pos + BlockSize) <= end)
+			{
+				return Classify(data.data() + pos, delimiter);
+			}
+
+			char padded[BlockSize];
+			std::memset(padded, ' ', BlockSize);
+			std::memcpy(padded, data.data() + pos, (end - pos));
+			return Classify(padded, delimiter);
+		}
+
+		// 1 つの塊の、ある列の解析結果
+		struct ChunkColumn
+		{
+			StringColumn raw;
+
+			ColumnTypeInference inference;
+
+			// 解析中のデータを指す。 DictionaryLimit を超えたら数えるのをやめる
+			HashSet<std::string_view> distinct;
+
+			bool tooManyDistinct = false;
+
+			Column typed;
+		};
+
+		struct Chunk
+		{
+			size_t begin = 0;
+
+			size_t end = 0;
+
+			size_t rowCount = 0;
+
+			Array<ChunkColumn> columns;
+
+			// ヘッダの行。先頭の塊だけが持つ
+			Array<String> header;
+		};
+
+		class ChunkParser
+		{
+		public:
+			ChunkParser(Chunk& chunk, bool header)
+				: m_chunk{ chunk }
+				, m_inHeader{ header } {}
+
+			void addField(std::string_view text, bool endOfRow)
+			{
+				text = unquote(text, endOfRow);
+
+				if (m_inHeader)
+				{
+					m_chunk.header.push_back(Unicode::FromUTF8(text));
+				}
+				else
+				{
+					push(m_column, text, (text.data() == m_unescaped.data()));
+				}
+				++m_column;
+
+				if (endOfRow)
+				{
+					endRow();
+				}
+			}
+
+		private:
+			Chunk& m_chunk;
+
+			bool m_inHeader;
+
+			size_t m_column = 0;
+
+			std::string m_unescaped;
+
+			// CsvFileSource の ReadField と同じく、先頭の引用符から閉じる引用符までを値とし、その後ろの余計な文字は捨てる
+			std::string_view unquote(std::string_view text, bool endOfRow)
+			{
+				if (endOfRow && text.ends_with('\r'))
+				{
+					text.remove_suffix(1);
+				}
+
+				if (not text.starts_with('"'))
+				{
+					return text;
+				}
+
+				text.remove_prefix(1);
+				size_t close = 0;
+				bool escaped = false;
+				for (; close < text.size(); ++close)
+				{
+					if (text[close] == '"')
+					{
+						if (((close + 1) < text.size()) && (text[close + 1] == '"'))
+						{
+							escaped = true;
+							++close;
+							continue;
+						}
+						break;
+					}
+				}
+				text = text.substr(0, close);
+
+				if (not escaped)
+				{
+					return text;
+				}
+
+				m_unescaped.clear();
+				for (size_t i = 0; i < text.size(); ++i)
+				{
+					m_unescaped.push_back(text[i]);
+					i += (text[i] == '"');
+				}
+				return m_unescaped;
+			}
+
+			void push(size_t column, std::string_view text, bool unescaped)
+			{
+				auto& columns = m_chunk.columns;
+				while (columns.size() <= column)
+				{
+					// この行で初めて現れた列は、それまでの行を null で埋める
+					auto& added = columns.emplace_back();
+					added.raw.reserve(m_chunk.rowCount, 0);
+					for (size_t i = 0; i < m_chunk.rowCount; ++i)
+					{
+						added.raw.pushNull();
+					}
+				}
+
+				ChunkColumn& target = columns[column];
+				if (text.empty())
+				{
+					target.raw.pushNull();
+					return;
+				}
+
+				target.raw.push(text);
+				target.inference.add(text);
+
+				if (not target.tooManyDistinct)
+				{
+					// エスケープを解いた値は一時的なバッファにあるので、その列は辞書の候補にしない
+					if (unescaped)
+					{
+						target.tooManyDistinct = true;
+						target.distinct.clear();
+						return;
+					}
+
+					target.distinct.emplace(text);
+					if (DictionaryLimit < target.distinct.size())
+					{
+						target.tooManyDistinct = true;
+						target.distinct.clear();
+					}
+				}
+			}
+
+			void endRow()
+			{
+				if (m_inHeader)
+				{
+					m_inHeader = false;
+				}
+				else
+				{
+					// この行に無かった列は null
+					for (size_t column = m_column; column < m_chunk.columns.size(); ++column)
+					{
+						m_chunk.columns[column].raw.pushNull();
+					}
+					++m_chunk.rowCount;
+				}
+				m_column = 0;
+			}
+		};
+
+		// [chunk.begin, chunk.end) を解析する。どちらも行の先頭
+		void ParseChunk(std::string_view data, char delimiter, bool header, Chunk& chunk)
+		{
+			ChunkParser parser{ chunk, header };
+
+			size_t fieldStart = chunk.begin;
+			ScanState state = ScanState::FieldStart;
+
+			for (size_t block = chunk.begin; block < chunk.end; block += BlockSize)
+			{
+				const BlockMasks masks = ClassifyAt(data, block, chunk.end, delimiter);
+				const uint64 inside = ScanQuotes(masks, Min(BlockSize, (chunk.end - block)), state);
+
+				uint64 structural = ((masks.delimiter | masks.newline) & ~inside);
+				while (structural)
+				{
+					const int32 bit = std::countr_zero(structural);
+					const size_t pos = (block + bit);
+					parser.addField(data.substr(fieldStart, (pos - fieldStart)), ((masks.newline >> bit) & 1));
+					fieldStart = (pos + 1);
+					structural &= (structural - 1);
+				}
+			}
+
+			// 改行で終わっていない最後の行
+			if (fieldStart < chunk.end)
+			{
+				parser.addField(data.substr(fieldStart, (chunk.end - fieldStart)), true);
+			}
+		}
+
+		// pos での状態が state のとき、 pos 以降で行を区切る最初の改行の次の位置
+		size_t FindRowStart(std::string_view data, size_t pos, char delimiter, ScanState state)
+		{
+			CsvRowScanner scanner{ delimiter, state };
+			for (; pos < data.size(); ++pos)
+			{
+				if (scanner.next(data[pos]) == CsvRowScanner::Token::EndOfRow)
+				{
+					return (pos + 1);
+				}
+			}
+			return data.size();
+		}
+
+		// [begin, end) を読む前の状態ごとに、読んだ後の状態を求める
+		// 塊の先頭での状態は前の塊を読むまで分からないので、全ての状態から同時に読んでおく
+		using ScanTransitions = std::array<ScanState, CsvRowScanner::StateCount>;
+
+		ScanTransitions ScanChunk(std::string_view data, size_t begin, size_t end, char delimiter)
+		{
+			ScanTransitions states;
+			for (size_t i = 0; i < states.size(); ++i)
+			{
+				states[i] = static_cast<ScanState>(i);
+			}
+
+			for (size_t block = begin; block < end; block += BlockSize)
+			{
+				const BlockMasks masks = ClassifyAt(data, block, end, delimiter);
+				const size_t length = Min(BlockSize, (end - block));
+				for (auto& state : states)
+				{
+					ScanQuotes(masks, length, state);
+				}
+			}
+			return states;
+		}
+
+		ColumnType DecideType(const Array<Chunk>& chunks, size_t column, size_t rowCount)
+		{
+			ColumnTypeInference inference;
+			bool tooManyDistinct = false;
+			HashSet<std::string_view> distinct;
+
+			for (const auto& chunk : chunks)
+			{
+				if (chunk.columns.size() <= column)
+				{
+					continue;
+				}
+
+				const ChunkColumn& c = chunk.columns[column];
+				inference.merge(c.inference);
+				tooManyDistinct = (tooManyDistinct || c.tooManyDistinct);
+
+				if (not tooManyDistinct)
+				{
+					distinct.insert(c.distinct.begin(), c.distinct.end());
+					tooManyDistinct = (DictionaryLimit < distinct.size());
+				}
+			}
+
+			if (const auto type = inference.getType())
+			{
+				return *type;
+			}
+			else if ((not tooManyDistinct) && UseDictionary(distinct.size(), rowCount))
+			{
+				return ColumnType::Dictionary;
+			}
+			return ColumnType::String;
+		}
+
+		template <class Type, class Parser>
+		Column ConvertNumeric(const StringColumn& raw, Parser parse)
+		{
+			NumericColumn<Type> result;
+			result.reserve(raw.size());
+			for (size_t row = 0; row < raw.size(); ++row)
+			{
+				if (const Optional<Type> value = (raw.isNull(row) ? none : parse(raw.get(row))))
+				{
+					result.push(*value);
+				}
+				else
+				{
+					result.pushNull();
+				}
+			}
+			return result;
+		}
+
+		// 塊の中の列を、決めた型に変換する
+		Column Convert(StringColumn&& raw, size_t rowCount, ColumnType type)
+		{
+			// この塊に無かった列
+			while (raw.size() < rowCount)
+			{
+				raw.pushNull();
+			}
+
+			switch (type)
+			{
+			case ColumnType::Int64:
+				return ConvertNumeric<int64>(raw, [](std::string_view text) { return ParseInt64(text); });
+			case ColumnType::Double:
+				return ConvertNumeric<double>(raw, [](std::string_view text) { return ParseDouble(text); });
+			case ColumnType::Bool:
+			{
+				BoolColumn result;
+				result.reserve(rowCount);
+				for (size_t row = 0; row < rowCount; ++row)
+				{
+					if (const auto value = (raw.isNull(row) ? none : ParseBool(raw.get(row))))
+					{
+						result.push(*value);
+					}
+					else
+					{
+						result.pushNull();
+					}
+				}
+				return result;
+			}
+			case ColumnType::Dictionary:
+			{
+				// UTF-32 への変換は、異なる値ごとに 1 回だけ行う
+				DictionaryColumn result;
+				HashTable<std::string_view, DictionaryColumn::Code> codes;
+				result.reserve(rowCount);
+				for (size_t row = 0; row < rowCount; ++row)
+				{
+					if (raw.isNull(row))
+					{
+						result.pushNull();
+						continue;
+					}
+
+					const std::string_view text = raw.get(row);
+					if (auto it = codes.find(text); it != codes.end())
+					{
+						result.pushCode(it->second);
+					}
+					else
+					{
+						result.push(Unicode::FromUTF8(text));
+						codes.emplace(text, result.codes().back());
+					}
+				}
+				return result;
+			}
+			default:
+				return std::move(raw);
+			}
+		}
+
+		void Append(Column& destination, const Column& source)
+		{
+			std::visit([&](auto& d)
+			{
+				d.append(std::get<std::remove_cvref_t<decltype(d)>>(source));
+			}, destination);
+		}
+	}
+
+	ColumnarStore CsvParser::Parse(std::string_view data, const Options& options)
+	{
+		if (data.starts_with("\xEF\xBB\xBF"))
+		{
+			data.remove_prefix(3);
+		}
+
+		const size_t threadCount = GetThreadCount(options.threadCount);
+		const size_t chunkCount = Clamp<size_t>((data.size() / MinChunkSize), 1, (threadCount * 4));
+
+		// 各塊を、読む前の状態ごとに読んだ後の状態を並列に求めておく
+		Array<ScanTransitions> transitions(chunkCount);
+		const auto nominalBegin = [&](size_t i) { return (data.size() * i / chunkCount); };
+		ParallelFor(chunkCount, threadCount, [&](size_t i)
+		{
+			transitions[i] = ScanChunk(data, nominalBegin(i), nominalBegin(i + 1), options.delimiter);
+		});
+
+		// 先頭からつないで各塊の先頭での状態を決め、境界を次の行の先頭まで進める
+		Array<Chunk> chunks(chunkCount);
+		ScanState state = ScanState::FieldStart;
+		for (size_t i = 0; i < chunkCount; ++i)
+		{
+			chunks[i].begin = ((i == 0) ? 0 : FindRowStart(data, nominalBegin(i), options.delimiter, state));
+			state = transitions[i][static_cast<size_t>(state)];
+		}
+		for (size_t i = 0; i < chunkCount; ++i)
+		{
+			chunks[i].end = ((i + 1) < chunkCount) ? chunks[i + 1].begin : data.size();
+			chunks[i].begin = Min(chunks[i].begin, chunks[i].end);
+		}
+
+		ParallelFor(chunkCount, threadCount, [&](size_t i)
+		{
+			ParseChunk(data, options.delimiter, (options.header && i == 0), chunks[i]);
+		});
+
+		size_t rowCount = 0;
+		size_t columnCount = chunks.front().header.size();
+		for (const auto& chunk : chunks)
+		{
+			rowCount += chunk.rowCount;
+			columnCount = Max(columnCount, chunk.columns.size());
+		}
+
+		Array<ColumnType> types(columnCount);
+		for (size_t column = 0; column < columnCount; ++column)
+		{
+			types[column] = DecideType(chunks, column, rowCount);
+		}
+
+		// 塊ごとに型付きの列へ変換する
+		ParallelFor(chunkCount, threadCount, [&](size_t i)
+		{
+			Chunk& chunk = chunks[i];
+			chunk.columns.resize(columnCount);
+			for (size_t column = 0; column < columnCount; ++column)
+			{
+				ChunkColumn& c = chunk.columns[column];
+				c.typed = Convert(std::move(c.raw), chunk.rowCount, types[column]);
+				c.raw = StringColumn{};
+				c.distinct.clear();
+			}
+		});
+
+		// 列ごとに塊をつなげる
+		Array<Column> columns(columnCount);
+		ParallelFor(columnCount, threadCount, [&](size_t column)
+		{
+			columns[column] = std::move(chunks.front().columns[column].typed);
+			for (size_t i = 1; i < chunkCount; ++i)
+			{
+				Append(columns[column], chunks[i].columns[column].typed);
+				chunks[i].columns[column].typed = Column{};
+			}
+		});
+
+		ColumnarStore store;
+		const Array<String>& header = chunks.front().header;
+		for (size_t column = 0; column < columnCount; ++column)
+		{
+			store.addColumn(((column < header.size()) ? header[column] : Format(column)), std::move(columns[column]));
+		}
+		return store;
+	}
+
+	Optional<ColumnarStore> CsvParser::Load(FilePathView path, const Options& options)
+	{
+		MappedFile file;
+		if (not file.open(path))
+		{
+			return none;
+		}
+		return Parse(file.view(), options);
+	}
+}
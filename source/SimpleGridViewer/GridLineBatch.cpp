@@ -0,0 +1,74 @@
+﻿# include "SimpleGridViewer/GridLineBatch.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace
+	{
+		// TriangleIndex は 16 ビットなので、 1 つの頂点配列に積める線の数には上限がある
+		constexpr size_t MaxLines = (std::numeric_limits<uint16>::max() / 4);
+	}
+
+	void GridLineBatch::clear()
+	{
+		m_buffer.vertices.clear();
+		m_buffer.indices.clear();
+	}
+
+	void GridLineBatch::addVertical(int32 x, int32 top, int32 bottom)
+	{
+		if (top < bottom)
+		{
+			addRect(static_cast<float>(x), static_cast<float>(top), 1.0f, static_cast<float>(bottom - top));
+		}
+	}
+
+	void GridLineBatch::addHorizontal(int32 y, int32 left, int32 right)
+	{
+		if (left < right)
+		{
+			addRect(static_cast<float>(left), static_cast<float>(y), static_cast<float>(right - left), 1.0f);
+		}
+	}
+
+	size_t GridLineBatch::lineCount() const noexcept
+	{
+		return (m_buffer.vertices.size() / 4);
+	}
+
+	void GridLineBatch::draw(const ColorF& color)
+	{
+		if (m_buffer.indices.isEmpty())
+		{
+			return;
+		}
+
+		if (color != m_color)
+		{
+			const Float4 vertexColor = color.toFloat4();
+			for (auto& vertex : m_buffer.vertices)
+			{
+				vertex.color = vertexColor;
+			}
+			m_color = color;
+		}
+
+		m_buffer.draw();
+	}
+
+	void GridLineBatch::addRect(float x, float y, float w, float h)
+	{
+		if (MaxLines <= lineCount())
+		{
+			return;
+		}
+
+		const uint16 base = static_cast<uint16>(m_buffer.vertices.size());
+		const Float4 color = m_color.toFloat4();
+		m_buffer.vertices.push_back(Vertex2D{ .pos = Float2{ x, y }, .tex = Float2{ 0, 0 }, .color = color });
+		m_buffer.vertices.push_back(Vertex2D{ .pos = Float2{ (x + w), y }, .tex = Float2{ 0, 0 }, .color = color });
+		m_buffer.vertices.push_back(Vertex2D{ .pos = Float2{ (x + w), (y + h) }, .tex = Float2{ 0, 0 }, .color = color });
+		m_buffer.vertices.push_back(Vertex2D{ .pos = Float2{ x, (y + h) }, .tex = Float2{ 0, 0 }, .color = color });
+		m_buffer.indices.push_back(TriangleIndex{ base, static_cast<uint16>(base + 1), static_cast<uint16>(base + 2) });
+		m_buffer.indices.push_back(TriangleIndex{ base, static_cast<uint16>(base + 2), static_cast<uint16>(base + 3) });
+	}
+}
@@ -0,0 +1,99 @@
+﻿# include "SimpleGridViewer/HeaderLabels.hpp"
+
+namespace SimpleGridViewer
+{
+	StringView HeaderLabels::Number(size_t index, LabelBuffer& buffer) noexcept
+	{
+		// 下の桁から末尾に向かって書く
+		size_t position = buffer.size();
+		do
+		{
+			buffer[--position] = static_cast<char32>(U'0' + (index % 10));
+			index /= 10;
+		} while (index);
+
+		return StringView{ (buffer.data() + position), (buffer.size() - position) };
+	}
+
+	StringView HeaderLabels::Alphabet(size_t index, LabelBuffer& buffer) noexcept
+	{
+		// 0 を持たない 26 進数。 Z の次は AA
+		size_t position = buffer.size();
+		for (uint64 n = (static_cast<uint64>(index) + 1); n; n /= 26)
+		{
+			--n;
+			buffer[--position] = static_cast<char32>(U'A' + (n % 26));
+		}
+
+		return StringView{ (buffer.data() + position), (buffer.size() - position) };
+	}
+
+	HeaderLabels::HeaderLabels(LabelGenerator generator)
+		: m_generator{ std::move(generator) } {}
+
+	void HeaderLabels::setGenerator(LabelGenerator generator)
+	{
+		m_generator = std::move(generator);
+	}
+
+	void HeaderLabels::setLabels(Array<String> labels)
+	{
+		m_labels.clear();
+		m_denseLabels.clear();
+		m_denseLabels.reserve(labels.size());
+		for (auto& label : labels)
+		{
+			m_denseLabels.emplace_back(std::move(label));
+		}
+	}
+
+	void HeaderLabels::setLabel(size_t index, const String& label)
+	{
+		if (index < m_denseLabels.size())
+		{
+			m_denseLabels[index] = label;
+		}
+		else
+		{
+			m_labels[index] = label;
+		}
+	}
+
+	void HeaderLabels::resetLabel(size_t index)
+	{
+		if (index < m_denseLabels.size())
+		{
+			m_denseLabels[index].reset();
+		}
+		else
+		{
+			m_labels.erase(index);
+		}
+	}
+
+	void HeaderLabels::resetLabels()
+	{
+		m_denseLabels.clear();
+		m_labels.clear();
+	}
+
+	StringView HeaderLabels::get(size_t index, LabelBuffer& buffer) const
+	{
+		if (index < m_denseLabels.size())
+		{
+			if (const auto& label = m_denseLabels[index])
+			{
+				return *label;
+			}
+		}
+		else if (not m_labels.empty())
+		{
+			if (const auto it = m_labels.find(index); it != m_labels.end())
+			{
+				return it->second;
+			}
+		}
+
+		return (m_generator ? m_generator(index, buffer) : Number(index, buffer));
+	}
+}
@@ -0,0 +1,171 @@
+﻿# include "SimpleGridViewer/MappedFile.hpp"
+
+# if SIV3D_PLATFORM(WINDOWS)
+#	include <Siv3D/Windows/Windows.hpp>
+# else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+# endif
+
+namespace SimpleGridViewer
+{
+	MappedFile::MappedFile(FilePathView path)
+	{
+		open(path);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+# if SIV3D_PLATFORM(WINDOWS)
+
+	bool MappedFile::open(FilePathView path)
+	{
+		close();
+
+		const HANDLE file = ::CreateFileW(Unicode::ToWstring(path).c_str(), GENERIC_READ, (FILE_SHARE_READ | FILE_SHARE_WRITE),
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER size{};
+		if (not ::GetFileSizeEx(file, &size))
+		{
+			::CloseHandle(file);
+			return false;
+		}
+
+		m_file = file;
+		m_size = static_cast<size_t>(size.QuadPart);
+		m_isOpen = true;
+
+		if (m_size == 0)
+		{
+			return true;
+		}
+
+		const HANDLE mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (not mapping)
+		{
+			close();
+			return false;
+		}
+		m_mapping = mapping;
+
+		m_data = static_cast<const char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (not m_data)
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (m_data)
+		{
+			::UnmapViewOfFile(m_data);
+		}
+		if (m_mapping)
+		{
+			::CloseHandle(static_cast<HANDLE>(m_mapping));
+		}
+		if (m_file)
+		{
+			::CloseHandle(static_cast<HANDLE>(m_file));
+		}
+		m_data = nullptr;
+		m_mapping = nullptr;
+		m_file = nullptr;
+		m_size = 0;
+		m_isOpen = false;
+	}
+
+# else
+
+	bool MappedFile::open(FilePathView path)
+	{
+		close();
+
+		const int fd = ::open(Unicode::ToUTF8(path).c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		struct stat status{};
+		if (::fstat(fd, &status) != 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		m_fd = fd;
+		m_size = static_cast<size_t>(status.st_size);
+		m_isOpen = true;
+
+		if (m_size == 0)
+		{
+			return true;
+		}
+
+		void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			close();
+			return false;
+		}
+		m_data = static_cast<const char*>(data);
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (m_data)
+		{
+			::munmap(const_cast<char*>(m_data), m_size);
+		}
+		if (0 <= m_fd)
+		{
+			::close(m_fd);
+		}
+		m_data = nullptr;
+		m_fd = -1;
+		m_size = 0;
+		m_isOpen = false;
+	}
+
+# endif
+
+	bool MappedFile::isOpen() const noexcept
+	{
+		return m_isOpen;
+	}
+
+	MappedFile::operator bool() const noexcept
+	{
+		return m_isOpen;
+	}
+
+	const char* MappedFile::data() const noexcept
+	{
+		return m_data;
+	}
+
+	size_t MappedFile::size() const noexcept
+	{
+		return m_size;
+	}
+
+	std::string_view MappedFile::view() const noexcept
+	{
+		return{ m_data, (m_data ? m_size : 0) };
+	}
+}
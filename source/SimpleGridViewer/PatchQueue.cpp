@@ -0,0 +1,69 @@
+﻿# include "SimpleGridViewer/PatchQueue.hpp"
+
+namespace SimpleGridViewer
+{
+	PatchQueue::PatchQueue()
+	{
+		// 取り出し済みを表す空のノードから始める
+		Node* stub = new Node;
+		m_head.store(stub, std::memory_order_relaxed);
+		m_tail = stub;
+	}
+
+	PatchQueue::~PatchQueue()
+	{
+		Node* node = m_tail;
+		while (node)
+		{
+			Node* next = node->next.load(std::memory_order_relaxed);
+			delete node;
+			node = next;
+		}
+	}
+
+	void PatchQueue::push(Patch patch)
+	{
+		Array<Patch> patches;
+		patches.push_back(std::move(patch));
+		push(std::move(patches));
+	}
+
+	void PatchQueue::push(Array<Patch> patches)
+	{
+		if (patches.isEmpty())
+		{
+			return;
+		}
+
+		Node* node = new Node;
+		node->patches = std::move(patches);
+
+		// 末尾を付け替えてから、前のノードとつなぐ
+		// つなぐまでの間、取り出す側からは node 以降が見えないだけで、壊れることはない
+		Node* previous = m_head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	bool PatchQueue::pop(Array<Patch>& patches)
+	{
+		Node* tail = m_tail;
+		Node* next = tail->next.load(std::memory_order_acquire);
+		if (not next)
+		{
+			return false;
+		}
+
+		patches = std::move(next->patches);
+		next->patches.clear();
+
+		// next が新しい取り出し済みのノードになる
+		m_tail = next;
+		delete tail;
+		return true;
+	}
+
+	bool PatchQueue::isEmpty() const noexcept
+	{
+		return (m_tail->next.load(std::memory_order_acquire) == nullptr);
+	}
+}
@@ -0,0 +1,409 @@
+﻿# include <bit>
+# include <cmath>
+# include "SimpleGridViewer/RangeAggregator.hpp"
+# include "SimpleGridViewer/ColumnarStore.hpp"
+# include "SimpleGridViewer/Parallel.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace
+	{
+		constexpr double NotNumber = std::numeric_limits<double>::quiet_NaN();
+
+		// 表示上の [first, last) 行の数値を out の末尾に加える。数値でないセルは NaN
+		// 中断された場合は、途中までを加えて false を返す
+		bool ReadValues(const RowViewSource& view, size_t column, size_t first, size_t last, Array<double>& out, const std::stop_token& stopToken = {})
+		{
+			out.reserve(out.size() + (last - first));
+
+			// 数値の列は文字列にせず、型ごとの配列から直接読む
+			if (const auto* store = dynamic_cast<const ColumnarStore*>(view.source().get()))
+			{
+				const bool read = std::visit([&](const auto& values)
+				{
+					using Values = std::decay_t<decltype(values)>;
+					if constexpr (std::is_same_v<Values, Int64Column> || std::is_same_v<Values, DoubleColumn> || std::is_same_v<Values, BoolColumn>)
+					{
+						for (size_t row = first; row < last; ++row)
+						{
+							const size_t sourceRow = view.toSourceRow(row);
+							if ((values.size() <= sourceRow) || values.isNull(sourceRow))
+							{
+								out.push_back(NotNumber);
+							}
+							else
+							{
+								out.push_back(static_cast<double>(values.get(sourceRow)));
+							}
+						}
+						return true;
+					}
+					else
+					{
+						return false;
+					}
+				}, store->column(column));
+
+				if (read)
+				{
+					return true;
+				}
+			}
+
+			CellWindow window;
+			for (size_t blockFirst = first; blockFirst < last; blockFirst += FetchRows)
+			{
+				if (stopToken.stop_requested())
+				{
+					return false;
+				}
+
+				const size_t blockLast = Min(last, (blockFirst + FetchRows));
+				window.reset({ blockFirst, blockLast }, { column, (column + 1) });
+				view.fetch(window);
+
+				for (size_t row = blockFirst; row < blockLast; ++row)
+				{
+					out.push_back(ParseOpt<double>(window.at(row, column)).value_or(NotNumber));
+				}
+			}
+			return true;
+		}
+	}
+
+	void RangeSummary::add(double value) noexcept
+	{
+		++count;
+		sum += value;
+		min = Min(min, value);
+		max = Max(max, value);
+	}
+
+	void RangeSummary::merge(const RangeSummary& other) noexcept
+	{
+		count += other.count;
+		sum += other.sum;
+		min = Min(min, other.min);
+		max = Max(max, other.max);
+	}
+
+	double RangeSummary::mean() const noexcept
+	{
+		return (count ? (sum / count) : 0.0);
+	}
+
+	ColumnSegmentTree::ColumnSegmentTree(Array<double> values)
+		: m_values{ std::move(values) }
+	{
+		updateBlocksFrom(0);
+	}
+
+	size_t ColumnSegmentTree::size() const noexcept
+	{
+		return m_values.size();
+	}
+
+	void ColumnSegmentTree::set(size_t row, double value)
+	{
+		m_values[row] = value;
+		updateBlock(row / BlockSize);
+	}
+
+	void ColumnSegmentTree::append(std::span<const double> values)
+	{
+		// 端数だった末尾のブロックも作り直す
+		const size_t firstBlock = (m_values.size() / BlockSize);
+		m_values.insert(m_values.end(), values.begin(), values.end());
+		updateBlocksFrom(firstBlock);
+	}
+
+	RangeSummary ColumnSegmentTree::query(size_t first, size_t last) const
+	{
+		last = Min(last, m_values.size());
+		if (last <= first)
+		{
+			return{};
+		}
+
+		// 端数のブロックだけの範囲は、値を直接集計した方が速い
+		const size_t firstBlock = ((first + BlockSize - 1) / BlockSize);
+		const size_t lastBlock = (last / BlockSize);
+		if (lastBlock <= firstBlock)
+		{
+			return summarize(first, last);
+		}
+
+		RangeSummary result = summarize(first, (firstBlock * BlockSize));
+		result.merge(summarize((lastBlock * BlockSize), last));
+
+		for (size_t l = (firstBlock + m_leafCount), r = (lastBlock + m_leafCount); l < r; l >>= 1, r >>= 1)
+		{
+			if (l & 1)
+			{
+				result.merge(m_nodes[l++]);
+			}
+			if (r & 1)
+			{
+				result.merge(m_nodes[--r]);
+			}
+		}
+		return result;
+	}
+
+	void ColumnSegmentTree::grow(size_t leafCount)
+	{
+		Array<RangeSummary> nodes((leafCount * 2), RangeSummary{});
+		std::copy_n((m_nodes.begin() + m_leafCount), m_leafCount, (nodes.begin() + leafCount));
+		m_nodes = std::move(nodes);
+		m_leafCount = leafCount;
+
+		for (size_t i = (m_leafCount - 1); 0 < i; --i)
+		{
+			m_nodes[i] = m_nodes[i * 2];
+			m_nodes[i].merge(m_nodes[i * 2 + 1]);
+		}
+	}
+
+	void ColumnSegmentTree::updateBlock(size_t block)
+	{
+		size_t i = (m_leafCount + block);
+		m_nodes[i] = summarize((block * BlockSize), Min(m_values.size(), ((block + 1) * BlockSize)));
+
+		// 根までの親を子から作り直す
+		for (i >>= 1; 0 < i; i >>= 1)
+		{
+			m_nodes[i] = m_nodes[i * 2];
+			m_nodes[i].merge(m_nodes[i * 2 + 1]);
+		}
+	}
+
+	void ColumnSegmentTree::updateBlocksFrom(size_t firstBlock)
+	{
+		const size_t blockCount = ((m_values.size() + BlockSize - 1) / BlockSize);
+		if (blockCount <= firstBlock)
+		{
+			return;
+		}
+		if (m_leafCount < blockCount)
+		{
+			grow(std::bit_ceil(blockCount));
+		}
+
+		for (size_t block = firstBlock; block < blockCount; ++block)
+		{
+			m_nodes[m_leafCount + block] = summarize((block * BlockSize), Min(m_values.size(), ((block + 1) * BlockSize)));
+		}
+
+		// 親は作り直したブロックの上の節点だけを、下の段から順に作り直す
+		for (size_t l = ((m_leafCount + firstBlock) >> 1), r = ((m_leafCount + blockCount - 1) >> 1); 0 < l; l >>= 1, r >>= 1)
+		{
+			for (size_t i = l; i <= r; ++i)
+			{
+				m_nodes[i] = m_nodes[i * 2];
+				m_nodes[i].merge(m_nodes[i * 2 + 1]);
+			}
+		}
+	}
+
+	RangeSummary ColumnSegmentTree::summarize(size_t first, size_t last) const noexcept
+	{
+		RangeSummary result;
+		for (size_t row = first; row < last; ++row)
+		{
+			if (const double value = m_values[row]; not std::isnan(value))
+			{
+				result.add(value);
+			}
+		}
+		return result;
+	}
+
+	void RangeAggregator::clear()
+	{
+		m_builder.cancel();
+		m_columns.clear();
+	}
+
+	void RangeAggregator::invalidate(size_t firstColumn, size_t lastColumn)
+	{
+		// 作っている途中の区間木に、捨てる列が含まれているかもしれない
+		m_builder.cancel();
+
+		for (size_t column = firstColumn; column < lastColumn; ++column)
+		{
+			m_columns.erase(column);
+		}
+	}
+
+	void RangeAggregator::cancel()
+	{
+		m_builder.cancel();
+	}
+
+	bool RangeAggregator::isBusy() const noexcept
+	{
+		return m_builder.isBusy();
+	}
+
+	void RangeAggregator::updateCell(const RowViewSource& view, size_t row, size_t column)
+	{
+		const auto it = m_columns.find(column);
+		if ((it == m_columns.end()) || (it->second.size() <= row))
+		{
+			return;
+		}
+
+		Array<double> value;
+		ReadValues(view, column, row, (row + 1), value);
+		it->second.set(row, value.front());
+	}
+
+	Optional<RangeSummary> RangeAggregator::query(const RowViewSource& view, const IndexRange& rows, const IndexRange& columns)
+	{
+		applyBuildResult();
+
+		const IndexRange queryRows{ rows.first, Min(rows.last, view.rowCount()) };
+		const IndexRange queryColumns{ columns.first, Min(columns.last, view.columnCount()) };
+
+		RangeSummary result;
+		Array<double> values;
+		const auto summarizeDirect = [&](size_t column, size_t first, size_t last)
+		{
+			values.clear();
+			ReadValues(view, column, first, last, values);
+			for (const double value : values)
+			{
+				if (not std::isnan(value))
+				{
+					result.add(value);
+				}
+			}
+		};
+
+		// 狭い範囲は、区間木を作るより直接読む方が速い
+		if ((static_cast<uint64>(queryRows.size()) * queryColumns.size()) <= DirectCellCount)
+		{
+			for (size_t column = queryColumns.first; column < queryColumns.last; ++column)
+			{
+				summarizeDirect(column, queryRows.first, queryRows.last);
+			}
+			return result;
+		}
+
+		// 区間木に加える前の増えた行は、少なければ直接読む
+		uint64 directCellCount = 0;
+		for (size_t column = queryColumns.first; column < queryColumns.last; ++column)
+		{
+			const auto it = m_columns.find(column);
+			if (it == m_columns.end())
+			{
+				return none;
+			}
+
+			const size_t treeLast = Min(queryRows.last, it->second.size());
+			result.merge(it->second.query(queryRows.first, treeLast));
+
+			const IndexRange tailRows{ Max(queryRows.first, treeLast), queryRows.last };
+			directCellCount += tailRows.size();
+			if (DirectCellCount < directCellCount)
+			{
+				return none;
+			}
+			summarizeDirect(column, tailRows.first, tailRows.last);
+		}
+		return result;
+	}
+
+	void RangeAggregator::build(const RowViewSource& view, const IndexRange& columns)
+	{
+		const size_t rowCount = view.rowCount();
+		const IndexRange buildColumns{ columns.first, Min(columns.last, view.columnCount()) };
+
+		// 区間木が無い列は最初から、行が足りない列は足りない行だけを読む
+		Array<std::pair<size_t, size_t>> jobs;
+		size_t firstRow = rowCount;
+		for (size_t column = buildColumns.first; column < buildColumns.last; ++column)
+		{
+			const auto it = m_columns.find(column);
+			const size_t treeSize = ((it == m_columns.end()) ? 0 : it->second.size());
+			if (treeSize < rowCount)
+			{
+				jobs.emplace_back(column, treeSize);
+				firstRow = Min(firstRow, treeSize);
+			}
+		}
+		if (jobs.isEmpty() || (m_builder.isBusy() && (m_buildColumns == buildColumns)))
+		{
+			return;
+		}
+
+		// 表示の対応表は読んでいる間も書き換わるので、読む行の分だけ写して渡す
+		// 並べ替えも絞り込みもしていなければ、表示上の行は元の行と同じなので写さない
+		const bool hasRows = view.hasRows();
+		const size_t rowOffset = (hasRows ? firstRow : 0);
+		Array<size_t> sourceRows;
+		if (hasRows)
+		{
+			sourceRows.resize(rowCount - firstRow);
+			for (size_t row = firstRow; row < rowCount; ++row)
+			{
+				sourceRows[row - firstRow] = view.toSourceRow(row);
+			}
+		}
+
+		m_buildColumns = buildColumns;
+		m_builder.start([source = view.source(), sourceRowCount = view.source()->rowCount(), hasRows, rowOffset, rowCount, jobs = std::move(jobs), sourceRows = std::move(sourceRows)]
+			(std::stop_token stopToken) mutable -> Optional<Array<ColumnValues>>
+		{
+			RowViewSource snapshot{ source };
+			if (hasRows)
+			{
+				snapshot.setRows(std::move(sourceRows), sourceRowCount);
+			}
+
+			Array<ColumnValues> result;
+			for (const auto& [column, columnFirstRow] : jobs)
+			{
+				ColumnValues read;
+				read.column = column;
+				read.firstRow = columnFirstRow;
+				if (not ReadValues(snapshot, column, (columnFirstRow - rowOffset), (rowCount - rowOffset), read.values, stopToken))
+				{
+					return none;
+				}
+
+				if (columnFirstRow == 0)
+				{
+					read.tree = ColumnSegmentTree{ std::move(read.values) };
+				}
+				result.push_back(std::move(read));
+			}
+			return result;
+		});
+	}
+
+	void RangeAggregator::applyBuildResult()
+	{
+		auto result = m_builder.takeResult();
+		if (not result)
+		{
+			return;
+		}
+
+		for (auto& values : *result)
+		{
+			if (values.firstRow == 0)
+			{
+				m_columns[values.column] = std::move(values.tree);
+				continue;
+			}
+
+			// 読んでいる間に捨てられた区間木や、別の長さに伸ばされた区間木には加えない
+			const auto it = m_columns.find(values.column);
+			if ((it != m_columns.end()) && (it->second.size() == values.firstRow))
+			{
+				it->second.append(values.values);
+			}
+		}
+	}
+}
@@ -0,0 +1,642 @@
+﻿# include <bit>
+# include "SimpleGridViewer/RowFilter.hpp"
+# include "SimpleGridViewer/ColumnarStore.hpp"
+# include "SimpleGridViewer/Parallel.hpp"
+# include "SimpleGridViewer/SubstringSearcher.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace
+	{
+		// 2^63 。これ以上の値は int64 で表せない
+		constexpr double Int64Limit = 9223372036854775808.0;
+
+		// [firstWord, lastWord) の語のうち、立っているビットの行だけを test で調べ直す
+		template <class Test>
+		void RetestSetBits(Array<uint64>& words, size_t firstWord, size_t lastWord, Test test)
+		{
+			for (size_t word = firstWord; word < lastWord; ++word)
+			{
+				uint64 result = words[word];
+				for (uint64 bits = result; bits; bits &= (bits - 1))
+				{
+					const int32 bit = std::countr_zero(bits);
+					if (not test(word * WordBits + bit))
+					{
+						result &= ~(uint64{ 1 } << bit);
+					}
+				}
+				words[word] = result;
+			}
+		}
+
+		bool InRange(double value, const FilterCondition& condition) noexcept
+		{
+			return ((not condition.min || (*condition.min <= value))
+				&& (not condition.max || (value <= *condition.max)));
+		}
+
+		// 64 個の値のうち [min, max] に収まるものをビットにまとめる
+		uint64 RangeMask(const double* values, double min, double max) noexcept
+		{
+			uint64 mask = 0;
+		# if SIMPLEGRIDVIEWER_AVX2
+			const __m256d lower = _mm256_set1_pd(min);
+			const __m256d upper = _mm256_set1_pd(max);
+			for (size_t i = 0; i < WordBits; i += 4)
+			{
+				const __m256d value = _mm256_loadu_pd(values + i);
+				const __m256d inside = _mm256_and_pd(_mm256_cmp_pd(lower, value, _CMP_LE_OQ), _mm256_cmp_pd(value, upper, _CMP_LE_OQ));
+				mask |= (static_cast<uint64>(_mm256_movemask_pd(inside)) << i);
+			}
+		# elif SIMPLEGRIDVIEWER_SSE2
+			const __m128d lower = _mm_set1_pd(min);
+			const __m128d upper = _mm_set1_pd(max);
+			for (size_t i = 0; i < WordBits; i += 2)
+			{
+				const __m128d value = _mm_loadu_pd(values + i);
+				const __m128d inside = _mm_and_pd(_mm_cmple_pd(lower, value), _mm_cmple_pd(value, upper));
+				mask |= (static_cast<uint64>(_mm_movemask_pd(inside)) << i);
+			}
+		# else
+			for (size_t i = 0; i < WordBits; ++i)
+			{
+				mask |= (static_cast<uint64>((min <= values[i]) && (values[i] <= max)) << i);
+			}
+		# endif
+			return mask;
+		}
+
+		uint64 RangeMask(const int64* values, int64 min, int64 max) noexcept
+		{
+			uint64 mask = 0;
+		# if SIMPLEGRIDVIEWER_AVX2
+			// AVX2 には 64 ビット整数の「より大きい」しか無いので、範囲の外側を求めて反転する
+			const __m256i lower = _mm256_set1_epi64x(min);
+			const __m256i upper = _mm256_set1_epi64x(max);
+			for (size_t i = 0; i < WordBits; i += 4)
+			{
+				const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+				const __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(lower, value), _mm256_cmpgt_epi64(value, upper));
+				mask |= (static_cast<uint64>(~_mm256_movemask_pd(_mm256_castsi256_pd(outside)) & 0xF) << i);
+			}
+		# else
+			for (size_t i = 0; i < WordBits; ++i)
+			{
+				mask |= (static_cast<uint64>((min <= values[i]) && (values[i] <= max)) << i);
+			}
+		# endif
+			return mask;
+		}
+
+		// 条件の範囲を int64 の閉区間に直す。該当する整数が無ければ none
+		Optional<std::pair<int64, int64>> ToInt64Range(const FilterCondition& condition)
+		{
+			int64 lower = std::numeric_limits<int64>::min();
+			int64 upper = std::numeric_limits<int64>::max();
+
+			if (condition.min)
+			{
+				if (std::isnan(*condition.min) || (Int64Limit <= *condition.min))
+				{
+					return none;
+				}
+				if (-Int64Limit < *condition.min)
+				{
+					lower = static_cast<int64>(std::ceil(*condition.min));
+				}
+			}
+
+			if (condition.max)
+			{
+				if (std::isnan(*condition.max) || (*condition.max < -Int64Limit))
+				{
+					return none;
+				}
+				if (*condition.max < Int64Limit)
+				{
+					upper = static_cast<int64>(std::floor(*condition.max));
+				}
+			}
+
+			if (upper < lower)
+			{
+				return none;
+			}
+			return std::pair{ lower, upper };
+		}
+
+		template <class Type>
+		void ApplyRange(const NumericColumn<Type>& column, Type lower, Type upper, RowBitmap& bitmap, size_t threadCount)
+		{
+			Array<uint64>& words = bitmap.words();
+			const Array<Type>& values = column.values();
+			const size_t rowCount = bitmap.size();
+			const bool hasNull = (column.validity().nullCount() != 0);
+
+			ParallelForWords(words.size(), threadCount, [&](size_t firstWord, size_t lastWord)
+			{
+				for (size_t word = firstWord; word < lastWord; ++word)
+				{
+					// 既に外れている 64 行は比べない
+					if (words[word] == 0)
+					{
+						continue;
+					}
+
+					const size_t first = (word * WordBits);
+					if ((first + WordBits) <= rowCount)
+					{
+						words[word] &= RangeMask(values.data() + first, lower, upper);
+					}
+					else
+					{
+						RetestSetBits(words, word, (word + 1), [&](size_t row) { return ((lower <= values[row]) && (values[row] <= upper)); });
+					}
+				}
+
+				// null の値は 0 が入っているので、比較の結果から除く
+				if (hasNull)
+				{
+					RetestSetBits(words, firstWord, lastWord, [&](size_t row) { return (not column.isNull(row)); });
+				}
+			});
+		}
+
+		// 表示する文字列に対する判定。正規表現を持つので、スレッドごとに作る
+		class TextMatcher
+		{
+		public:
+			explicit TextMatcher(const FilterCondition& condition)
+				: m_condition{ condition }
+				, m_utf8{ Unicode::ToUTF8(condition.text) }
+				, m_searcher{ condition.text }
+			{
+				if (condition.kind == FilterCondition::Kind::Regex)
+				{
+					m_regex = RegExp{ condition.text };
+				}
+			}
+
+			bool operator ()(StringView text) const
+			{
+				switch (m_condition.kind)
+				{
+				case FilterCondition::Kind::Equals:
+					return (text == m_condition.text);
+				case FilterCondition::Kind::Contains:
+					return m_searcher.contains(text);
+				case FilterCondition::Kind::Range:
+					{
+						const auto value = ParseOpt<double>(text);
+						return (value && InRange(*value, m_condition));
+					}
+				case FilterCondition::Kind::Regex:
+					return (m_regex.isValid() && (not m_regex.search(text).isEmpty()));
+				}
+				return false;
+			}
+
+			// 文字列の列は UTF-8 のまま比べる
+			bool operator ()(std::string_view utf8)
+			{
+				switch (m_condition.kind)
+				{
+				case FilterCondition::Kind::Equals:
+					return (utf8 == m_utf8);
+				case FilterCondition::Kind::Contains:
+					return m_searcher.contains(utf8);
+				default:
+					m_buffer = Unicode::FromUTF8(utf8);
+					return (*this)(StringView{ m_buffer });
+				}
+			}
+
+		private:
+			const FilterCondition& m_condition;
+
+			std::string m_utf8;
+
+			SubstringSearcher m_searcher;
+
+			RegExp m_regex;
+
+			String m_buffer;
+		};
+
+		void ApplyColumnar(const ColumnarStore& store, const FilterCondition& condition, RowBitmap& bitmap, size_t threadCount)
+		{
+			const Column& column = store.column(condition.column);
+			const ColumnType type = GetColumnType(column);
+			Array<uint64>& words = bitmap.words();
+
+			if (condition.kind == FilterCondition::Kind::Range)
+			{
+				if (type == ColumnType::Double)
+				{
+					const double lower = condition.min.value_or(-std::numeric_limits<double>::infinity());
+					const double upper = condition.max.value_or(std::numeric_limits<double>::infinity());
+					ApplyRange(std::get<DoubleColumn>(column), lower, upper, bitmap, threadCount);
+					return;
+				}
+
+				if (type == ColumnType::Int64)
+				{
+					if (const auto range = ToInt64Range(condition))
+					{
+						ApplyRange(std::get<Int64Column>(column), range->first, range->second, bitmap, threadCount);
+					}
+					else
+					{
+						std::fill(words.begin(), words.end(), uint64{ 0 });
+					}
+					return;
+				}
+			}
+
+			if (type == ColumnType::Dictionary)
+			{
+				// 辞書の文字列ごとに 1 度だけ判定し、各行は符号で引く
+				const auto& values = std::get<DictionaryColumn>(column);
+				const Array<String>& dictionary = values.dictionary();
+				Array<uint8> matches(dictionary.size());
+				TextMatcher matcher{ condition };
+				for (size_t code = 0; code < dictionary.size(); ++code)
+				{
+					matches[code] = matcher(StringView{ dictionary[code] });
+				}
+
+				ParallelForWords(words.size(), threadCount, [&](size_t firstWord, size_t lastWord)
+				{
+					RetestSetBits(words, firstWord, lastWord, [&](size_t row) { return (matches[values.getCode(row)] != 0); });
+				});
+				return;
+			}
+
+			if (type == ColumnType::String)
+			{
+				const auto& values = std::get<StringColumn>(column);
+				ParallelForWords(words.size(), threadCount, [&](size_t firstWord, size_t lastWord)
+				{
+					TextMatcher matcher{ condition };
+					RetestSetBits(words, firstWord, lastWord, [&](size_t row) { return matcher(values.get(row)); });
+				});
+				return;
+			}
+
+			// 数値と真偽値の列は、表示する文字列に直して判定する
+			ParallelForWords(words.size(), threadCount, [&](size_t firstWord, size_t lastWord)
+			{
+				TextMatcher matcher{ condition };
+				String text;
+				RetestSetBits(words, firstWord, lastWord, [&](size_t row)
+				{
+					FormatCell(column, row, text);
+					return matcher(StringView{ text });
+				});
+			});
+		}
+
+		bool ApplyCells(const ICellSource& source, const FilterCondition& condition, RowBitmap& bitmap, size_t threadCount, const std::stop_token& stopToken)
+		{
+			Array<uint64>& words = bitmap.words();
+			const size_t rowCount = bitmap.size();
+			const size_t blockCount = ((rowCount + FetchRows - 1) / FetchRows);
+			constexpr size_t BlockWords = (FetchRows / WordBits);
+
+			ParallelFor(blockCount, threadCount, [&](size_t block)
+			{
+				const size_t firstWord = (block * BlockWords);
+				const size_t lastWord = Min(firstWord + BlockWords, words.size());
+
+				// 既に全ての行が外れている塊は問い合わせない
+				if (stopToken.stop_requested()
+					|| std::all_of(words.begin() + firstWord, words.begin() + lastWord, [](uint64 word) { return (word == 0); }))
+				{
+					return;
+				}
+
+				const size_t first = (block * FetchRows);
+				CellWindow window;
+				window.reset({ first, Min(first + FetchRows, rowCount) }, { condition.column, condition.column + 1 });
+				source.fetch(window);
+
+				TextMatcher matcher{ condition };
+				RetestSetBits(words, firstWord, lastWord, [&](size_t row) { return matcher(StringView{ window.at(row, condition.column) }); });
+			});
+
+			return (not stopToken.stop_requested());
+		}
+	}
+
+	RowBitmap::RowBitmap(size_t size, bool value)
+		: m_words(((size + WordBits - 1) / WordBits), (value ? ~uint64{ 0 } : uint64{ 0 }))
+		, m_size{ size }
+	{
+		if (value && (size % WordBits))
+		{
+			m_words.back() = ((uint64{ 1 } << (size % WordBits)) - 1);
+		}
+	}
+
+	size_t RowBitmap::size() const noexcept
+	{
+		return m_size;
+	}
+
+	size_t RowBitmap::count() const noexcept
+	{
+		size_t count = 0;
+		for (const uint64 word : m_words)
+		{
+			count += std::popcount(word);
+		}
+		return count;
+	}
+
+	bool RowBitmap::test(size_t row) const noexcept
+	{
+		return ((row < m_size) && ((m_words[row / WordBits] >> (row % WordBits)) & 1));
+	}
+
+	void RowBitmap::set(size_t row, bool value) noexcept
+	{
+		assert(row < m_size);
+		const uint64 bit = (uint64{ 1 } << (row % WordBits));
+		if (value)
+		{
+			m_words[row / WordBits] |= bit;
+		}
+		else
+		{
+			m_words[row / WordBits] &= ~bit;
+		}
+	}
+
+	Array<uint64>& RowBitmap::words() noexcept
+	{
+		return m_words;
+	}
+
+	const Array<uint64>& RowBitmap::words() const noexcept
+	{
+		return m_words;
+	}
+
+	void RowBitmap::eraseLeading(size_t count) noexcept
+	{
+		count = Min(count, m_size);
+		const size_t wordShift = (count / WordBits);
+		const size_t bitShift = (count % WordBits);
+		const size_t size = (m_size - count);
+		const size_t wordCount = ((size + WordBits - 1) / WordBits);
+
+		// size() を超える位置のビットは 0 なので、詰めた後も 0 のまま
+		for (size_t i = 0; i < wordCount; ++i)
+		{
+			uint64 word = (m_words[i + wordShift] >> bitShift);
+			if (bitShift && ((i + wordShift + 1) < m_words.size()))
+			{
+				word |= (m_words[i + wordShift + 1] << (WordBits - bitShift));
+			}
+			m_words[i] = word;
+		}
+		m_words.resize(wordCount);
+		m_size = size;
+	}
+
+	void RowBitmap::resize(size_t size)
+	{
+		m_words.resize(((size + WordBits - 1) / WordBits), 0);
+		if ((size < m_size) && (size % WordBits))
+		{
+			m_words.back() &= ((uint64{ 1 } << (size % WordBits)) - 1);
+		}
+		m_size = size;
+	}
+
+	bool RowBitmap::replace(const RowBitmap& tested, const RowBitmap& passed)
+	{
+		assert(tested.size() == passed.size());
+		assert(m_size <= passed.size());
+
+		const size_t oldSize = m_size;
+		resize(passed.size());
+
+		bool changed = false;
+		for (size_t i = 0; i < m_words.size(); ++i)
+		{
+			if (tested.m_words[i] == 0)
+			{
+				continue;
+			}
+
+			const uint64 word = ((m_words[i] & ~tested.m_words[i]) | passed.m_words[i]);
+
+			// 伸ばした行のビットは比べない
+			const size_t first = (i * WordBits);
+			const uint64 oldBits = ((first + WordBits) <= oldSize) ? ~uint64{ 0 }
+				: (first < oldSize) ? ((uint64{ 1 } << (oldSize - first)) - 1) : 0;
+			changed |= (((m_words[i] ^ word) & oldBits) != 0);
+			m_words[i] = word;
+		}
+		return changed;
+	}
+
+	Array<size_t> RowBitmap::toRows() const
+	{
+		Array<size_t> rows;
+		rows.reserve(count());
+		for (size_t word = 0; word < m_words.size(); ++word)
+		{
+			for (uint64 bits = m_words[word]; bits; bits &= (bits - 1))
+			{
+				rows.push_back(word * WordBits + std::countr_zero(bits));
+			}
+		}
+		return rows;
+	}
+
+	Array<size_t> RowBitmap::select(const Array<size_t>& order) const
+	{
+		Array<size_t> rows;
+		rows.reserve(count());
+		for (const size_t row : order)
+		{
+			if (test(row))
+			{
+				rows.push_back(row);
+			}
+		}
+		return rows;
+	}
+
+	bool FilterCondition::implies(const FilterCondition& other) const
+	{
+		if (column != other.column)
+		{
+			return false;
+		}
+		if (*this == other)
+		{
+			return true;
+		}
+
+		switch (other.kind)
+		{
+		case Kind::Contains:
+			// "abc" を含む・等しいなら "b" を含む
+			return (((kind == Kind::Contains) || (kind == Kind::Equals)) && text.includes(other.text));
+		case Kind::Range:
+			return ((kind == Kind::Range)
+				&& (not other.min || (min && (*other.min <= *min)))
+				&& (not other.max || (max && (*max <= *other.max))));
+		default:
+			return false;
+		}
+	}
+
+	FilterCondition FilterCondition::Equals(size_t column, StringView text)
+	{
+		return{ .kind = Kind::Equals, .column = column, .text = String{ text } };
+	}
+
+	FilterCondition FilterCondition::Contains(size_t column, StringView text)
+	{
+		return{ .kind = Kind::Contains, .column = column, .text = String{ text } };
+	}
+
+	FilterCondition FilterCondition::Range(size_t column, const Optional<double>& min, const Optional<double>& max)
+	{
+		return{ .kind = Kind::Range, .column = column, .min = min, .max = max };
+	}
+
+	FilterCondition FilterCondition::Regex(size_t column, StringView pattern)
+	{
+		return{ .kind = Kind::Regex, .column = column, .text = String{ pattern } };
+	}
+
+	void RowFilter::start(std::shared_ptr<const ICellSource> source, Array<FilterCondition> conditions, size_t threadCount)
+	{
+		assert(source);
+
+		// 終わっていて受け取っていない結果も、条件を狭めた場合の出発点に使う
+		if (auto last = m_task.takeResult())
+		{
+			m_last = std::move(*last);
+		}
+		m_task.cancel();
+		m_partialTask.cancel();
+
+		// 前回の結果から条件を狭めただけなら、前回残った行から始めて、増えた条件だけを判定する
+		std::shared_ptr<const RowBitmap> base;
+		Array<FilterCondition> pending = conditions;
+		const bool narrowed = (m_last.bitmap
+			&& (m_last.source.lock() == source)
+			&& (m_last.version == source->version())
+			&& (m_last.bitmap->size() == source->rowCount())
+			&& std::all_of(m_last.conditions.begin(), m_last.conditions.end(), [&](const FilterCondition& last)
+				{
+					return std::any_of(conditions.begin(), conditions.end(), [&](const FilterCondition& condition) { return condition.implies(last); });
+				}));
+		if (narrowed)
+		{
+			base = m_last.bitmap;
+			std::erase_if(pending, [&](const FilterCondition& condition)
+			{
+				return (std::find(m_last.conditions.begin(), m_last.conditions.end(), condition) != m_last.conditions.end());
+			});
+		}
+
+		m_task.start([source = std::move(source), conditions = std::move(conditions), pending = std::move(pending), base = std::move(base), threadCount](std::stop_token stopToken) -> Optional<Snapshot>
+		{
+			const uint64 version = source->version();
+			auto bitmap = Evaluate(*source, pending, base.get(), threadCount, stopToken);
+			if (not bitmap)
+			{
+				return none;
+			}
+			return Snapshot{ std::make_shared<const RowBitmap>(std::move(*bitmap)), conditions, source, version };
+		});
+	}
+
+	void RowFilter::startPartial(std::shared_ptr<const ICellSource> source, Array<FilterCondition> conditions, RowBitmap rows, size_t threadCount)
+	{
+		assert(source);
+		assert(rows.size() <= source->rowCount());
+
+		m_partialTask.start([source = std::move(source), conditions = std::move(conditions), rows = std::move(rows), threadCount](std::stop_token stopToken) -> Optional<PartialResult>
+		{
+			auto passed = Evaluate(*source, conditions, &rows, threadCount, stopToken);
+			if (not passed)
+			{
+				return none;
+			}
+			return PartialResult{ rows, std::move(*passed) };
+		});
+	}
+
+	void RowFilter::cancel()
+	{
+		m_task.cancel();
+		m_partialTask.cancel();
+	}
+
+	void RowFilter::reset()
+	{
+		cancel();
+		m_last = {};
+	}
+
+	bool RowFilter::isBusy() const noexcept
+	{
+		return (m_task.isBusy() || m_partialTask.isBusy());
+	}
+
+	std::shared_ptr<const RowBitmap> RowFilter::takeResult()
+	{
+		auto last = m_task.takeResult();
+		if (not last)
+		{
+			return nullptr;
+		}
+
+		m_last = std::move(*last);
+		return m_last.bitmap;
+	}
+
+	Optional<RowFilter::PartialResult> RowFilter::takePartialResult()
+	{
+		return m_partialTask.takeResult();
+	}
+
+	Optional<RowBitmap> RowFilter::Evaluate(const ICellSource& source, const Array<FilterCondition>& conditions, const RowBitmap* base, size_t threadCount, std::stop_token stopToken)
+	{
+		threadCount = GetThreadCount(threadCount);
+		const auto* store = dynamic_cast<const ColumnarStore*>(&source);
+
+		RowBitmap bitmap = (base ? *base : RowBitmap{ source.rowCount(), true });
+		for (const auto& condition : conditions)
+		{
+			if (stopToken.stop_requested())
+			{
+				return none;
+			}
+
+			// 存在しない列の条件はどの行も満たさない
+			if (source.columnCount() <= condition.column)
+			{
+				std::fill(bitmap.words().begin(), bitmap.words().end(), uint64{ 0 });
+			}
+			else if (store)
+			{
+				ApplyColumnar(*store, condition, bitmap, threadCount);
+			}
+			else if (not ApplyCells(source, condition, bitmap, threadCount, stopToken))
+			{
+				return none;
+			}
+		}
+		return bitmap;
+	}
+}
@@ -0,0 +1,531 @@
+﻿# include <bit>
+# include <numeric>
+# include "SimpleGridViewer/RowSorter.hpp"
+# include "SimpleGridViewer/ColumnarStore.hpp"
+# include "SimpleGridViewer/Parallel.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace
+	{
+		constexpr uint64 SignBit = (uint64{ 1 } << 63);
+
+		// 1 列分のキー
+		struct SortColumn
+		{
+			enum class Kind
+			{
+				// 数値・真偽値・辞書の列。大小関係を保ったまま uint64 にしたもの
+				Number,
+				// ColumnarStore の文字列の列。 UTF-8 のバイト列の大小は Unicode の符号位置の大小と一致する
+				Utf8,
+				// それ以外の供給元から取り出した文字列
+				String,
+			};
+
+			Kind kind = Kind::Number;
+
+			Array<uint64> numbers;
+
+			// numbers を使う場合の null。 null が無ければ空
+			Array<uint8> nulls;
+
+			Array<std::string_view> utf8;
+
+			Array<String> strings;
+
+			bool isNull(size_t row) const noexcept
+			{
+				return ((not nulls.isEmpty()) && nulls[row]);
+			}
+		};
+
+		uint64 ToOrderedKey(int64 value) noexcept
+		{
+			return (static_cast<uint64>(value) ^ SignBit);
+		}
+
+		// 負の数は全てのビットを、正の数は符号ビットを反転すると、整数としての大小が浮動小数点数の大小と一致する
+		uint64 ToOrderedKey(double value) noexcept
+		{
+			const uint64 bits = std::bit_cast<uint64>(value);
+			return ((bits & SignBit) ? ~bits : (bits | SignBit));
+		}
+
+		template <class IsNull, class ToKey>
+		void ExtractNumbers(size_t rowCount, size_t threadCount, bool hasNull, SortColumn& out, IsNull isNull, ToKey toKey)
+		{
+			out.kind = SortColumn::Kind::Number;
+			out.numbers.resize(rowCount);
+			if (hasNull)
+			{
+				out.nulls.resize(rowCount);
+			}
+
+			ParallelForRows(rowCount, threadCount, [&](size_t first, size_t last)
+			{
+				for (size_t row = first; row < last; ++row)
+				{
+					out.numbers[row] = toKey(row);
+					if (hasNull)
+					{
+						out.nulls[row] = isNull(row);
+					}
+				}
+			});
+		}
+
+		template <class ColumnType, class ToKey>
+		void ExtractNumbers(const ColumnType& column, size_t rowCount, size_t threadCount, SortColumn& out, ToKey toKey)
+		{
+			ExtractNumbers(rowCount, threadCount, (column.validity().nullCount() != 0), out, [&](size_t row) { return column.isNull(row); }, toKey);
+		}
+
+		void ExtractColumnar(const ColumnarStore& store, size_t columnIndex, size_t rowCount, size_t threadCount, SortColumn& out)
+		{
+			const Column& column = store.column(columnIndex);
+			switch (GetColumnType(column))
+			{
+			case ColumnType::Int64:
+				{
+					const auto& values = std::get<Int64Column>(column);
+					ExtractNumbers(values, rowCount, threadCount, out, [&](size_t row) { return ToOrderedKey(values.get(row)); });
+					break;
+				}
+			case ColumnType::Double:
+				{
+					const auto& values = std::get<DoubleColumn>(column);
+					ExtractNumbers(values, rowCount, threadCount, out, [&](size_t row) { return ToOrderedKey(values.get(row)); });
+					break;
+				}
+			case ColumnType::Bool:
+				{
+					const auto& values = std::get<BoolColumn>(column);
+					ExtractNumbers(values, rowCount, threadCount, out, [&](size_t row) { return static_cast<uint64>(values.get(row)); });
+					break;
+				}
+			case ColumnType::Dictionary:
+				{
+					// 辞書の文字列だけを並べ、各行は辞書の中での順位で比べる
+					const auto& values = std::get<DictionaryColumn>(column);
+					const Array<String>& dictionary = values.dictionary();
+					Array<DictionaryColumn::Code> order(dictionary.size());
+					std::iota(order.begin(), order.end(), DictionaryColumn::Code{ 0 });
+					std::sort(order.begin(), order.end(), [&](auto a, auto b) { return (dictionary[a] < dictionary[b]); });
+
+					Array<uint64> ranks(dictionary.size());
+					for (size_t i = 0; i < order.size(); ++i)
+					{
+						ranks[order[i]] = i;
+					}
+
+					// 空文字列も、他の列の空のセルと同じく null として扱う
+					const auto empty = std::find_if(dictionary.begin(), dictionary.end(), [](const String& s) { return s.isEmpty(); });
+					const Optional<DictionaryColumn::Code> emptyCode = ((empty != dictionary.end()) ? Optional<DictionaryColumn::Code>{ static_cast<DictionaryColumn::Code>(empty - dictionary.begin()) } : none);
+					const bool hasNull = (values.validity().nullCount() || emptyCode);
+					ExtractNumbers(rowCount, threadCount, hasNull, out,
+						[&](size_t row) { return (values.isNull(row) || (values.getCode(row) == emptyCode)); },
+						[&](size_t row) { return ranks[values.getCode(row)]; });
+					break;
+				}
+			case ColumnType::String:
+				{
+					const auto& values = std::get<StringColumn>(column);
+					out.kind = SortColumn::Kind::Utf8;
+					out.utf8.resize(rowCount);
+					ParallelForRows(rowCount, threadCount, [&](size_t first, size_t last)
+					{
+						for (size_t row = first; row < last; ++row)
+						{
+							out.utf8[row] = values.get(row);
+						}
+					});
+					break;
+				}
+			}
+		}
+
+		// 表示用の文字列を取り出し、全て数値として読めれば数値のキーにする
+		bool ExtractCells(const ICellSource& source, size_t column, size_t rowCount, size_t threadCount, const std::stop_token& stopToken, SortColumn& out)
+		{
+			out.kind = SortColumn::Kind::String;
+			out.strings.resize(rowCount);
+
+			CellWindow window;
+			for (size_t first = 0; first < rowCount; first += FetchRows)
+			{
+				if (stopToken.stop_requested())
+				{
+					return false;
+				}
+
+				const size_t last = Min(first + FetchRows, rowCount);
+				window.reset({ first, last }, { column, column + 1 });
+				source.fetch(window);
+				for (size_t row = first; row < last; ++row)
+				{
+					std::swap(out.strings[row], window.at(row, column));
+				}
+			}
+
+			out.numbers.resize(rowCount);
+			out.nulls.resize(rowCount);
+			std::atomic<bool> isNumeric{ true };
+			ParallelForRows(rowCount, threadCount, [&](size_t first, size_t last)
+			{
+				for (size_t row = first; (row < last) && isNumeric.load(std::memory_order_relaxed); ++row)
+				{
+					const String& cell = out.strings[row];
+					if (cell.isEmpty())
+					{
+						out.nulls[row] = true;
+					}
+					else if (const auto value = ParseOpt<double>(cell))
+					{
+						out.numbers[row] = ToOrderedKey(*value);
+					}
+					else
+					{
+						isNumeric = false;
+					}
+				}
+			});
+
+			if (isNumeric)
+			{
+				out.kind = SortColumn::Kind::Number;
+				out.strings.clear();
+				out.strings.shrink_to_fit();
+			}
+			else
+			{
+				out.numbers.clear();
+				out.nulls.clear();
+			}
+			return true;
+		}
+
+		struct KeyedRow
+		{
+			uint64 key;
+
+			size_t row;
+		};
+
+		// 下位の桁から 8 ビットずつ並べる安定な基数ソート
+		// 桁ごとに、塊ごとの度数を数えて書き込み先を決め、各塊を並列に書き込む
+		bool RadixSort(Array<KeyedRow>& items, size_t threadCount, const std::stop_token& stopToken)
+		{
+			const size_t size = items.size();
+			const size_t chunkCount = Clamp<size_t>((size / MinChunkRows), 1, threadCount);
+			const auto chunkBegin = [&](size_t i) { return (size * i / chunkCount); };
+
+			Array<KeyedRow> buffer(size);
+			Array<std::array<size_t, 256>> counts(chunkCount);
+
+			for (int32 shift = 0; shift < 64; shift += 8)
+			{
+				if (stopToken.stop_requested())
+				{
+					return false;
+				}
+
+				ParallelFor(chunkCount, threadCount, [&](size_t c)
+				{
+					auto& count = counts[c];
+					count.fill(0);
+					for (size_t i = chunkBegin(c); i < chunkBegin(c + 1); ++i)
+					{
+						++count[(items[i].key >> shift) & 0xFF];
+					}
+				});
+
+				// 全ての値でこの桁が同じなら、並べ替えても変わらない
+				bool sameDigit = false;
+				for (size_t digit = 0; digit < 256; ++digit)
+				{
+					size_t total = 0;
+					for (const auto& count : counts)
+					{
+						total += count[digit];
+					}
+					if (total == size)
+					{
+						sameDigit = true;
+						break;
+					}
+				}
+				if (sameDigit)
+				{
+					continue;
+				}
+
+				// 桁の値の順、同じ桁の値の中では塊の順に書き込み先を割り当てる
+				size_t offset = 0;
+				for (size_t digit = 0; digit < 256; ++digit)
+				{
+					for (auto& count : counts)
+					{
+						const size_t n = count[digit];
+						count[digit] = offset;
+						offset += n;
+					}
+				}
+
+				ParallelFor(chunkCount, threadCount, [&](size_t c)
+				{
+					auto& position = counts[c];
+					for (size_t i = chunkBegin(c); i < chunkBegin(c + 1); ++i)
+					{
+						buffer[position[(items[i].key >> shift) & 0xFF]++] = items[i];
+					}
+				});
+				items.swap(buffer);
+			}
+			return true;
+		}
+
+		// 塊ごとに std::stable_sort で並べてから、隣り合う塊を並列に併合していく
+		template <class Less>
+		bool ParallelStableSort(std::span<size_t> rows, Less less, size_t threadCount, const std::stop_token& stopToken)
+		{
+			const size_t size = rows.size();
+			const size_t chunkCount = Clamp<size_t>((size / MinChunkRows), 1, threadCount);
+			const auto chunkBegin = [&](size_t i) { return (size * Min(i, chunkCount) / chunkCount); };
+
+			ParallelFor(chunkCount, threadCount, [&](size_t c)
+			{
+				std::stable_sort(rows.begin() + chunkBegin(c), rows.begin() + chunkBegin(c + 1), less);
+			});
+
+			Array<size_t> buffer(size);
+			std::span<size_t> source = rows;
+			std::span<size_t> destination = buffer;
+			for (size_t width = 1; width < chunkCount; width *= 2)
+			{
+				if (stopToken.stop_requested())
+				{
+					return false;
+				}
+
+				// std::merge は等しい要素について前の範囲のものを先に置くので、安定性が保たれる
+				const size_t pairCount = ((chunkCount + 2 * width - 1) / (2 * width));
+				ParallelFor(pairCount, threadCount, [&](size_t p)
+				{
+					const size_t first = chunkBegin(2 * width * p);
+					const size_t middle = chunkBegin(2 * width * p + width);
+					const size_t last = chunkBegin(2 * width * (p + 1));
+					std::merge(source.begin() + first, source.begin() + middle, source.begin() + middle, source.begin() + last, destination.begin() + first, less);
+				});
+				std::swap(source, destination);
+			}
+
+			// 併合の回数が奇数の場合は、作業用の領域に結果がある
+			if (source.data() != rows.data())
+			{
+				std::copy(source.begin(), source.end(), rows.begin());
+			}
+			return true;
+		}
+
+		uint64 ToPrefixKey(std::string_view value) noexcept
+		{
+			uint64 key = 0;
+			for (size_t i = 0; i < 8; ++i)
+			{
+				key = ((key << 8) | ((i < value.size()) ? static_cast<uint8>(value[i]) : 0));
+			}
+			return key;
+		}
+
+		uint64 ToPrefixKey(const String& value) noexcept
+		{
+			const uint64 first = ((0 < value.size()) ? value[0] : 0);
+			const uint64 second = ((1 < value.size()) ? value[1] : 0);
+			return ((first << 32) | second);
+		}
+
+		// 先頭の 8 バイト分を数値のキーにして基数ソートで並べ、先頭が同じ行の間だけ文字列全体で比べ直す
+		template <class Keys>
+		bool SortByStrings(Array<size_t>& rows, const Keys& keys, bool ascending, size_t threadCount, const std::stop_token& stopToken)
+		{
+			// 空のセルは今の順のまま末尾に回す
+			Array<KeyedRow> items;
+			Array<size_t> emptyRows;
+			items.reserve(rows.size());
+			for (const size_t row : rows)
+			{
+				if (keys[row].empty())
+				{
+					emptyRows.push_back(row);
+				}
+				else
+				{
+					const uint64 key = ToPrefixKey(keys[row]);
+					items.push_back({ (ascending ? key : ~key), row });
+				}
+			}
+
+			if (not RadixSort(items, threadCount, stopToken))
+			{
+				return false;
+			}
+
+			// 先頭が同じ行の範囲を集める。大きな範囲はそれ自体を並列に並べる
+			Array<IndexRange> smallRuns;
+			Array<IndexRange> largeRuns;
+			for (size_t first = 0; first < items.size();)
+			{
+				size_t last = (first + 1);
+				while (last < items.size() && items[last].key == items[first].key)
+				{
+					++last;
+				}
+
+				if (MinChunkRows <= (last - first))
+				{
+					largeRuns.push_back({ first, last });
+				}
+				else if (1 < (last - first))
+				{
+					smallRuns.push_back({ first, last });
+				}
+				first = last;
+			}
+
+			for (size_t i = 0; i < items.size(); ++i)
+			{
+				rows[i] = items[i].row;
+			}
+			std::copy(emptyRows.begin(), emptyRows.end(), rows.begin() + items.size());
+
+			const auto less = [&](size_t a, size_t b)
+			{
+				return (ascending ? (keys[a] < keys[b]) : (keys[b] < keys[a]));
+			};
+
+			ParallelForRows(smallRuns.size(), threadCount, [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; ++i)
+				{
+					std::stable_sort(rows.begin() + smallRuns[i].first, rows.begin() + smallRuns[i].last, less);
+				}
+			});
+
+			for (const auto& run : largeRuns)
+			{
+				if (not ParallelStableSort(std::span<size_t>{ rows.data() + run.first, run.size() }, less, threadCount, stopToken))
+				{
+					return false;
+				}
+			}
+			return (not stopToken.stop_requested());
+		}
+
+		bool SortByNumbers(Array<size_t>& rows, const SortColumn& column, bool ascending, size_t threadCount, const std::stop_token& stopToken)
+		{
+			// null の行は今の順のまま末尾に回し、残りだけを並べる
+			Array<KeyedRow> items;
+			Array<size_t> nullRows;
+			items.reserve(rows.size());
+			for (const size_t row : rows)
+			{
+				if (column.isNull(row))
+				{
+					nullRows.push_back(row);
+				}
+				else
+				{
+					const uint64 key = column.numbers[row];
+					items.push_back({ (ascending ? key : ~key), row });
+				}
+			}
+
+			if (not RadixSort(items, threadCount, stopToken))
+			{
+				return false;
+			}
+
+			for (size_t i = 0; i < items.size(); ++i)
+			{
+				rows[i] = items[i].row;
+			}
+			std::copy(nullRows.begin(), nullRows.end(), rows.begin() + items.size());
+			return true;
+		}
+	}
+
+	void RowSorter::start(std::shared_ptr<const ICellSource> source, Array<SortKey> keys, size_t threadCount)
+	{
+		assert(source);
+		m_task.start([source = std::move(source), keys = std::move(keys), threadCount](std::stop_token stopToken)
+		{
+			return Sort(*source, keys, threadCount, stopToken);
+		});
+	}
+
+	void RowSorter::cancel()
+	{
+		m_task.cancel();
+	}
+
+	bool RowSorter::isBusy() const noexcept
+	{
+		return m_task.isBusy();
+	}
+
+	Optional<Array<size_t>> RowSorter::takeResult()
+	{
+		return m_task.takeResult();
+	}
+
+	Optional<Array<size_t>> RowSorter::Sort(const ICellSource& source, const Array<SortKey>& keys, size_t threadCount, std::stop_token stopToken)
+	{
+		threadCount = GetThreadCount(threadCount);
+		const size_t rowCount = source.rowCount();
+		const size_t columnCount = source.columnCount();
+		const auto* store = dynamic_cast<const ColumnarStore*>(&source);
+
+		Array<size_t> rows(rowCount);
+		std::iota(rows.begin(), rows.end(), size_t{ 0 });
+
+		// 後ろのキーから順に安定な並べ替えを重ねると、前のキーほど優先される
+		for (auto it = keys.rbegin(); it != keys.rend(); ++it)
+		{
+			if (columnCount <= it->column)
+			{
+				continue;
+			}
+
+			SortColumn column;
+			if (store)
+			{
+				ExtractColumnar(*store, it->column, rowCount, threadCount, column);
+			}
+			else if (not ExtractCells(source, it->column, rowCount, threadCount, stopToken, column))
+			{
+				return none;
+			}
+
+			bool completed = false;
+			switch (column.kind)
+			{
+			case SortColumn::Kind::Number:
+				completed = SortByNumbers(rows, column, it->ascending, threadCount, stopToken);
+				break;
+			case SortColumn::Kind::Utf8:
+				completed = SortByStrings(rows, column.utf8, it->ascending, threadCount, stopToken);
+				break;
+			case SortColumn::Kind::String:
+				completed = SortByStrings(rows, column.strings, it->ascending, threadCount, stopToken);
+				break;
+			}
+
+			if (not completed)
+			{
+				return none;
+			}
+		}
+		return rows;
+	}
+}
@@ -0,0 +1,216 @@
+﻿# include "SimpleGridViewer/RowViewSource.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace
+	{
+		// 逆向きの対応表で、表示されていない元の行を表す値
+		constexpr size_t NotDisplayed = std::numeric_limits<size_t>::max();
+	}
+
+	RowViewSource::RowViewSource(std::shared_ptr<ICellSource> source)
+		: m_source{ std::move(source) }
+	{
+		assert(m_source);
+	}
+
+	const std::shared_ptr<ICellSource>& RowViewSource::source() const noexcept
+	{
+		return m_source;
+	}
+
+	void RowViewSource::setRows(Array<size_t> rows, size_t sourceRowCount, bool showAppended)
+	{
+		m_rows = std::move(rows);
+		m_displayRows.clear();
+		m_hasRows = true;
+		m_showAppended = showAppended;
+		m_sourceRowCount = sourceRowCount;
+		++m_version;
+	}
+
+	void RowViewSource::appendRows(std::span<const size_t> rows, size_t sourceRowCount)
+	{
+		assert(m_hasRows);
+		assert(m_sourceRowCount <= sourceRowCount);
+
+		const size_t firstRow = m_rows.size();
+		m_rows.insert(m_rows.end(), rows.begin(), rows.end());
+
+		// 逆向きの対応表を作ってあれば、増えた分だけを書き足す
+		if (not m_displayRows.isEmpty())
+		{
+			m_displayRows.resize(sourceRowCount, NotDisplayed);
+			for (size_t i = 0; i < rows.size(); ++i)
+			{
+				m_displayRows[rows[i]] = (firstRow + i);
+			}
+		}
+
+		m_sourceRowCount = sourceRowCount;
+		++m_version;
+	}
+
+	void RowViewSource::resetRows()
+	{
+		if (not m_hasRows)
+		{
+			return;
+		}
+
+		m_rows.clear();
+		m_rows.shrink_to_fit();
+		m_displayRows.clear();
+		m_displayRows.shrink_to_fit();
+		m_hasRows = false;
+		++m_version;
+	}
+
+	bool RowViewSource::hasRows() const noexcept
+	{
+		return m_hasRows;
+	}
+
+	size_t RowViewSource::toSourceRow(size_t row) const noexcept
+	{
+		if (not m_hasRows)
+		{
+			return row;
+		}
+		if (row < m_rows.size())
+		{
+			return m_rows[row];
+		}
+		return (m_sourceRowCount + (row - m_rows.size()));
+	}
+
+	Optional<size_t> RowViewSource::toDisplayRow(size_t sourceRow) const
+	{
+		if (m_source->rowCount() <= sourceRow)
+		{
+			return none;
+		}
+		if (not m_hasRows)
+		{
+			return sourceRow;
+		}
+
+		// 対応表を作った後に増えた行は、末尾にそのままの順で並んでいる
+		if (m_sourceRowCount <= sourceRow)
+		{
+			if (not m_showAppended)
+			{
+				return none;
+			}
+			return (m_rows.size() + (sourceRow - m_sourceRowCount));
+		}
+
+		if (m_displayRows.isEmpty())
+		{
+			m_displayRows.assign(m_sourceRowCount, NotDisplayed);
+			for (size_t row = 0; row < m_rows.size(); ++row)
+			{
+				if (m_rows[row] < m_sourceRowCount)
+				{
+					m_displayRows[m_rows[row]] = row;
+				}
+			}
+		}
+
+		if (m_displayRows[sourceRow] == NotDisplayed)
+		{
+			return none;
+		}
+		return m_displayRows[sourceRow];
+	}
+
+	size_t RowViewSource::rowCount() const
+	{
+		const size_t sourceRowCount = m_source->rowCount();
+		if (not m_hasRows)
+		{
+			return sourceRowCount;
+		}
+		if (not m_showAppended)
+		{
+			return m_rows.size();
+		}
+		return (m_rows.size() + ((m_sourceRowCount < sourceRowCount) ? (sourceRowCount - m_sourceRowCount) : 0));
+	}
+
+	size_t RowViewSource::columnCount() const
+	{
+		return m_source->columnCount();
+	}
+
+	uint64 RowViewSource::version() const
+	{
+		return (m_source->version() + m_version);
+	}
+
+	void RowViewSource::fetch(CellWindow& window) const
+	{
+		if (not m_hasRows)
+		{
+			m_source->fetch(window);
+			return;
+		}
+
+		const IndexRange& rows = window.rows();
+		const IndexRange& columns = window.columns();
+		const size_t sourceRowCount = m_source->rowCount();
+
+		for (size_t row = rows.first; row < rows.last;)
+		{
+			const size_t first = toSourceRow(row);
+
+			// 元の行が消えている場合は空にする
+			if (sourceRowCount <= first)
+			{
+				for (size_t column = columns.first; column < columns.last; ++column)
+				{
+					window.at(row, column).clear();
+				}
+				++row;
+				continue;
+			}
+
+			// 元の行が連続している間はまとめて問い合わせる
+			size_t count = 1;
+			while ((row + count) < rows.last
+				&& toSourceRow(row + count) == (first + count)
+				&& (first + count) < sourceRowCount)
+			{
+				++count;
+			}
+
+			m_buffer.reset({ first, first + count }, columns);
+			m_source->fetch(m_buffer);
+
+			// 文字列の領域を使い回すため、コピーではなく入れ替える
+			for (size_t i = 0; i < count; ++i)
+			{
+				for (size_t column = columns.first; column < columns.last; ++column)
+				{
+					std::swap(window.at(row + i, column), m_buffer.at(first + i, column));
+				}
+			}
+			row += count;
+		}
+	}
+
+	Optional<StringView> RowViewSource::view(size_t row, size_t column) const
+	{
+		return m_source->view(toSourceRow(row), column);
+	}
+
+	bool RowViewSource::setCell(size_t row, size_t column, StringView value)
+	{
+		return m_source->setCell(toSourceRow(row), column, value);
+	}
+
+	bool RowViewSource::appendRow(std::span<const String> values)
+	{
+		return m_source->appendRow(values);
+	}
+}
@@ -1,482 +1,1938 @@
-﻿# include "SimpleGridViewer/SpreadSheet.hpp"
-
-namespace SimpleGridViewer
-{
-	String AlphabetUtility::ToAlphabet(size_t index)
-	{
-		if (index < 0)
-		{
-			return U"";
-		}
-		else if (index < 26)
-		{
-			return String(1, U'A' + index);
-		}
-		else
-		{
-			return ToAlphabet(index / 26 - 1) + ToAlphabet(index % 26);
-		}
-	}
-
-	Array<String> AlphabetUtility::GenerateAlphabetArray(size_t index)
-	{
-		static Array<String> cache;
-		for (size_t i = cache.size(); i <= index; ++i)
-		{
-			cache.push_back(ToAlphabet(i));
-		}
-		return Array<String>(cache.begin(), cache.begin() + index + 1);
-	}
-
-	void SpreadSheet::initialize(const Size& sheetSize, const Size& visibleCellSize, const Point& viewPoint)
-	{
-		const double sheetWidth = visibleCellSize.x * Config::Cell::Width;
-		const double sheetHeight = visibleCellSize.y * Config::Cell::Height;
-
-		m_sheetArea = RectF{ viewPoint.x, viewPoint.y, sheetWidth + Config::SheetRow::Width, sheetHeight + Config::SheetHeader::Height };
-		m_viewArea = RectF{ m_sheetArea.tl(), m_sheetArea.size + Size{SasaGUI::ScrollBar::Thickness, SasaGUI::ScrollBar::Thickness} };
-		m_columnWidths = Array<int32>(sheetSize.x, Config::Cell::Width);
-		m_rowHeights = Array<int32>(sheetSize.y, Config::Cell::Height);
-		m_cellGrid = CellGrid(m_columnWidths, m_rowHeights);
-		m_values = Grid<String>(sheetSize);
-		m_lastVisibleRow = getVisibleRowCount() - 1;
-		m_lastVisibleColumn = getVisibleColumnCount() - 1;
-	}
-
-	SpreadSheet::SpreadSheet(const Size& sheetSize, const Size& visibleCellSize, const Point& viewPoint)
-		: m_indexFont(Config::Font::IndexSize)
-		, m_textFont(Config::Font::TextSize)
-	{
-		initialize(sheetSize, visibleCellSize, viewPoint);
-
-		for (size_t i = 0; i < sheetSize.x; ++i)
-		{
-			m_columnNames.push_back(Format(i));
-		}
-		for (size_t i = 0; i < sheetSize.y; ++i)
-		{
-			m_rowNames.push_back(Format(i));
-		}
-	}
-
-	void SpreadSheet::setValues(const Grid<String>& values)
-	{
-		const size_t rowCount = Min(values.height(), m_values.height());
-		const size_t columnCount = Min(values.width(), m_values.width());
-
-		for (size_t row = 0; row < rowCount; ++row)
-		{
-			for (size_t column = 0; column < columnCount; ++column)
-			{
-				m_values[row][column] = values[row][column];
-			}
-		}
-	}
-
-	Optional<String> SpreadSheet::getValue(size_t row, size_t column) const
-	{
-		if (row < 0 || row >= m_values.height() || column < 0 || column >= m_values.width())
-		{
-			return none;
-		}
-		return m_values[row][column];
-	}
-
-	void SpreadSheet::setIndexFont(const Font& font)
-	{
-		m_indexFont = font;
-	}
-
-	void SpreadSheet::setTextFont(const Font& font)
-	{
-		m_textFont = font;
-	}
-
-	void SpreadSheet::setRowNames(const Array<String>& rowNames)
-	{
-		m_rowNames = rowNames;
-	}
-
-	void SpreadSheet::setColumnNames(const Array<String>& columnNames)
-	{
-		m_columnNames = columnNames;
-	}
-
-	Optional<Point> SpreadSheet::getHoveredCell() const noexcept
-	{
-		return m_hoveredCell;
-	}
-
-	Optional<Point> SpreadSheet::getSelectedCell() const noexcept
-	{
-		return m_selectedCell;
-	}
-
-	Optional<size_t> SpreadSheet::getSelectedRow() const noexcept
-	{
-		return m_selectedRow;
-	}
-
-	Optional<size_t> SpreadSheet::getSelectedColumn() const noexcept
-	{
-		return m_selectedColumn;
-	}
-
-	void SpreadSheet::update()
-	{
-		{
-			const Transformer2D verticalScrollBarMat{ Mat3x2::Translate(m_sheetArea.tr()), TransformCursor::Yes };
-			if (m_verticalScrollBar.getThumbRect().mouseOver())
-			{
-				Cursor::RequestStyle(CursorStyle::Hand);
-			}
-		}
-		{
-			const Transformer2D horizontalScrollBarMat{ Mat3x2::Translate(m_sheetArea.bl()), TransformCursor::Yes };
-			if (m_horizontalScrollBar.getThumbRect().mouseOver())
-			{
-				Cursor::RequestStyle(CursorStyle::Hand);
-			}
-		}
-		if (m_viewArea.mouseOver())
-		{
-			updateScrollBar();
-		}
-
-		updateVisibleRows();
-		updateVisibleColumns();
-
-		{
-			const Transformer2D sheetHeaderMat{ Mat3x2::Translate(m_sheetArea.x, m_sheetArea.y), TransformCursor::Yes };
-			{
-				const Transformer2D sheetRowsMat{ Mat3x2::Translate(0, Config::SheetHeader::Height - (static_cast<int>(floor(m_verticalScrollBar.value() / Config::Cell::Height)) * Config::Cell::Height)), TransformCursor::Yes };
-				updateSelectedRow();
-			}
-			{
-				const Transformer2D t{ Mat3x2::Translate(
-									Config::SheetRow::Width
-									- (static_cast<int>(round(m_horizontalScrollBar.value() / Config::Cell::Width) * Config::Cell::Width)), 0),
-									TransformCursor::Yes };
-				updateSelectedColumn();
-			}
-		}
-
-		{
-			const Transformer2D cellsMat{ Mat3x2::Translate(Config::SheetRow::Width - (static_cast<int>(round(m_horizontalScrollBar.value() / Config::Cell::Width) * Config::Cell::Width)), Config::SheetHeader::Height - (static_cast<int>(floor(m_verticalScrollBar.value() / Config::Cell::Height)) * Config::Cell::Height)), TransformCursor::Yes };
-			updateCells();
-		}
-	}
-
-	void SpreadSheet::draw() const
-	{
-		{
-			const Transformer2D sheetHeaderMat{ Mat3x2::Translate(m_sheetArea.x, m_sheetArea.y), TransformCursor::Yes };
-			Rect{ 0, 0, Config::SheetRow::Width, Config::SheetHeader::Height }.draw(Config::SheetHeader::BackgroundColor);
-
-
-			{
-				const Transformer2D cellsMat{ Mat3x2::Translate(Config::SheetRow::Width - (static_cast<int>(round(m_horizontalScrollBar.value() / Config::Cell::Width) * Config::Cell::Width)), Config::SheetHeader::Height - (static_cast<int>(floor(m_verticalScrollBar.value() / Config::Cell::Height)) * Config::Cell::Height)), TransformCursor::Yes };
-				drawCells();
-				drawGridLines();
-			}
-
-			{
-				const Transformer2D t{ Mat3x2::Translate(
-					Config::SheetRow::Width
-					- (static_cast<int>(round(m_horizontalScrollBar.value() / Config::Cell::Width) * Config::Cell::Width)), 0),
-					TransformCursor::Yes };
-
-
-				drawSheetHeader();
-				drawSelectedColumn();
-			}
-			{
-				const Transformer2D sheetRowsMat{ Mat3x2::Translate(0, Config::SheetHeader::Height - (static_cast<int>(floor(m_verticalScrollBar.value() / Config::Cell::Height)) * Config::Cell::Height)), TransformCursor::Yes };
-				drawSheetRows();
-				drawSelectedRow();
-			}
-
-
-		}
-		{
-			const Transformer2D verticalScrollBarMat{ Mat3x2::Translate(m_sheetArea.tr()), TransformCursor::Yes };
-			m_verticalScrollBar.draw();
-		}
-
-		{
-			const Transformer2D horizontalScrollBarMat{ Mat3x2::Translate(m_sheetArea.bl()), TransformCursor::Yes };
-			m_horizontalScrollBar.draw();
-		}
-	}
-
-	void SpreadSheet::updateScrollBar()
-	{
-		{
-			const Transformer2D t{ Mat3x2::Translate(m_sheetArea.tr()), TransformCursor::Yes };
-			m_verticalScrollBar.updateLayout({
-			0,
-			0,
-			SasaGUI::ScrollBar::Thickness,
-			(int32)m_sheetArea.h
-			});
-			m_verticalScrollBar.updateConstraints(0.0, m_cellGrid.getTotalHeight(), m_sheetArea.h - Config::SheetHeader::Height);
-			m_verticalScrollBar.scroll(Mouse::Wheel() * 30);
-			m_verticalScrollBar.update();
-		}
-
-		{
-			const Transformer2D t{ Mat3x2::Translate(m_sheetArea.bl()), TransformCursor::Yes };
-			m_horizontalScrollBar.updateLayout({
-			0,
-			0,
-			(int32)m_sheetArea.w,
-			SasaGUI::ScrollBar::Thickness
-			});
-			m_horizontalScrollBar.updateConstraints(0.0, m_cellGrid.getTotalWidth(), m_sheetArea.w - Config::SheetRow::Width);
-			m_horizontalScrollBar.update();
-		}
-	}
-
-	SizeF SpreadSheet::getAreaSize() const noexcept
-	{
-		return m_sheetArea.size;
-	}
-
-	void SpreadSheet::updateVisibleColumns()
-	{
-		m_firstVisibleColumn = Min(m_cellGrid.getColumnCount() - 1, static_cast<size_t>(round(m_horizontalScrollBar.value() / Config::Cell::Width)));
-		m_lastVisibleColumn = Min(m_cellGrid.getColumnCount() - 1, m_firstVisibleColumn + getVisibleColumnCount() - 1);
-	}
-
-	void SpreadSheet::updateVisibleRows()
-	{
-		m_firstVisibleRow = Min(m_cellGrid.getRowCount() - 1, static_cast<size_t>(floor(m_verticalScrollBar.value() / Config::Cell::Height)));
-		m_lastVisibleRow = Min(m_cellGrid.getRowCount() - 1, m_firstVisibleRow + getVisibleRowCount() - 1);
-	}
-
-	void SpreadSheet::updateCells()
-	{
-		m_hoveredCell = m_cellGrid.getCellIndex(Cursor::Pos());
-		if (m_hoveredCell.has_value() && isCellVisible(m_hoveredCell->y, m_hoveredCell->x) && MouseL.down())
-		{
-			m_selectedCell = m_hoveredCell;
-			m_selectedRow = none;
-			m_selectedColumn = none;
-		}
-	}
-
-	void SpreadSheet::updateSelectedRow()
-	{
-		m_hoveredRow = m_cellGrid.getRowIndex(Cursor::Pos().y);
-		if (not m_hoveredRow.has_value()) return;
-
-		const size_t hoveredRow = m_hoveredRow.value();
-		if (hoveredRow < m_cellGrid.getRowCount()
-			&& m_firstVisibleRow <= hoveredRow && hoveredRow <= m_lastVisibleRow)
-		{
-			Rect rect = Rect{ 0, m_cellGrid.getCellY(hoveredRow), Config::SheetRow::Width, m_rowHeights[hoveredRow] };
-			if (rect.leftClicked())
-			{
-				m_selectedRow = m_hoveredRow;
-				m_selectedCell = none;
-			}
-		}
-	}
-
-	void SpreadSheet::updateSelectedColumn()
-	{
-		m_hoveredColumn = m_cellGrid.getColumnIndex(Cursor::Pos().x);
-		if (not m_hoveredColumn.has_value()) return;
-
-		const size_t hoveredColumn = m_hoveredColumn.value();
-		if (hoveredColumn < m_cellGrid.getColumnCount()
-						&& m_firstVisibleColumn <= hoveredColumn && hoveredColumn <= m_lastVisibleColumn)
-		{
-			Rect rect = Rect{ m_cellGrid.getCellX(hoveredColumn), 0, m_columnWidths[hoveredColumn], Config::SheetHeader::Height };
-			if (rect.leftClicked())
-			{
-				m_selectedColumn = m_hoveredColumn;
-				m_selectedCell = none;
-			}
-		}
-	}
-	
-	size_t SpreadSheet::getVisibleRowCount() const
-	{
-		size_t count = 0;
-		for (size_t i = 0; i < m_cellGrid.getRowCount(); ++i)
-		{
-			if (m_sheetArea.h < m_cellGrid.getCellY(i) + m_rowHeights[i] + Config::SheetHeader::Height)
-			{
-				break;
-			}
-			++count;
-		}
-		return count;
-	}
-
-	size_t SpreadSheet::getVisibleColumnCount() const
-	{
-		size_t count = 0;
-		for (size_t i = 0; i < m_cellGrid.getColumnCount(); ++i)
-		{
-			if (m_sheetArea.w < m_cellGrid.getCellX(i) + m_columnWidths[i] + Config::SheetRow::Width)
-			{
-				break;
-			}
-			++count;
-		}
-		return count;
-	}
-
-	bool SpreadSheet::isCellVisible(size_t row, size_t column) const
-	{
-		if (column < m_firstVisibleColumn
-		 || column > m_lastVisibleColumn
-		 || row < m_firstVisibleRow
-		 || row > m_lastVisibleRow)
-		{
-			return false;
-		}
-		return true;
-	}
-
-	void SpreadSheet::drawSheetHeader() const
-	{
-		for (size_t column = m_firstVisibleColumn; column <= m_lastVisibleColumn; ++column)
-		{
-			Rect rect = Rect{ m_cellGrid.getCellX(column), 0, m_columnWidths[column], Config::SheetHeader::Height};
-			if ((rect.x + rect.w) < m_horizontalScrollBar.value()
-			  || rect.x > (m_horizontalScrollBar.value() + m_sheetArea.w))
-			{
-				continue;
-			}
-			rect.draw(Config::SheetHeader::BackgroundColor);
-			const String columnName = m_columnNames[column];
-			m_indexFont(columnName).drawAt(rect.center(), Config::SheetHeader::TextColor);
-		}
-
-		for (size_t column = m_firstVisibleColumn; column <= m_lastVisibleColumn; ++column)
-		{
-			const int32 x = m_cellGrid.getCellX(column);
-			if ((x + Config::SheetRow::Width) < m_horizontalScrollBar.value()
-			  || x > (m_horizontalScrollBar.value() + m_sheetArea.w))
-			{
-				continue;
-			}
-			Rect{ x, 0, 1, Config::SheetHeader::Height }.draw(Config::Grid::Color);
-		}
-	}
-
-	void SpreadSheet::drawSheetRows() const
-	{
-		for (size_t row = m_firstVisibleRow; row <= m_lastVisibleRow; ++row)
-		{
-			Rect rect = Rect{ 0, m_cellGrid.getCellY(row), Config::SheetRow::Width, m_rowHeights[row] };
-
-			if ((rect.y + rect.h) < m_verticalScrollBar.value()
-			  || rect.y > (m_verticalScrollBar.value() + m_sheetArea.h))
-			{
-				continue;
-			}
-
-			rect.draw(Config::SheetRow::BackgroundColor);
-			const String rowName = m_rowNames[row];
-			m_indexFont(rowName).drawAt(rect.center(), Config::SheetRow::TextColor);
-		}
-
-		for (size_t row = m_firstVisibleRow; row <= m_lastVisibleRow; ++row)
-		{
-			const int32 y = m_cellGrid.getCellY(row);
-			if ((y + Config::SheetHeader::Height) < m_verticalScrollBar.value()
-			  || y > (m_verticalScrollBar.value() + m_sheetArea.h))
-			{
-				continue;
-			}
-			Rect{ 0, y,  Config::SheetRow::Width, 1 }.draw(Config::Grid::Color);
-		}
-	}
-
-	void SpreadSheet::drawCells() const
-	{
-		for (size_t row = m_firstVisibleRow; row <= m_lastVisibleRow; ++row)
-		{
-			for (size_t column = m_firstVisibleColumn; column <= m_lastVisibleColumn; ++column)
-			{
-				if (!isCellVisible(row, column))
-				{
-					continue;
-				}
-				const Rect rect = m_cellGrid.getCellRect(column, row);
-				rect.draw(Config::Cell::BackgroundColor);
-				m_textFont(m_values[row][column]).draw(m_cellGrid.getCellRect(column, row).stretched(-5, 0), Config::Cell::TextColor);
-			}
-		}
-
-		if (m_hoveredCell.has_value() && isCellVisible(m_hoveredCell->y, m_hoveredCell->x))
-		{
-			const Rect rect = m_cellGrid.getCellRect(m_hoveredCell->x, m_hoveredCell->y);
-			rect.stretched(-1, 0, 0, -1).draw(Config::Cell::HoveredColor);
-		}
-		
-		if (m_selectedCell.has_value() && isCellVisible(m_selectedCell->y, m_selectedCell->x))
-		{
-			const Rect rect = m_cellGrid.getCellRect(m_selectedCell->x, m_selectedCell->y);
-			rect.stretched(-1, 0, 0, -1).drawFrame(1, 0, Config::Cell::SelectedColor);
-		}
-	}
-
-	void SpreadSheet::drawSelectedRow() const
-	{
-		if (m_selectedRow.has_value()
-			&& m_selectedRow.value() < m_cellGrid.getRowCount()
-			&& m_firstVisibleRow <= m_selectedRow.value()
-			&& m_selectedRow.value() <= m_lastVisibleRow
-		)
-		{
-			const size_t row = m_selectedRow.value();
-			const Rect rect = Rect{ 0, m_cellGrid.getCellY(row), m_sheetArea.asRect().w, m_rowHeights[row]};
-			rect.drawFrame(1, 0, Config::SheetRow::SelectedColor);
-		}
-	}
-
-	void SpreadSheet::drawSelectedColumn() const
-	{
-		if (m_selectedColumn.has_value()
-			&& m_selectedColumn.value() < m_cellGrid.getColumnCount()
-			&& m_firstVisibleColumn <= m_selectedColumn.value()
-			&& m_selectedColumn.value() <= m_lastVisibleColumn
-		)
-		{
-			size_t column = m_selectedColumn.value();
-			const Rect rect = Rect{ m_cellGrid.getCellX(column), 0, m_columnWidths[column], m_sheetArea.asRect().h};
-			rect.drawFrame(1, 0, Config::SheetHeader::SelectedColor);
-		}
-	}
-
-	void SpreadSheet::drawGridLines() const
-	{
-		const int32 width = m_columnWidths[0];
-		const int32 height = m_rowHeights[0];
-
-		for (size_t column = m_firstVisibleColumn; column <= m_lastVisibleColumn; ++column)
-		{
-			const int32 x = m_cellGrid.getCellX(column);
-
-			for (size_t row = m_firstVisibleRow; row <= m_lastVisibleRow; ++row)
-			{
-				const int32 y = m_cellGrid.getCellY(row);
-
-				if ((x + width) < m_horizontalScrollBar.value() || (y + height) < m_verticalScrollBar.value() ||
-					x > (m_horizontalScrollBar.value() + m_sheetArea.w) || y > (m_verticalScrollBar.value() + m_sheetArea.h))
-				{
-					continue;
-				}
-				RectF{ x, y, 1, height }.draw(Config::Grid::Color);
-				RectF{ x, y, width, 1 }.draw(Config::Grid::Color);
-			}
-		}
-	}
-}
-
-
+﻿# include <numeric>
+# include "SimpleGridViewer/SpreadSheet.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace
+	{
+		// 現在の座標変換での rect の範囲の外には描かないようにする
+		// シザー矩形は座標変換を受けないので、変換した後の範囲を設定する
+		class ScopedClipRect
+		{
+		public:
+			explicit ScopedClipRect(const Rect& rect)
+				: m_previousRect{ Graphics2D::GetScissorRect() }
+				, m_states{ ScissorState() }
+			{
+				const Mat3x2 mat = (Graphics2D::GetLocalTransform() * Graphics2D::GetCameraTransform());
+				const Float2 tl = mat.transformPoint(rect.tl());
+				const Float2 br = mat.transformPoint(rect.br());
+				const Point topLeft{ static_cast<int32>(Math::Round(tl.x)), static_cast<int32>(Math::Round(tl.y)) };
+				const Point bottomRight{ static_cast<int32>(Math::Round(br.x)), static_cast<int32>(Math::Round(br.y)) };
+				Graphics2D::SetScissorRect(Rect{ topLeft, (bottomRight - topLeft) });
+			}
+
+			~ScopedClipRect()
+			{
+				Graphics2D::SetScissorRect(m_previousRect);
+			}
+
+			ScopedClipRect(const ScopedClipRect&) = delete;
+
+			ScopedClipRect& operator=(const ScopedClipRect&) = delete;
+
+		private:
+			static RasterizerState ScissorState()
+			{
+				RasterizerState state = RasterizerState::Default2D;
+				state.scissorEnable = true;
+				return state;
+			}
+
+			Rect m_previousRect;
+
+			ScopedRenderStates2D m_states;
+		};
+
+		// 列の見出しの右端にある並べ替えのボタン。狭い列でも左半分は列の選択に残す
+		Rect GetSortButton(const Rect& header)
+		{
+			const int32 width = Min(Config::SheetHeader::SortButtonWidth, (header.w / 2));
+			return Rect{ (header.x + header.w - width), header.y, width, header.h };
+		}
+	}
+
+	String AlphabetUtility::ToAlphabet(size_t index)
+	{
+		LabelBuffer buffer;
+		return String{ HeaderLabels::Alphabet(index, buffer) };
+	}
+
+	Array<String> AlphabetUtility::GenerateAlphabetArray(size_t index)
+	{
+		// 共有のキャッシュを持たないので、どのスレッドから呼んでもよい
+		Array<String> result;
+		result.reserve(index + 1);
+		LabelBuffer buffer;
+		for (size_t i = 0; i <= index; ++i)
+		{
+			result.emplace_back(HeaderLabels::Alphabet(i, buffer));
+		}
+		return result;
+	}
+
+	void SpreadSheet::initialize(const Size& sheetSize, const Size& visibleCellSize, const Point& viewPoint)
+	{
+		const double sheetWidth = visibleCellSize.x * Config::Cell::Width;
+		const double sheetHeight = visibleCellSize.y * Config::Cell::Height;
+
+		m_sheetArea = RectF{ viewPoint.x, viewPoint.y, sheetWidth + Config::SheetRow::Width, sheetHeight + Config::SheetHeader::Height };
+		m_viewArea = RectF{ m_sheetArea.tl(), m_sheetArea.size + Size{SasaGUI::ScrollBar::Thickness, SasaGUI::ScrollBar::Thickness} };
+		m_cellGrid = CellGrid(sheetSize, Size{ Config::Cell::Width, Config::Cell::Height });
+		m_source = std::make_shared<GridCellSource>(sheetSize);
+		m_rowView = std::make_shared<RowViewSource>(m_source);
+		m_fetchedVersion = m_rowView->version();
+		updateScrollOffset();
+		updateVisibleSpan();
+		updateWindow();
+	}
+
+	SpreadSheet::SpreadSheet(const Size& sheetSize, const Size& visibleCellSize, const Point& viewPoint)
+		: m_indexFont(Config::Font::IndexSize)
+		, m_textFont(Config::Font::TextSize)
+	{
+		initialize(sheetSize, visibleCellSize, viewPoint);
+	}
+
+	GridCellSource& SpreadSheet::getGridSource()
+	{
+		auto gridSource = std::dynamic_pointer_cast<GridCellSource>(m_source);
+		if (not gridSource)
+		{
+			gridSource = std::make_shared<GridCellSource>(Size{ m_cellGrid.getColumnCount(), m_cellGrid.getRowCount() });
+			setSource(gridSource);
+		}
+		return *gridSource;
+	}
+
+	void SpreadSheet::setValues(const Grid<String>& values)
+	{
+		// 並べ替えや絞り込み、検索の途中で書き換えないよう、先に止める
+		cancelBackgroundTasks();
+		getGridSource().setValues(values);
+		startSort();
+		startFilter();
+		startFind();
+		invalidateColumnStats(0, m_source->columnCount());
+		invalidateRangeIndex(0, m_source->columnCount());
+		updateWindow();
+	}
+
+	void SpreadSheet::setValues(Grid<String>&& values)
+	{
+		// 並べ替えや絞り込み、検索の途中で書き換えないよう、先に止める
+		cancelBackgroundTasks();
+		getGridSource().setValues(std::move(values));
+		startSort();
+		startFilter();
+		startFind();
+		invalidateColumnStats(0, m_source->columnCount());
+		invalidateRangeIndex(0, m_source->columnCount());
+		updateWindow();
+	}
+
+	void SpreadSheet::setRegion(const Point& topLeft, const Grid<String>& values)
+	{
+		// 並べ替えや絞り込み、検索の途中で書き換えないよう、先に止める
+		cancelBackgroundTasks();
+		getGridSource().setRegion(topLeft, values);
+		startSort();
+		startFilter();
+		startFind();
+		invalidateColumnStats(topLeft.x, (topLeft.x + values.width()));
+		invalidateRangeIndex(topLeft.x, (topLeft.x + values.width()));
+		updateWindow();
+	}
+
+	void SpreadSheet::setSource(std::shared_ptr<ICellSource> source)
+	{
+		assert(source);
+		cancelBackgroundTasks();
+		m_rowFilter.reset();
+		m_sortKeys.clear();
+		m_filters.clear();
+		m_sortedRows.reset();
+		m_filterBitmap.reset();
+		m_refilterRows.clear();
+		m_columnStats.clear();
+		m_staleStatsColumns.clear();
+		m_rangeAggregator.clear();
+		m_erasedRowCount = 0;
+		m_source = std::move(source);
+		m_statsSourceVersion = m_source->version();
+		m_rowView = std::make_shared<RowViewSource>(m_source);
+		m_rangeIndexVersion = m_rowView->version();
+		m_rangeIndexRowCount = m_rowView->rowCount();
+		m_tileCache.clear();
+		m_tileSourceVersion = m_rowView->version();
+		m_cellGrid = CellGrid(Size{ m_source->columnCount(), m_source->rowCount() }, Size{ Config::Cell::Width, Config::Cell::Height });
+
+		m_hoveredCell = none;
+		m_selectedCell = none;
+		m_selectionEnd = none;
+		m_draggingSelection = false;
+		m_rangeSummary.reset();
+		m_hoveredRow = none;
+		m_hoveredColumn = none;
+		m_selectedRow = none;
+		m_selectedColumn = none;
+
+		// 別のデータになるので、表示中のバッファは必ず取り直す
+		m_fetchedVersion = m_rowView->version();
+		++m_dataVersion;
+		for (auto& pane : m_panes)
+		{
+			pane.window.reset({}, {});
+		}
+		updateScrollOffset();
+		updateVisibleSpan();
+		updateWindow();
+
+		// 検索語は新しいデータでも引き継ぐ
+		startFind();
+	}
+
+	const std::shared_ptr<ICellSource>& SpreadSheet::getSource() const noexcept
+	{
+		return m_source;
+	}
+
+	Optional<String> SpreadSheet::getValue(size_t row, size_t column) const
+	{
+		if (row >= m_rowView->rowCount() || column >= m_rowView->columnCount())
+		{
+			return none;
+		}
+		if (const String* value = findFetchedCell(row, column))
+		{
+			return *value;
+		}
+
+		CellWindow window;
+		window.reset({ row, row + 1 }, { column, column + 1 });
+		m_rowView->fetch(window);
+		return window.at(row, column);
+	}
+
+	Optional<StringView> SpreadSheet::getValueView(size_t row, size_t column) const
+	{
+		if (row >= m_rowView->rowCount() || column >= m_rowView->columnCount())
+		{
+			return none;
+		}
+		if (const auto value = m_rowView->view(row, column))
+		{
+			return value;
+		}
+
+		// 供給元が文字列を保持していない場合は、表示中のセルだけ返せる
+		if (const String* value = findFetchedCell(row, column))
+		{
+			return StringView{ *value };
+		}
+		return none;
+	}
+
+	void SpreadSheet::setIndexFont(const Font& font)
+	{
+		m_indexFont = font;
+		m_textLayoutCache.clear();
+		++m_styleVersion;
+	}
+
+	void SpreadSheet::setTextFont(const Font& font)
+	{
+		m_textFont = font;
+		m_textLayoutCache.clear();
+		++m_styleVersion;
+	}
+
+	void SpreadSheet::setRowNames(const Array<String>& rowNames)
+	{
+		m_rowLabels.setLabels(rowNames);
+		++m_labelVersion;
+	}
+
+	void SpreadSheet::setColumnNames(const Array<String>& columnNames)
+	{
+		m_columnLabels.setLabels(columnNames);
+		++m_labelVersion;
+	}
+
+	void SpreadSheet::setRowName(size_t row, const String& name)
+	{
+		m_rowLabels.setLabel(row, name);
+		++m_labelVersion;
+	}
+
+	void SpreadSheet::setColumnName(size_t column, const String& name)
+	{
+		m_columnLabels.setLabel(column, name);
+		++m_labelVersion;
+	}
+
+	void SpreadSheet::setRowLabelGenerator(LabelGenerator generator)
+	{
+		m_rowLabels.setGenerator(std::move(generator));
+		++m_labelVersion;
+	}
+
+	void SpreadSheet::setColumnLabelGenerator(LabelGenerator generator)
+	{
+		m_columnLabels.setGenerator(std::move(generator));
+		++m_labelVersion;
+	}
+
+	Optional<Point> SpreadSheet::getHoveredCell() const noexcept
+	{
+		return m_hoveredCell;
+	}
+
+	Optional<Point> SpreadSheet::getSelectedCell() const noexcept
+	{
+		return m_selectedCell;
+	}
+
+	Optional<Rect> SpreadSheet::getSelectedRange() const noexcept
+	{
+		if ((not m_selectedCell) || (not m_selectionEnd))
+		{
+			return none;
+		}
+
+		const Point topLeft{ Min(m_selectedCell->x, m_selectionEnd->x), Min(m_selectedCell->y, m_selectionEnd->y) };
+		const Point bottomRight{ Max(m_selectedCell->x, m_selectionEnd->x), Max(m_selectedCell->y, m_selectionEnd->y) };
+		return Rect{ topLeft, (bottomRight - topLeft + Point{ 1, 1 }) };
+	}
+
+	const Optional<RangeSummary>& SpreadSheet::getSelectedRangeSummary() const noexcept
+	{
+		return m_rangeSummary;
+	}
+
+	Optional<size_t> SpreadSheet::getSelectedRow() const noexcept
+	{
+		return m_selectedRow;
+	}
+
+	Optional<size_t> SpreadSheet::getSelectedColumn() const noexcept
+	{
+		return m_selectedColumn;
+	}
+
+	const TextLayoutCache& SpreadSheet::getTextLayoutCache() const noexcept
+	{
+		return m_textLayoutCache;
+	}
+
+	void SpreadSheet::setFollowTail(bool followTail)
+	{
+		m_followTail = followTail;
+	}
+
+	bool SpreadSheet::isFollowingTail() const noexcept
+	{
+		return m_followTail;
+	}
+
+	const std::shared_ptr<PatchQueue>& SpreadSheet::getPatchQueue() const noexcept
+	{
+		return m_patchQueue;
+	}
+
+	void SpreadSheet::setPatchTimeBudget(const Duration& budget)
+	{
+		m_patchTimeBudget = budget;
+	}
+
+	void SpreadSheet::setSortKeys(const Array<SortKey>& keys)
+	{
+		m_sortKeys = keys;
+		startSort();
+	}
+
+	const Array<SortKey>& SpreadSheet::getSortKeys() const noexcept
+	{
+		return m_sortKeys;
+	}
+
+	bool SpreadSheet::isSorting() const noexcept
+	{
+		return m_rowSorter.isBusy();
+	}
+
+	void SpreadSheet::setFilters(const Array<FilterCondition>& filters)
+	{
+		m_filters = filters;
+		startFilter();
+	}
+
+	const Array<FilterCondition>& SpreadSheet::getFilters() const noexcept
+	{
+		return m_filters;
+	}
+
+	bool SpreadSheet::isFiltering() const noexcept
+	{
+		return m_rowFilter.isBusy();
+	}
+
+	void SpreadSheet::find(StringView query)
+	{
+		m_findQuery = query;
+		startFind();
+	}
+
+	bool SpreadSheet::findNext()
+	{
+		return moveToFindMatch(true);
+	}
+
+	bool SpreadSheet::findPrevious()
+	{
+		return moveToFindMatch(false);
+	}
+
+	const CellFinder& SpreadSheet::getFinder() const noexcept
+	{
+		return m_finder;
+	}
+
+	Optional<ColumnStats> SpreadSheet::getSelectedColumnStats() const
+	{
+		if (m_selectedColumn)
+		{
+			if (const auto it = m_columnStats.find(*m_selectedColumn); it != m_columnStats.end())
+			{
+				return it->second;
+			}
+		}
+		return none;
+	}
+
+	bool SpreadSheet::isComputingColumnStats() const noexcept
+	{
+		return m_statsCalculator.isBusy();
+	}
+
+	bool SpreadSheet::needsRedraw() const
+	{
+		if (not m_drawnState)
+		{
+			return true;
+		}
+
+		if (m_verticalScrollBar.isAnimating() || m_horizontalScrollBar.isAnimating())
+		{
+			return true;
+		}
+
+		return (captureRedrawState() != *m_drawnState);
+	}
+
+	bool SpreadSheet::hasBackgroundWork() const
+	{
+		return (m_rowSorter.isBusy() || m_rowFilter.isBusy() || m_finder.isBusy()
+			|| m_statsCalculator.isBusy() || m_rangeAggregator.isBusy() || hasPendingPatches());
+	}
+
+	void SpreadSheet::setFrameCacheEnabled(bool enabled)
+	{
+		m_frameCacheEnabled = enabled;
+		if (not enabled)
+		{
+			m_frame = MSRenderTexture{};
+		}
+		m_drawnState.reset();
+	}
+
+	bool SpreadSheet::isFrameCacheEnabled() const noexcept
+	{
+		return m_frameCacheEnabled;
+	}
+
+	void SpreadSheet::setTileCacheEnabled(bool enabled)
+	{
+		m_tileCacheEnabled = enabled;
+		if (not enabled)
+		{
+			m_tileCache.release();
+		}
+		m_drawnState.reset();
+
+		// タイルに描くセルを読み直す
+		updateWindow();
+	}
+
+	bool SpreadSheet::isTileCacheEnabled() const noexcept
+	{
+		return m_tileCacheEnabled;
+	}
+
+	const TileRenderCache& SpreadSheet::getTileRenderCache() const noexcept
+	{
+		return m_tileCache;
+	}
+
+	void SpreadSheet::setFrozenPanes(size_t rows, size_t columns)
+	{
+		m_frozenRows = rows;
+		m_frozenColumns = columns;
+		updateScrollBarConstraints();
+		updateScrollOffset();
+		updateVisibleSpan();
+		updateWindow();
+	}
+
+	size_t SpreadSheet::getFrozenRows() const noexcept
+	{
+		return m_frozenRows;
+	}
+
+	size_t SpreadSheet::getFrozenColumns() const noexcept
+	{
+		return m_frozenColumns;
+	}
+
+	void SpreadSheet::update()
+	{
+		{
+			const Transformer2D verticalScrollBarMat{ Mat3x2::Translate(m_sheetArea.tr()), TransformCursor::Yes };
+			if (m_verticalScrollBar.getThumbRect().mouseOver())
+			{
+				Cursor::RequestStyle(CursorStyle::Hand);
+			}
+		}
+		{
+			const Transformer2D horizontalScrollBarMat{ Mat3x2::Translate(m_sheetArea.bl()), TransformCursor::Yes };
+			if (m_horizontalScrollBar.getThumbRect().mouseOver())
+			{
+				Cursor::RequestStyle(CursorStyle::Hand);
+			}
+		}
+		applyRowTaskResults();
+		applyColumnStatsResult();
+		startColumnStats();
+		applyPatches();
+		refilterRows();
+
+		// SpreadSheet を通さずに書き換えられた場合は、どのセルが変わったか分からないので探し直す
+		if ((not m_findQuery.isEmpty()) && (not m_finder.isBusy())
+			&& ((m_source->version() != m_findSourceVersion) || (m_source->rowCount() != m_findRowCount)))
+		{
+			startFind();
+		}
+
+		// SpreadSheet を通さずに書き換えられた場合は、どの列が変わったか分からないので全ての列を集計し直す
+		if (m_source->version() != m_statsSourceVersion)
+		{
+			invalidateColumnStats(0, m_source->columnCount());
+		}
+		// 行が増えただけなら、区間木は増えた行を読んで伸ばす
+		// 行が増えずに内容が変わった場合は、どのセルが変わったか分からないので全ての列を作り直す
+		if (m_rowView->version() != m_rangeIndexVersion)
+		{
+			if (const size_t rowCount = m_rowView->rowCount(); m_rangeIndexRowCount < rowCount)
+			{
+				m_rangeIndexVersion = m_rowView->version();
+				m_rangeIndexRowCount = rowCount;
+			}
+			else
+			{
+				invalidateRangeIndex(0, m_source->columnCount());
+			}
+		}
+		if (m_rowView->version() != m_tileSourceVersion)
+		{
+			m_tileSourceVersion = m_rowView->version();
+			++m_tileDataVersion;
+		}
+
+		// 末尾を表示していた場合だけ、追加された行に追従する。上にスクロールしている間は追従しない
+		const bool atBottom = ((m_verticalScrollBar.maximum() - m_verticalScrollBar.viewportSize() - 1.0) <= m_verticalScrollBar.value());
+		syncSourceSize();
+		if (m_followTail && atBottom)
+		{
+			m_verticalScrollBar.moveTo(m_verticalScrollBar.maximum());
+		}
+
+		// スクロールの途中でカーソルが外れても、止まるまでは動かし続ける
+		const bool mouseOver = m_viewArea.mouseOver();
+		if (mouseOver || m_verticalScrollBar.isAnimating() || m_horizontalScrollBar.isAnimating())
+		{
+			updateScrollBar(mouseOver);
+		}
+
+		updateScrollOffset();
+		updateVisibleSpan();
+		updateWindow();
+
+		{
+			const Transformer2D sheetHeaderMat{ Mat3x2::Translate(m_sheetArea.x, m_sheetArea.y), TransformCursor::Yes };
+
+			// 端で一部だけ見えている行や列は見出しやほかの領域の下に隠れているので、カーソルがある領域の座標変換で判定する
+			const Pane* rowPane = nullptr;
+			const Pane* columnPane = nullptr;
+			const Pane* cellPane = nullptr;
+			for (const auto& pane : m_panes)
+			{
+				if (pane.area.movedBy(Config::SheetRow::Width, Config::SheetHeader::Height).mouseOver())
+				{
+					cellPane = &pane;
+				}
+			}
+			for (const size_t index : RowHeaderPanes)
+			{
+				const Rect& area = m_panes[index].area;
+				if (Rect{ 0, (Config::SheetHeader::Height + area.y), Config::SheetRow::Width, area.h }.mouseOver())
+				{
+					rowPane = &m_panes[index];
+				}
+			}
+			for (const size_t index : ColumnHeaderPanes)
+			{
+				const Rect& area = m_panes[index].area;
+				if (Rect{ (Config::SheetRow::Width + area.x), 0, area.w, Config::SheetHeader::Height }.mouseOver())
+				{
+					columnPane = &m_panes[index];
+				}
+			}
+			{
+				const int32 offsetY = (rowPane ? rowPane->offset().y : 0);
+				const Transformer2D sheetRowsMat{ Mat3x2::Translate(0, Config::SheetHeader::Height + offsetY), TransformCursor::Yes };
+				updateSelectedRow(rowPane);
+			}
+			{
+				const int32 offsetX = (columnPane ? columnPane->offset().x : 0);
+				const Transformer2D t{ Mat3x2::Translate(Config::SheetRow::Width + offsetX, 0), TransformCursor::Yes };
+				updateSelectedColumn(columnPane);
+			}
+			{
+				const Point offset = (cellPane ? cellPane->offset() : Point{ 0, 0 });
+				const Transformer2D cellsMat{ Mat3x2::Translate(Config::SheetRow::Width + offset.x, Config::SheetHeader::Height + offset.y), TransformCursor::Yes };
+				updateCells(cellPane);
+			}
+		}
+
+		updateRangeSummary();
+	}
+
+	void SpreadSheet::draw() const
+	{
+		if (m_frameCacheEnabled)
+		{
+			drawCachedSheet();
+		}
+		else
+		{
+			drawSheet();
+		}
+
+		{
+			const Transformer2D verticalScrollBarMat{ Mat3x2::Translate(m_sheetArea.tr()), TransformCursor::Yes };
+			m_verticalScrollBar.draw();
+		}
+
+		{
+			const Transformer2D horizontalScrollBarMat{ Mat3x2::Translate(m_sheetArea.bl()), TransformCursor::Yes };
+			m_horizontalScrollBar.draw();
+		}
+
+		m_drawnState = captureRedrawState();
+	}
+
+	void SpreadSheet::updateScrollBar(bool wheelEnabled)
+	{
+		updateScrollBarConstraints();
+
+		{
+			const Transformer2D t{ Mat3x2::Translate(m_sheetArea.tr()), TransformCursor::Yes };
+			m_verticalScrollBar.updateLayout({
+			0,
+			0,
+			SasaGUI::ScrollBar::Thickness,
+			(int32)m_sheetArea.h
+			});
+			if (wheelEnabled)
+			{
+				m_verticalScrollBar.scroll(Mouse::Wheel() * 30);
+			}
+			m_verticalScrollBar.update();
+		}
+
+		{
+			const Transformer2D t{ Mat3x2::Translate(m_sheetArea.bl()), TransformCursor::Yes };
+			m_horizontalScrollBar.updateLayout({
+			0,
+			0,
+			(int32)m_sheetArea.w,
+			SasaGUI::ScrollBar::Thickness
+			});
+			m_horizontalScrollBar.update();
+		}
+	}
+
+	void SpreadSheet::applyPatches()
+	{
+		if ((m_patchBuffer.size() <= m_patchIndex) && m_patchQueue->isEmpty())
+		{
+			return;
+		}
+
+		// 並べ替えや絞り込み、検索のスレッドが供給元を読んでいる間は書き換えず、キューに溜めておく
+		if (m_rowSorter.isBusy() || m_rowFilter.isBusy() || m_finder.isBusy())
+		{
+			return;
+		}
+
+		// 行が捨てられたときに位置をずらせるよう、書き換える前の供給元で終わった結果を先に受け取っておく
+		applyRowTaskResults();
+
+		// 統計の集計と区間木の作成は書き換えを待たせずに中断する。書き換えを待つものが無くなってから始め直す
+		m_statsCalculator.cancel();
+		m_rangeAggregator.cancel();
+
+		// 書き換えた列の範囲。統計はこの範囲の列だけを捨てる
+		IndexRange editedColumns{ m_source->columnCount(), 0 };
+		const auto markEdited = [&](size_t first, size_t last)
+		{
+			editedColumns.first = Min(editedColumns.first, first);
+			editedColumns.last = Max(editedColumns.last, last);
+		};
+
+		// 同じセルへの書き込みは最後の値だけを反映する
+		struct CellIndexHash
+		{
+			size_t operator()(const std::pair<size_t, size_t>& index) const noexcept
+			{
+				return std::hash<size_t>{}(index.first * 0x9e3779b97f4a7c15ull ^ index.second);
+			}
+		};
+		HashTable<std::pair<size_t, size_t>, String, CellIndexHash> cells;
+
+		// 行を追加したときに供給元が捨てた先頭の行の数
+		size_t erasedRows = 0;
+
+		// 書き換える前から版が変わっていた場合は、どこが変わったか分からないので update() でタイルと区間木を全て作り直す
+		const bool tilesUpToDate = (m_tileSourceVersion == m_rowView->version());
+		const bool rangeIndexUpToDate = (m_rangeIndexVersion == m_rowView->version());
+		const bool findUpToDate = ((m_findSourceVersion == m_source->version()) && (m_findRowCount == m_source->rowCount()));
+
+		// 範囲選択の集計に使う区間木とセルを描いたタイルと検索の結果は、書き換えたセルの分だけを更新する
+		const auto updateCell = [&](size_t sourceRow, size_t column)
+		{
+			if (m_filterBitmap)
+			{
+				m_refilterRows.push_back(sourceRow);
+			}
+			if (findUpToDate)
+			{
+				m_finder.rescanCell(*m_source, sourceRow, column);
+			}
+
+			if (const auto row = m_rowView->toDisplayRow(sourceRow))
+			{
+				m_rangeAggregator.updateCell(*m_rowView, *row, column);
+
+				// まだ CellGrid に無い行は syncSourceSize() で描き直す
+				if ((*row < m_cellGrid.getRowCount()) && (column < m_cellGrid.getColumnCount()))
+				{
+					m_tileCache.invalidate(m_cellGrid.getCellRect(column, *row));
+				}
+			}
+		};
+
+		const auto flushCells = [&]()
+		{
+			for (const auto& [index, value] : cells)
+			{
+				if (m_source->setCell(index.first, index.second, value))
+				{
+					updateCell(index.first, index.second);
+				}
+			}
+			cells.clear();
+		};
+
+		const auto applyPatch = [&](Patch& patch)
+		{
+			if (auto* cell = std::get_if<CellPatch>(&patch))
+			{
+				markEdited(cell->column, (cell->column + 1));
+				cells[{ cell->row, cell->column }] = std::move(cell->value);
+				return;
+			}
+
+			// 行の書き換えは順序を保つため、それまでのセルの書き込みを先に反映する
+			flushCells();
+			const RowPatch& row = std::get<RowPatch>(patch);
+			if (row.row)
+			{
+				markEdited(0, row.values.size());
+				for (size_t column = 0; column < row.values.size(); ++column)
+				{
+					if (m_source->setCell(*row.row, column, row.values[column]))
+					{
+						updateCell(*row.row, column);
+					}
+				}
+			}
+			else
+			{
+				// 行が増えると全ての列の件数が変わる
+				markEdited(0, m_source->columnCount());
+				const size_t rowCount = m_source->rowCount();
+				m_source->appendRow(row.values);
+
+				// 増えた行は、範囲選択で必要になったときに区間木に加える
+				// 古い行を捨てて行がずれた場合は、区間木を作り直す
+				if (const size_t newRowCount = m_source->rowCount(); newRowCount < (rowCount + 1))
+				{
+					erasedRows += ((rowCount + 1) - newRowCount);
+					m_rangeAggregator.clear();
+					++m_tileDataVersion;
+				}
+			}
+		};
+
+		// 時間の予算を使い切ったら、残りは次のフレームに回す
+		// 大きなまとまりも途中で止められるよう、 PatchChunkSize 件ごとに予算を確かめ、続きの位置を m_patchIndex に残す
+		const Stopwatch stopwatch{ StartImmediately::Yes };
+		while (stopwatch.elapsed() < m_patchTimeBudget)
+		{
+			if (m_patchBuffer.size() <= m_patchIndex)
+			{
+				m_patchBuffer.clear();
+				m_patchIndex = 0;
+				if (not m_patchQueue->pop(m_patchBuffer))
+				{
+					break;
+				}
+			}
+
+			const size_t chunkEnd = Min((m_patchIndex + PatchChunkSize), m_patchBuffer.size());
+			for (; m_patchIndex < chunkEnd; ++m_patchIndex)
+			{
+				applyPatch(m_patchBuffer[m_patchIndex]);
+			}
+			flushCells();
+		}
+
+		if (editedColumns.size())
+		{
+			invalidateColumnStats(editedColumns.first, editedColumns.last);
+		}
+		if (erasedRows)
+		{
+			eraseLeadingRows(erasedRows);
+		}
+		if (findUpToDate)
+		{
+			m_findSourceVersion = m_source->version();
+			m_findRowCount = m_source->rowCount();
+			if (not m_findQuery.isEmpty())
+			{
+				// 増えた行は別のスレッドで調べ、 applyRowTaskResults() で結果に加える
+				m_finder.scanAppendedRows(m_source);
+				m_displayFindMatchCount = none;
+				++m_overlayVersion;
+			}
+		}
+		if (rangeIndexUpToDate)
+		{
+			m_rangeIndexVersion = m_rowView->version();
+			m_rangeIndexRowCount = m_rowView->rowCount();
+		}
+		if (tilesUpToDate)
+		{
+			m_tileSourceVersion = m_rowView->version();
+		}
+	}
+
+	bool SpreadSheet::hasPendingPatches() const
+	{
+		return ((m_patchIndex < m_patchBuffer.size()) || (not m_patchQueue->isEmpty()));
+	}
+
+	void SpreadSheet::toggleSortKey(size_t column, bool append)
+	{
+		// 昇順、降順、並べ替えなしの順に切り替える
+		const auto it = std::find_if(m_sortKeys.begin(), m_sortKeys.end(), [&](const SortKey& key) { return (key.column == column); });
+		if (append)
+		{
+			// 既存のキーの後ろに、優先度の低いキーとして加える
+			if (it == m_sortKeys.end())
+			{
+				m_sortKeys.push_back({ column, true });
+			}
+			else if (it->ascending)
+			{
+				it->ascending = false;
+			}
+			else
+			{
+				m_sortKeys.erase(it);
+			}
+		}
+		else if ((it != m_sortKeys.end()) && (m_sortKeys.size() == 1))
+		{
+			if (it->ascending)
+			{
+				it->ascending = false;
+			}
+			else
+			{
+				m_sortKeys.clear();
+			}
+		}
+		else
+		{
+			m_sortKeys = { SortKey{ column, true } };
+		}
+		startSort();
+	}
+
+	void SpreadSheet::cancelBackgroundTasks()
+	{
+		m_rowSorter.cancel();
+		m_rowFilter.cancel();
+		m_finder.cancel();
+		m_statsCalculator.cancel();
+		m_rangeAggregator.cancel();
+	}
+
+	void SpreadSheet::startSort()
+	{
+		// 見出しの三角形を描き直す
+		++m_overlayVersion;
+
+		if (m_sortKeys.isEmpty())
+		{
+			m_rowSorter.cancel();
+			if (m_sortedRows)
+			{
+				m_sortedRows.reset();
+				updateRowView();
+			}
+			return;
+		}
+
+		// 結果が出るまでは今の並び順のまま表示する
+		m_rowSorter.start(m_source, m_sortKeys);
+	}
+
+	void SpreadSheet::startFilter()
+	{
+		// 全ての行を判定し直すので、書き換えた行を別に調べる必要は無い
+		m_refilterRows.clear();
+
+		if (m_filters.isEmpty())
+		{
+			m_rowFilter.cancel();
+			if (m_filterBitmap)
+			{
+				m_filterBitmap.reset();
+				updateRowView();
+			}
+			return;
+		}
+
+		m_rowFilter.start(m_source, m_filters);
+	}
+
+	void SpreadSheet::applyRowTaskResults()
+	{
+		bool changed = false;
+		if (auto rows = m_rowSorter.takeResult())
+		{
+			m_sortedRows = std::move(rows);
+			changed = true;
+		}
+		if (auto bitmap = m_rowFilter.takeResult())
+		{
+			m_filterBitmap = *bitmap;
+			changed = true;
+		}
+		if (auto partial = m_rowFilter.takePartialResult(); partial && m_filterBitmap && (m_filterBitmap->size() <= partial->passed.size()))
+		{
+			changed |= mergePartialFilter(*partial);
+		}
+		if (m_finder.mergeAppendedRows())
+		{
+			m_displayFindMatchCount = none;
+			++m_overlayVersion;
+		}
+
+		if (changed)
+		{
+			updateRowView();
+		}
+	}
+
+	void SpreadSheet::eraseLeadingRows(size_t count)
+	{
+		// 並べ替えた順、絞り込みの結果、見つかった位置は元の行の番号で持っているので、捨てた行を除いて番号を詰める
+		// 並べ替えや絞り込み、検索をやり直すと書き換えがその間止まるので、やり直さずにずらす
+		if (m_sortedRows)
+		{
+			Array<size_t> rows;
+			rows.reserve(m_sortedRows->size());
+			for (const size_t row : *m_sortedRows)
+			{
+				if (count <= row)
+				{
+					rows.push_back(row - count);
+				}
+			}
+			m_sortedRows = std::move(rows);
+		}
+		if (m_filterBitmap)
+		{
+			m_filterBitmap->eraseLeading(count);
+			std::erase_if(m_refilterRows, [&](size_t row) { return (row < count); });
+			for (size_t& row : m_refilterRows)
+			{
+				row -= count;
+			}
+		}
+		if (m_sortedRows || m_filterBitmap)
+		{
+			updateRowView();
+		}
+
+		m_finder.eraseLeadingRows(count);
+		m_displayFindMatchCount = none;
+		++m_overlayVersion;
+
+		m_erasedRowCount += count;
+		++m_labelVersion;
+	}
+
+	void SpreadSheet::refilterRows()
+	{
+		// 絞り込んだ後に増えた行と書き換えた行は、別のスレッドでその行だけを判定し直す
+		// 結果が出るまで、増えた行は表示しない
+		if ((not m_filterBitmap) || m_rowFilter.isBusy())
+		{
+			return;
+		}
+
+		// 終わっている結果を出発点にする
+		applyRowTaskResults();
+
+		const size_t first = m_filterBitmap->size();
+		const size_t rowCount = m_source->rowCount();
+		if ((rowCount < first) || ((rowCount == first) && m_refilterRows.isEmpty()))
+		{
+			return;
+		}
+
+		RowBitmap rows{ rowCount, false };
+		for (const size_t row : m_refilterRows)
+		{
+			if (row < first)
+			{
+				rows.set(row, true);
+			}
+		}
+		for (size_t row = first; row < rowCount; ++row)
+		{
+			rows.set(row, true);
+		}
+		m_refilterRows.clear();
+
+		m_rowFilter.startPartial(m_source, m_filters, std::move(rows));
+	}
+
+	bool SpreadSheet::mergePartialFilter(const RowFilter::PartialResult& result)
+	{
+		const size_t first = m_filterBitmap->size();
+		const bool retested = m_filterBitmap->replace(result.tested, result.passed);
+
+		// 前からあった行の結果が変わった場合や、並べ替えた行の中に増えた行がある場合は並びを作り直す
+		if (retested || (m_sortedRows && (first < m_sortedRows->size())))
+		{
+			return true;
+		}
+
+		// 増えた行は、条件を満たすものだけを末尾に加える
+		Array<size_t> rows;
+		for (size_t row = first; row < m_filterBitmap->size(); ++row)
+		{
+			if (m_filterBitmap->test(row))
+			{
+				rows.push_back(row);
+			}
+		}
+		m_rowView->appendRows(rows, m_filterBitmap->size());
+		return false;
+	}
+
+	void SpreadSheet::updateRowView()
+	{
+		// 並べ替えた順のまま、絞り込みの条件を満たす行だけを残す
+		// 並べ替えた後に増えた行は、末尾に元の順で並べる
+		// 絞り込んだ後に増えた行は、判定が終わるまで表示しない
+		if (m_sortedRows && m_filterBitmap)
+		{
+			Array<size_t> rows = m_filterBitmap->select(*m_sortedRows);
+			for (size_t row = m_sortedRows->size(); row < m_filterBitmap->size(); ++row)
+			{
+				if (m_filterBitmap->test(row))
+				{
+					rows.push_back(row);
+				}
+			}
+			m_rowView->setRows(std::move(rows), m_filterBitmap->size(), false);
+		}
+		else if (m_sortedRows)
+		{
+			const size_t sortedCount = m_sortedRows->size();
+			const size_t rowCount = Max(m_source->rowCount(), sortedCount);
+			Array<size_t> rows = *m_sortedRows;
+			rows.resize(rowCount);
+			std::iota((rows.begin() + sortedCount), rows.end(), sortedCount);
+			m_rowView->setRows(std::move(rows), rowCount);
+		}
+		else if (m_filterBitmap)
+		{
+			m_rowView->setRows(m_filterBitmap->toRows(), m_filterBitmap->size(), false);
+		}
+		else
+		{
+			m_rowView->resetRows();
+		}
+
+		// 範囲選択の集計は表示上の行の順で持っているので、並びが変われば作り直す
+		invalidateRangeIndex(0, m_source->columnCount());
+
+		// 行の名前は元の行の番号なので、並びが変われば作り直す
+		++m_labelVersion;
+	}
+
+	void SpreadSheet::startFind()
+	{
+		// 前の検索語の一致の色を消す
+		++m_overlayVersion;
+		m_displayFindMatchCount = none;
+		m_findSourceVersion = m_source->version();
+		m_findRowCount = m_source->rowCount();
+
+		if (m_findQuery.isEmpty())
+		{
+			m_finder.cancel();
+			return;
+		}
+
+		m_finder.start(m_source, m_findQuery);
+	}
+
+	const Array<FindMatch>& SpreadSheet::getDisplayFindMatches()
+	{
+		const size_t matchCount = m_finder.getMatchCount();
+		if ((m_displayFindMatchCount == matchCount) && (m_displayFindMatchesVersion == m_rowView->version()))
+		{
+			return m_displayFindMatches;
+		}
+
+		// 見つかった位置は元の行の順に並んでいる。絞り込みで表示されていない行を除いて、表示上の行の順に並べ直す
+		m_displayFindMatches = m_finder.getMatches();
+		if (m_rowView->hasRows())
+		{
+			std::erase_if(m_displayFindMatches, [&](FindMatch& match)
+			{
+				const auto row = m_rowView->toDisplayRow(match.row);
+				match.row = row.value_or(0);
+				return (not row);
+			});
+			std::sort(m_displayFindMatches.begin(), m_displayFindMatches.end());
+		}
+		m_displayFindMatchCount = matchCount;
+		m_displayFindMatchesVersion = m_rowView->version();
+		return m_displayFindMatches;
+	}
+
+	bool SpreadSheet::moveToFindMatch(bool forward)
+	{
+		const Array<FindMatch>& matches = getDisplayFindMatches();
+		if (matches.isEmpty())
+		{
+			return false;
+		}
+
+		// 選択中のセルの次から探し、末尾まで無ければ先頭に戻る。選択していなければ先頭か末尾の位置に移る
+		auto it = (forward ? matches.begin() : matches.end());
+		if (m_selectedCell)
+		{
+			const FindMatch current{ static_cast<size_t>(m_selectedCell->y), static_cast<size_t>(m_selectedCell->x) };
+			it = (forward ? std::upper_bound(matches.begin(), matches.end(), current) : std::lower_bound(matches.begin(), matches.end(), current));
+		}
+		if (forward && (it == matches.end()))
+		{
+			it = matches.begin();
+		}
+		if (not forward)
+		{
+			it = std::prev((it == matches.begin()) ? matches.end() : it);
+		}
+
+		const FindMatch match = *it;
+		m_selectedCell = Point{ match.column, match.row };
+		m_selectionEnd = m_selectedCell;
+		m_selectedRow = none;
+		m_selectedColumn = none;
+
+		// 固定した行と列はスクロールしなくても見えている
+		if (not isCellFullyVisible(match.row, match.column))
+		{
+			const Size frozenSize = getFrozenSize();
+			if (m_frozenRows <= match.row)
+			{
+				m_verticalScrollBar.moveTo(m_cellGrid.getCellY(match.row) - frozenSize.y);
+			}
+			if (m_frozenColumns <= match.column)
+			{
+				m_horizontalScrollBar.moveTo(m_cellGrid.getCellX(match.column) - frozenSize.x);
+			}
+		}
+		return true;
+	}
+
+	void SpreadSheet::startColumnStats()
+	{
+		if (not m_selectedColumn)
+		{
+			return;
+		}
+
+		// 選択中の列の統計が今の内容のものなら、集計し直さない
+		const size_t column = *m_selectedColumn;
+		if (m_columnStats.contains(column) && (not m_staleStatsColumns.contains(column)))
+		{
+			return;
+		}
+
+		// 同じ列を集計している間は始め直さず、終わってから新しい内容で集計し直す
+		// 始め直すと、行が増え続ける供給元ではいつまでも集計が終わらない
+		if (m_statsCalculator.isBusy())
+		{
+			if (m_statsColumn == column)
+			{
+				return;
+			}
+			m_statsCalculator.cancel();
+		}
+
+		// 書き換えを待っている間に始めても、書き換える前に中断するだけなので待つ
+		if (hasPendingPatches())
+		{
+			return;
+		}
+
+		m_staleStatsColumns.erase(column);
+		m_statsColumn = column;
+		m_statsCalculator.start(m_source, column);
+	}
+
+	void SpreadSheet::applyColumnStatsResult()
+	{
+		if (auto stats = m_statsCalculator.takeResult())
+		{
+			const size_t column = stats->column;
+			m_columnStats[column] = std::move(*stats);
+		}
+	}
+
+	void SpreadSheet::invalidateColumnStats(size_t firstColumn, size_t lastColumn)
+	{
+		// 古い統計は捨てずに、集計し直すまで表示しておく
+		for (const auto& [column, stats] : m_columnStats)
+		{
+			if ((firstColumn <= column) && (column < lastColumn))
+			{
+				m_staleStatsColumns.emplace(column);
+			}
+		}
+
+		// 集計している列は、結果を受け取ってから集計し直す
+		if (m_statsCalculator.isBusy() && (firstColumn <= m_statsColumn) && (m_statsColumn < lastColumn))
+		{
+			m_staleStatsColumns.emplace(m_statsColumn);
+		}
+		m_statsSourceVersion = m_source->version();
+	}
+
+	void SpreadSheet::invalidateRangeIndex(size_t firstColumn, size_t lastColumn)
+	{
+		m_rangeAggregator.invalidate(firstColumn, lastColumn);
+		m_rangeIndexVersion = m_rowView->version();
+		m_rangeIndexRowCount = m_rowView->rowCount();
+	}
+
+	void SpreadSheet::updateRangeSummary()
+	{
+		// 1 つのセルだけを選択している間は集計しない
+		// 全ての行と列を選ぶと int32 の面積はあふれるので、 uint64 で数える
+		const auto range = getSelectedRange();
+		const uint64 cellCount = (range ? (static_cast<uint64>(range->w) * static_cast<uint64>(range->h)) : 0);
+		if (cellCount <= 1)
+		{
+			m_rangeSummary.reset();
+			return;
+		}
+
+		const IndexRange rows{ static_cast<size_t>(range->y), static_cast<size_t>(range->y + range->h) };
+		const IndexRange columns{ static_cast<size_t>(range->x), static_cast<size_t>(range->x + range->w) };
+		m_rangeSummary = m_rangeAggregator.query(*m_rowView, rows, columns);
+
+		// 広い範囲は、区間木の無い列や行が足りない列の区間木を別のスレッドで作る。揃うまでは集計を表示しない
+		// 書き換えを待っている間に始めても、書き換える前に中断するだけなので待つ
+		if ((RangeAggregator::DirectCellCount < cellCount) && (not hasPendingPatches()))
+		{
+			m_rangeAggregator.build(*m_rowView, columns);
+		}
+	}
+
+	void SpreadSheet::updateScrollBarConstraints()
+	{
+		// 固定した行と列を除いた部分だけをスクロールする
+		const Size areaSize = getCellAreaSize();
+		const Size frozenSize = getFrozenSize();
+		m_verticalScrollBar.updateConstraints(0.0, (m_cellGrid.getTotalHeight() - frozenSize.y), (areaSize.y - frozenSize.y));
+		m_horizontalScrollBar.updateConstraints(0.0, (m_cellGrid.getTotalWidth() - frozenSize.x), (areaSize.x - frozenSize.x));
+	}
+
+	void SpreadSheet::syncSourceSize()
+	{
+		// 読み込み中のファイルなど、行数や列数が後から変わる供給元に追従する
+		const size_t rowCount = m_rowView->rowCount();
+		const size_t columnCount = m_rowView->columnCount();
+		const size_t currentRowCount = m_cellGrid.getRowCount();
+		const size_t currentColumnCount = m_cellGrid.getColumnCount();
+
+		if (rowCount == currentRowCount && columnCount == currentColumnCount)
+		{
+			return;
+		}
+
+		// 行が増えただけなら、それまでの下端より下のタイルだけを描き直す
+		if (currentRowCount < rowCount && columnCount == currentColumnCount)
+		{
+			m_tileCache.invalidateBelow(m_cellGrid.getTotalHeight());
+		}
+		else
+		{
+			++m_tileDataVersion;
+		}
+
+		if (currentRowCount < rowCount)
+		{
+			m_cellGrid.addRows(rowCount - currentRowCount, Config::Cell::Height);
+		}
+		else if (rowCount < currentRowCount)
+		{
+			m_cellGrid.removeRows(rowCount, currentRowCount);
+		}
+
+		if (currentColumnCount < columnCount)
+		{
+			m_cellGrid.addColumns(columnCount - currentColumnCount, Config::Cell::Width);
+		}
+		else if (columnCount < currentColumnCount)
+		{
+			m_cellGrid.removeColumns(columnCount, currentColumnCount);
+		}
+
+		updateScrollBarConstraints();
+	}
+
+	SizeF SpreadSheet::getAreaSize() const noexcept
+	{
+		return m_sheetArea.size;
+	}
+
+	void SpreadSheet::updateScrollOffset()
+	{
+		// スクロールバーの位置をそのまま使う。文字がぼやけないよう、ピクセル単位に丸める
+		const Size areaSize = getCellAreaSize();
+		const int32 maxX = Max((m_cellGrid.getTotalWidth() - areaSize.x), 0);
+		const int32 maxY = Max((m_cellGrid.getTotalHeight() - areaSize.y), 0);
+		m_scrollOffset.x = Clamp(static_cast<int32>(Math::Round(m_horizontalScrollBar.value())), 0, maxX);
+		m_scrollOffset.y = Clamp(static_cast<int32>(Math::Round(m_verticalScrollBar.value())), 0, maxY);
+	}
+
+	void SpreadSheet::updateVisibleSpan()
+	{
+		// 固定した部分はスクロールせず、残りの部分だけがスクロールの分ずれる
+		const Size areaSize = getCellAreaSize();
+		const Size frozenSize = getFrozenSize();
+		const Size bodySize = (areaSize - frozenSize);
+		m_panes[CornerPane].area = Rect{ 0, 0, frozenSize.x, frozenSize.y };
+		m_panes[CornerPane].viewport = Rect{ 0, 0, frozenSize.x, frozenSize.y };
+		m_panes[FrozenRowsPane].area = Rect{ frozenSize.x, 0, bodySize.x, frozenSize.y };
+		m_panes[FrozenRowsPane].viewport = Rect{ (frozenSize.x + m_scrollOffset.x), 0, bodySize.x, frozenSize.y };
+		m_panes[FrozenColumnsPane].area = Rect{ 0, frozenSize.y, frozenSize.x, bodySize.y };
+		m_panes[FrozenColumnsPane].viewport = Rect{ 0, (frozenSize.y + m_scrollOffset.y), frozenSize.x, bodySize.y };
+		m_panes[BodyPane].area = Rect{ frozenSize.x, frozenSize.y, bodySize.x, bodySize.y };
+		m_panes[BodyPane].viewport = Rect{ (frozenSize.x + m_scrollOffset.x), (frozenSize.y + m_scrollOffset.y), bodySize.x, bodySize.y };
+
+		// 領域ごとに、端で一部だけ見える行と列も含めて求める
+		// 幅か高さが 0 の領域でも、もう一方の向きの行や列は求まるので、見出しを描くのに使える
+		for (auto& pane : m_panes)
+		{
+			m_cellGrid.queryVisible(pane.viewport, pane.span);
+		}
+	}
+
+	void SpreadSheet::updateWindow()
+	{
+		// 供給元が変わっていれば、範囲が同じでも全ての領域を読み直す
+		bool refetch = false;
+		const uint64 version = m_rowView->version();
+		if (version != m_fetchedVersion)
+		{
+			m_fetchedVersion = version;
+			++m_dataVersion;
+			refetch = true;
+		}
+
+		for (auto& pane : m_panes)
+		{
+			const auto& span = pane.span;
+			IndexRange rows;
+			IndexRange columns;
+			if (not span.isEmpty())
+			{
+				rows = { span.firstRow, Min(span.lastRow + 1, m_rowView->rowCount()) };
+				columns = { span.firstColumn, Min(span.lastColumn + 1, m_rowView->columnCount()) };
+
+				// タイルには表示範囲の外まで描くので、見えているタイルに掛かるセルを全て読んでおく
+				if (m_tileCacheEnabled)
+				{
+					const Rect tiles = TileRenderCache::GetTileBounds(pane.viewport);
+					const size_t lastRow = m_cellGrid.getRowIndex(tiles.y + tiles.h - 1).value_or(m_cellGrid.getRowCount() - 1);
+					const size_t lastColumn = m_cellGrid.getColumnIndex(tiles.x + tiles.w - 1).value_or(m_cellGrid.getColumnCount() - 1);
+					rows = { m_cellGrid.getRowIndex(tiles.y).value_or(rows.first), Min(lastRow + 1, m_rowView->rowCount()) };
+					columns = { m_cellGrid.getColumnIndex(tiles.x).value_or(columns.first), Min(lastColumn + 1, m_rowView->columnCount()) };
+				}
+			}
+
+			if ((not refetch) && rows == pane.window.rows() && columns == pane.window.columns())
+			{
+				continue;
+			}
+
+			pane.window.reset(rows, columns);
+			m_rowView->fetch(pane.window);
+		}
+	}
+
+	void SpreadSheet::updateCells(const Pane* pane)
+	{
+		m_hoveredCell = (pane ? m_cellGrid.getCellIndex(Cursor::Pos()) : none);
+		if (not MouseL.pressed())
+		{
+			m_draggingSelection = false;
+		}
+
+		if (not (m_hoveredCell.has_value() && isCellVisible(m_hoveredCell->y, m_hoveredCell->x)))
+		{
+			return;
+		}
+
+		if (MouseL.down())
+		{
+			// Shift を押しながらクリックした場合は、選択中のセルからの範囲を選択する
+			if (not (KeyShift.pressed() && m_selectedCell))
+			{
+				m_selectedCell = m_hoveredCell;
+			}
+			m_selectionEnd = m_hoveredCell;
+			m_selectedRow = none;
+			m_selectedColumn = none;
+			m_draggingSelection = true;
+		}
+		else if (m_draggingSelection)
+		{
+			m_selectionEnd = m_hoveredCell;
+		}
+	}
+
+	void SpreadSheet::updateSelectedRow(const Pane* pane)
+	{
+		m_hoveredRow = (pane ? m_cellGrid.getRowIndex(Cursor::Pos().y) : none);
+		if (not m_hoveredRow.has_value()) return;
+
+		const size_t hoveredRow = m_hoveredRow.value();
+		if (hoveredRow < m_cellGrid.getRowCount() && pane->span.containsRow(hoveredRow))
+		{
+			Rect rect = Rect{ 0, m_cellGrid.getCellY(hoveredRow), Config::SheetRow::Width, m_cellGrid.getRowHeight(hoveredRow) };
+			if (rect.leftClicked())
+			{
+				m_selectedRow = m_hoveredRow;
+				m_selectedCell = none;
+			}
+		}
+	}
+
+	void SpreadSheet::updateSelectedColumn(const Pane* pane)
+	{
+		m_hoveredColumn = (pane ? m_cellGrid.getColumnIndex(Cursor::Pos().x) : none);
+		if (not m_hoveredColumn.has_value()) return;
+
+		const size_t hoveredColumn = m_hoveredColumn.value();
+		if (hoveredColumn < m_cellGrid.getColumnCount() && pane->span.containsColumn(hoveredColumn))
+		{
+			const Rect rect{ m_cellGrid.getCellX(hoveredColumn), 0, m_cellGrid.getColumnWidth(hoveredColumn), Config::SheetHeader::Height };
+			if (GetSortButton(rect).leftClicked())
+			{
+				// 右端の三角形をクリックした場合は並べ替えだけを切り替え、選択は変えない
+				// Shift を押しながらクリックした場合は、並べ替えのキーを追加する
+				toggleSortKey(hoveredColumn, KeyShift.pressed());
+			}
+			else if (rect.leftClicked())
+			{
+				m_selectedColumn = m_hoveredColumn;
+				m_selectedCell = none;
+				startColumnStats();
+			}
+		}
+	}
+	
+	bool SpreadSheet::isCellVisible(size_t row, size_t column) const
+	{
+		for (const auto& pane : m_panes)
+		{
+			if (pane.span.containsRow(row) && pane.span.containsColumn(column))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool SpreadSheet::isCellFullyVisible(size_t row, size_t column) const
+	{
+		const Rect rect = m_cellGrid.getCellRect(column, row);
+		for (const auto& pane : m_panes)
+		{
+			const Rect& viewport = pane.viewport;
+			if ((viewport.x <= rect.x) && ((rect.x + rect.w) <= (viewport.x + viewport.w))
+				&& (viewport.y <= rect.y) && ((rect.y + rect.h) <= (viewport.y + viewport.h)))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	Size SpreadSheet::getCellAreaSize() const
+	{
+		// 見出しを除いた、セルを表示する部分の大きさ
+		return Size{ (static_cast<int32>(m_sheetArea.w) - Config::SheetRow::Width), (static_cast<int32>(m_sheetArea.h) - Config::SheetHeader::Height) };
+	}
+
+	Size SpreadSheet::getFrozenSize() const
+	{
+		// 固定した行と列が表示領域より大きい場合は、表示領域に収まる分だけを固定する
+		const Size areaSize = getCellAreaSize();
+		return Size{ Min(m_cellGrid.getCellX(m_frozenColumns), areaSize.x), Min(m_cellGrid.getCellY(m_frozenRows), areaSize.y) };
+	}
+
+	const String* SpreadSheet::findFetchedCell(size_t row, size_t column) const
+	{
+		for (const auto& pane : m_panes)
+		{
+			if (pane.window.contains(row, column))
+			{
+				return &pane.window.at(row, column);
+			}
+		}
+		return nullptr;
+	}
+
+	StringView SpreadSheet::getRowName(size_t row, LabelBuffer& buffer) const
+	{
+		// 並べ替えた後も元の行の名前を表示する
+		return m_rowLabels.get((m_erasedRowCount + m_rowView->toSourceRow(row)), buffer);
+	}
+
+	StringView SpreadSheet::getColumnName(size_t column, LabelBuffer& buffer) const
+	{
+		return m_columnLabels.get(column, buffer);
+	}
+
+	SpreadSheet::RedrawState SpreadSheet::captureRedrawState() const
+	{
+		RedrawState state;
+		state.scrollOffset = m_scrollOffset;
+		state.gridSize = Size{ static_cast<int32>(m_cellGrid.getColumnCount()), static_cast<int32>(m_cellGrid.getRowCount()) };
+		state.cellSizeVersion = m_cellGrid.getSizeVersion();
+		state.frozenSize = getFrozenSize();
+		state.hoveredCell = m_hoveredCell;
+		state.selectedCell = m_selectedCell;
+		state.selectionEnd = m_selectionEnd;
+		state.hoveredRow = m_hoveredRow;
+		state.hoveredColumn = m_hoveredColumn;
+		state.selectedRow = m_selectedRow;
+		state.selectedColumn = m_selectedColumn;
+		state.dataVersion = m_dataVersion;
+		state.labelVersion = m_labelVersion;
+		state.rowViewVersion = m_rowView->version();
+		state.styleVersion = m_styleVersion;
+		state.overlayVersion = m_overlayVersion;
+		state.findMatchCount = m_finder.getMatchCount();
+		return state;
+	}
+
+	void SpreadSheet::drawSheet() const
+	{
+		const Transformer2D sheetHeaderMat{ Mat3x2::Translate(m_sheetArea.x, m_sheetArea.y), TransformCursor::Yes };
+		Rect{ 0, 0, Config::SheetRow::Width, Config::SheetHeader::Height }.draw(Config::SheetHeader::BackgroundColor);
+
+		// 固定した行と列で分けた領域ごとに、それぞれの座標変換で描く
+		// 端で一部だけ見えている行や列は、それぞれの領域の外にはみ出す部分を切り取る
+		for (const auto& pane : m_panes)
+		{
+			if (pane.area.isEmpty())
+			{
+				continue;
+			}
+			const ScopedClipRect clip{ pane.area.movedBy(Config::SheetRow::Width, Config::SheetHeader::Height) };
+			const Point offset = pane.offset();
+			const Transformer2D cellsMat{ Mat3x2::Translate(Config::SheetRow::Width + offset.x, Config::SheetHeader::Height + offset.y), TransformCursor::Yes };
+			drawCells(pane);
+		}
+		for (const size_t index : ColumnHeaderPanes)
+		{
+			const Pane& pane = m_panes[index];
+			const ScopedClipRect clip{ Rect{ (Config::SheetRow::Width + pane.area.x), 0, pane.area.w, Config::SheetHeader::Height } };
+			const Transformer2D t{ Mat3x2::Translate(Config::SheetRow::Width + pane.offset().x, 0), TransformCursor::Yes };
+			drawSheetHeader(pane);
+		}
+		for (const size_t index : RowHeaderPanes)
+		{
+			const Pane& pane = m_panes[index];
+			const ScopedClipRect clip{ Rect{ 0, (Config::SheetHeader::Height + pane.area.y), Config::SheetRow::Width, pane.area.h } };
+			const Transformer2D sheetRowsMat{ Mat3x2::Translate(0, Config::SheetHeader::Height + pane.offset().y), TransformCursor::Yes };
+			drawSheetRows(pane);
+		}
+
+		// 格子の線は見出しの上にも重ねて、まとめて 1 回で描く
+		drawGridLines();
+
+		const int32 sheetWidth = static_cast<int32>(m_sheetArea.w);
+		const int32 sheetHeight = static_cast<int32>(m_sheetArea.h);
+		for (const size_t index : ColumnHeaderPanes)
+		{
+			const Pane& pane = m_panes[index];
+			const ScopedClipRect clip{ Rect{ (Config::SheetRow::Width + pane.area.x), 0, pane.area.w, sheetHeight } };
+			const Transformer2D t{ Mat3x2::Translate(Config::SheetRow::Width + pane.offset().x, 0), TransformCursor::Yes };
+			drawSelectedColumn(pane);
+		}
+		for (const size_t index : RowHeaderPanes)
+		{
+			const Pane& pane = m_panes[index];
+			const ScopedClipRect clip{ Rect{ 0, (Config::SheetHeader::Height + pane.area.y), sheetWidth, pane.area.h } };
+			const Transformer2D sheetRowsMat{ Mat3x2::Translate(0, Config::SheetHeader::Height + pane.offset().y), TransformCursor::Yes };
+			drawSelectedRow(pane);
+		}
+	}
+
+	void SpreadSheet::drawCachedSheet() const
+	{
+		const Size size = m_sheetArea.size.asPoint();
+		const bool resized = (m_frame.size() != size);
+		if (resized)
+		{
+			m_frame = MSRenderTexture{ size };
+		}
+
+		if (resized || needsRedraw())
+		{
+			{
+				const ScopedRenderTarget2D target{ m_frame.clear(Scene::GetBackground()) };
+
+				// 呼び出し元の座標変換を外し、シートの左上をテクスチャの原点に合わせる
+				const Transformer2D t{ Mat3x2::Translate(-m_sheetArea.pos), Transformer2D::Target::SetLocal };
+				drawSheet();
+			}
+			Graphics2D::Flush();
+			m_frame.resolve();
+		}
+
+		m_frame.draw(m_sheetArea.pos);
+	}
+
+	void SpreadSheet::drawSheetHeader(const Pane& pane) const
+	{
+		const auto& span = pane.span;
+		LabelBuffer buffer;
+		for (size_t i = 0; i < span.xs.size(); ++i)
+		{
+			const size_t column = span.firstColumn + i;
+			const Rect rect{ span.xs[i], 0, span.widths[i], Config::SheetHeader::Height };
+			rect.draw(Config::SheetHeader::BackgroundColor);
+			const TextLayoutCache::Key key{ TextLayoutCache::Slot::ColumnName, 0, column, m_labelVersion, rect.w };
+			m_textLayoutCache.get(key, m_indexFont, getColumnName(column, buffer)).drawAt(rect.center(), Config::SheetHeader::TextColor);
+
+			// 並べ替えの向きを右端の三角形で示す。並べ替えていない列は薄い三角形をボタンとして描く
+			const auto it = std::find_if(m_sortKeys.begin(), m_sortKeys.end(), [&](const SortKey& sortKey) { return (sortKey.column == column); });
+			const Rect button = GetSortButton(rect);
+			const double size = Min(7.0, (button.w - 2.0));
+			if (it != m_sortKeys.end())
+			{
+				Triangle{ button.center(), size, (it->ascending ? 0.0 : Math::Pi) }.draw(Config::SheetHeader::SortIndicatorColor);
+			}
+			else if (0.0 < size)
+			{
+				Triangle{ button.center(), size, 0.0 }.draw(Config::SheetHeader::SortButtonColor);
+			}
+		}
+	}
+
+	void SpreadSheet::drawSheetRows(const Pane& pane) const
+	{
+		const auto& span = pane.span;
+		LabelBuffer buffer;
+		for (size_t i = 0; i < span.ys.size(); ++i)
+		{
+			const size_t row = span.firstRow + i;
+			const Rect rect{ 0, span.ys[i], Config::SheetRow::Width, span.heights[i] };
+			rect.draw(Config::SheetRow::BackgroundColor);
+			const TextLayoutCache::Key key{ TextLayoutCache::Slot::RowName, row, 0, m_labelVersion, rect.w };
+			m_textLayoutCache.get(key, m_indexFont, getRowName(row, buffer)).drawAt(rect.center(), Config::SheetRow::TextColor);
+		}
+	}
+
+	void SpreadSheet::drawCells(const Pane& pane) const
+	{
+		const auto& span = pane.span;
+		if (m_tileCacheEnabled)
+		{
+			m_tileCache.draw(pane.viewport, m_tileDataVersion, m_styleVersion, Scene::GetBackground(), [this](const Rect& region) { drawCellTile(region); });
+		}
+		else
+		{
+			drawCellContents(span);
+		}
+
+		// 検索の一致はタイルに描かず、見えているセルの分だけ重ねる
+		// 検索の途中で一致が増えても、タイルは描き直さずに済む
+		if (m_finder.getMatchCount() != 0)
+		{
+			for (size_t k = 0; k < span.ys.size(); ++k)
+			{
+				const size_t sourceRow = m_rowView->toSourceRow(span.firstRow + k);
+				for (size_t i = 0; i < span.xs.size(); ++i)
+				{
+					if (m_finder.isMatch(sourceRow, (span.firstColumn + i)))
+					{
+						Rect{ span.xs[i], span.ys[k], span.widths[i], span.heights[k] }.draw(Config::Cell::FoundColor);
+					}
+				}
+			}
+		}
+
+		// 範囲選択はタイルに描かず、見えている部分だけを 1 つの矩形で重ねる
+		if (const Optional<Rect> range = getSelectedRange(); range && (not span.isEmpty()))
+		{
+			const size_t firstColumn = Max<size_t>(range->x, span.firstColumn);
+			const size_t lastColumn = Min<size_t>((range->x + range->w - 1), span.lastColumn);
+			const size_t firstRow = Max<size_t>(range->y, span.firstRow);
+			const size_t lastRow = Min<size_t>((range->y + range->h - 1), span.lastRow);
+			if ((firstColumn <= lastColumn) && (firstRow <= lastRow))
+			{
+				const Point topLeft = span.getCellRect(firstColumn, firstRow).pos;
+				const Point bottomRight = span.getCellRect(lastColumn, lastRow).br();
+				Rect{ topLeft, (bottomRight - topLeft) }.draw(Config::Cell::RangeColor);
+			}
+		}
+
+		if (m_hoveredCell.has_value() && span.containsRow(m_hoveredCell->y) && span.containsColumn(m_hoveredCell->x))
+		{
+			const Rect rect = span.getCellRect(m_hoveredCell->x, m_hoveredCell->y);
+			rect.stretched(-1, 0, 0, -1).draw(Config::Cell::HoveredColor);
+		}
+		
+		if (m_selectedCell.has_value() && span.containsRow(m_selectedCell->y) && span.containsColumn(m_selectedCell->x))
+		{
+			const Rect rect = span.getCellRect(m_selectedCell->x, m_selectedCell->y);
+			rect.stretched(-1, 0, 0, -1).drawFrame(1, 0, Config::Cell::SelectedColor);
+		}
+	}
+
+	void SpreadSheet::drawCellContents(const CellGrid::VisibleSpan& span) const
+	{
+		for (size_t k = 0; k < span.ys.size(); ++k)
+		{
+			const size_t row = span.firstRow + k;
+			for (size_t i = 0; i < span.xs.size(); ++i)
+			{
+				const size_t column = span.firstColumn + i;
+				const Rect rect{ span.xs[i], span.ys[k], span.widths[i], span.heights[k] };
+				rect.draw(Config::Cell::BackgroundColor);
+				const String* value = findFetchedCell(row, column);
+				if (not value)
+				{
+					continue;
+				}
+				const Rect textRect = rect.stretched(-5, 0);
+				const TextLayoutCache::Key key{ TextLayoutCache::Slot::Cell, row, column, std::hash<StringView>{}(*value), textRect.w };
+				m_textLayoutCache.get(key, m_textFont, *value).draw(textRect.pos, Config::Cell::TextColor);
+			}
+		}
+	}
+
+	void SpreadSheet::drawCellTile(const Rect& region) const
+	{
+		m_cellGrid.queryVisible(region, m_tileSpan);
+		drawCellContents(m_tileSpan);
+
+		// 格子の線もタイルに描いておく。最後の列と行の後ろの線は、その位置を含むタイルが描く
+		// m_gridLines はこの後の drawGridLines() で積み直すので、ここで使ってよい
+		const int32 gridRight = m_cellGrid.getTotalWidth();
+		const int32 gridBottom = m_cellGrid.getTotalHeight();
+		const int32 lineRight = Min((region.x + region.w), (gridRight + 1));
+		const int32 lineBottom = Min((region.y + region.h), (gridBottom + 1));
+		m_gridLines.clear();
+		for (const int32 x : m_tileSpan.xs)
+		{
+			m_gridLines.addVertical(x, region.y, lineBottom);
+		}
+		if ((region.x <= gridRight) && (gridRight < (region.x + region.w)))
+		{
+			m_gridLines.addVertical(gridRight, region.y, lineBottom);
+		}
+		for (const int32 y : m_tileSpan.ys)
+		{
+			m_gridLines.addHorizontal(y, region.x, lineRight);
+		}
+		if ((region.y <= gridBottom) && (gridBottom < (region.y + region.h)))
+		{
+			m_gridLines.addHorizontal(gridBottom, region.x, lineRight);
+		}
+		m_gridLines.draw(Config::Grid::Color);
+	}
+
+	void SpreadSheet::drawSelectedRow(const Pane& pane) const
+	{
+		if (m_selectedRow.has_value()
+			&& m_selectedRow.value() < m_cellGrid.getRowCount()
+			&& pane.span.containsRow(m_selectedRow.value())
+		)
+		{
+			const size_t row = m_selectedRow.value();
+			const Rect rect = Rect{ 0, m_cellGrid.getCellY(row), m_sheetArea.asRect().w, m_cellGrid.getRowHeight(row)};
+			rect.drawFrame(1, 0, Config::SheetRow::SelectedColor);
+		}
+	}
+
+	void SpreadSheet::drawSelectedColumn(const Pane& pane) const
+	{
+		if (m_selectedColumn.has_value()
+			&& m_selectedColumn.value() < m_cellGrid.getColumnCount()
+			&& pane.span.containsColumn(m_selectedColumn.value())
+		)
+		{
+			size_t column = m_selectedColumn.value();
+			const Rect rect = Rect{ m_cellGrid.getCellX(column), 0, m_cellGrid.getColumnWidth(column), m_sheetArea.asRect().h};
+			rect.drawFrame(1, 0, Config::SheetHeader::SelectedColor);
+		}
+	}
+
+	void SpreadSheet::drawGridLines() const
+	{
+		// シートの左上を原点とする座標で、表示中の列と行の境界ごとに 1 本ずつ線を積む
+		// 見出しの区切りは見出しの領域ごとに、セルの間の線はセルの領域ごとに、その領域の中だけに積む
+		m_gridLines.clear();
+
+		const int32 sheetWidth = static_cast<int32>(m_sheetArea.w);
+		const int32 sheetHeight = static_cast<int32>(m_sheetArea.h);
+
+		// 領域の左上 (left, top) から見た列と行の境界を、[first, last) の範囲に収まるものだけ積む
+		const auto addVerticals = [&](const CellGrid::VisibleSpan& span, int32 left, int32 first, int32 last, int32 top, int32 bottom)
+		{
+			for (const int32 x : span.xs)
+			{
+				if ((first <= (left + x)) && ((left + x) < last))
+				{
+					m_gridLines.addVertical((left + x), top, bottom);
+				}
+			}
+			const int32 right = (left + span.xs.back() + span.widths.back());
+			if ((first <= right) && (right < last))
+			{
+				m_gridLines.addVertical(right, top, bottom);
+			}
+		};
+		const auto addHorizontals = [&](const CellGrid::VisibleSpan& span, int32 top, int32 first, int32 last, int32 left, int32 right)
+		{
+			for (const int32 y : span.ys)
+			{
+				if ((first <= (top + y)) && ((top + y) < last))
+				{
+					m_gridLines.addHorizontal((top + y), left, right);
+				}
+			}
+			const int32 bottom = (top + span.ys.back() + span.heights.back());
+			if ((first <= bottom) && (bottom < last))
+			{
+				m_gridLines.addHorizontal(bottom, left, right);
+			}
+		};
+
+		for (const size_t index : ColumnHeaderPanes)
+		{
+			const Pane& pane = m_panes[index];
+			if (pane.span.xs.isEmpty())
+			{
+				continue;
+			}
+			const int32 areaLeft = (Config::SheetRow::Width + pane.area.x);
+			addVerticals(pane.span, (Config::SheetRow::Width + pane.offset().x), areaLeft, Min(sheetWidth, (areaLeft + pane.area.w)), 0, Config::SheetHeader::Height);
+		}
+		for (const size_t index : RowHeaderPanes)
+		{
+			const Pane& pane = m_panes[index];
+			if (pane.span.ys.isEmpty())
+			{
+				continue;
+			}
+			const int32 areaTop = (Config::SheetHeader::Height + pane.area.y);
+			addHorizontals(pane.span, (Config::SheetHeader::Height + pane.offset().y), areaTop, Min(sheetHeight, (areaTop + pane.area.h)), 0, Config::SheetRow::Width);
+		}
+
+		// タイルに描いた場合は、セルの間の線はタイルに含まれている
+		if (not m_tileCacheEnabled)
+		{
+			for (const auto& pane : m_panes)
+			{
+				if (pane.span.isEmpty())
+				{
+					continue;
+				}
+				const Rect area = pane.area.movedBy(Config::SheetRow::Width, Config::SheetHeader::Height);
+				const int32 left = (Config::SheetRow::Width + pane.offset().x);
+				const int32 top = (Config::SheetHeader::Height + pane.offset().y);
+				const int32 right = Min((area.x + area.w), (left + pane.span.xs.back() + pane.span.widths.back() + 1));
+				const int32 bottom = Min((area.y + area.h), (top + pane.span.ys.back() + pane.span.heights.back() + 1));
+				addVerticals(pane.span, left, area.x, (area.x + area.w), area.y, bottom);
+				addHorizontals(pane.span, top, area.y, (area.y + area.h), area.x, right);
+			}
+		}
+
+		// 固定した行と列の境目に、見出しからシートの端までの区切りを引く
+		const Size frozenSize = getFrozenSize();
+		if (0 < frozenSize.x)
+		{
+			m_gridLines.addVertical((Config::SheetRow::Width + frozenSize.x), 0, sheetHeight);
+		}
+		if (0 < frozenSize.y)
+		{
+			m_gridLines.addHorizontal((Config::SheetHeader::Height + frozenSize.y), 0, sheetWidth);
+		}
+
+		m_gridLines.draw(Config::Grid::Color);
+	}
+}
@@ -0,0 +1,118 @@
+﻿# include "SimpleGridViewer/StreamingCellSource.hpp"
+
+namespace SimpleGridViewer
+{
+	StreamingCellSource::StreamingCellSource(size_t columnCount, size_t maxRows)
+		: m_columnCount{ columnCount }
+		, m_maxRows{ Max<size_t>(maxRows, 1) } {}
+
+	size_t StreamingCellSource::rowCount() const
+	{
+		return m_rowCount;
+	}
+
+	size_t StreamingCellSource::columnCount() const
+	{
+		return m_columnCount;
+	}
+
+	uint64 StreamingCellSource::version() const
+	{
+		return m_version;
+	}
+
+	void StreamingCellSource::fetch(CellWindow& window) const
+	{
+		for (size_t row = window.rows().first; row < window.rows().last; ++row)
+		{
+			for (size_t column = window.columns().first; column < window.columns().last; ++column)
+			{
+				window.at(row, column) = cell(row, column);
+			}
+		}
+	}
+
+	Optional<StringView> StreamingCellSource::view(size_t row, size_t column) const
+	{
+		if (m_rowCount <= row || m_columnCount <= column)
+		{
+			return none;
+		}
+		return StringView{ cell(row, column) };
+	}
+
+	bool StreamingCellSource::setCell(size_t row, size_t column, StringView value)
+	{
+		if (m_rowCount <= row || m_columnCount <= column)
+		{
+			return false;
+		}
+
+		const size_t slot = ((m_head + row) % m_maxRows);
+		m_cells[slot * m_columnCount + column].assign(value);
+		++m_version;
+		return true;
+	}
+
+	bool StreamingCellSource::appendRow(std::span<const String> values)
+	{
+		appendRowImpl(values);
+		return true;
+	}
+
+	bool StreamingCellSource::appendRow(std::span<const StringView> values)
+	{
+		appendRowImpl(values);
+		return true;
+	}
+
+	void StreamingCellSource::clear()
+	{
+		m_cells.clear();
+		m_head = 0;
+		m_rowCount = 0;
+		++m_version;
+	}
+
+	size_t StreamingCellSource::maxRows() const noexcept
+	{
+		return m_maxRows;
+	}
+
+	template <class Type>
+	void StreamingCellSource::appendRowImpl(std::span<const Type> values)
+	{
+		size_t slot;
+		if (m_rowCount < m_maxRows)
+		{
+			slot = m_rowCount++;
+			m_cells.resize(m_rowCount * m_columnCount);
+		}
+		else
+		{
+			// 最も古い行を上書きする。既存の行の位置がずれるので内容が変わったことにする
+			slot = m_head;
+			m_head = ((m_head + 1) % m_maxRows);
+			++m_version;
+		}
+
+		String* destination = &m_cells[slot * m_columnCount];
+		for (size_t column = 0; column < m_columnCount; ++column)
+		{
+			if (column < values.size())
+			{
+				destination[column].assign(StringView{ values[column] });
+			}
+			else
+			{
+				destination[column].clear();
+			}
+		}
+	}
+
+	const String& StreamingCellSource::cell(size_t row, size_t column) const
+	{
+		const size_t slot = ((m_head + row) % m_maxRows);
+		return m_cells[slot * m_columnCount + column];
+	}
+}
@@ -0,0 +1,126 @@
+﻿# include <bit>
+# include "SimpleGridViewer/SubstringSearcher.hpp"
+# include "SimpleGridViewer/Parallel.hpp"
+
+namespace SimpleGridViewer
+{
+	namespace
+	{
+		template <class Char>
+		bool Matches(const Char* text, const Char* needle, size_t size) noexcept
+		{
+			return std::equal(needle, (needle + size), text);
+		}
+
+	# if SIMPLEGRIDVIEWER_AVX2
+		using Block = __m256i;
+
+		Block Load(const void* p) noexcept { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }
+
+		Block Broadcast(char c) noexcept { return _mm256_set1_epi8(c); }
+
+		Block Broadcast(char32 c) noexcept { return _mm256_set1_epi32(static_cast<int32>(c)); }
+
+		// 各位置で両方が一致したかどうかを、位置ごとに 1 ビットで返す
+		uint32 MatchMask(Block first, Block last, Block firstChar, Block lastChar, char) noexcept
+		{
+			return static_cast<uint32>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, firstChar), _mm256_cmpeq_epi8(last, lastChar))));
+		}
+
+		uint32 MatchMask(Block first, Block last, Block firstChar, Block lastChar, char32) noexcept
+		{
+			return static_cast<uint32>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpeq_epi32(first, firstChar), _mm256_cmpeq_epi32(last, lastChar)))));
+		}
+	# elif SIMPLEGRIDVIEWER_SSE2
+		using Block = __m128i;
+
+		Block Load(const void* p) noexcept { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+
+		Block Broadcast(char c) noexcept { return _mm_set1_epi8(c); }
+
+		Block Broadcast(char32 c) noexcept { return _mm_set1_epi32(static_cast<int32>(c)); }
+
+		uint32 MatchMask(Block first, Block last, Block firstChar, Block lastChar, char) noexcept
+		{
+			return static_cast<uint32>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, firstChar), _mm_cmpeq_epi8(last, lastChar))));
+		}
+
+		uint32 MatchMask(Block first, Block last, Block firstChar, Block lastChar, char32) noexcept
+		{
+			return static_cast<uint32>(_mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(_mm_cmpeq_epi32(first, firstChar), _mm_cmpeq_epi32(last, lastChar)))));
+		}
+	# endif
+
+		template <class Char>
+		bool Contains(const Char* text, size_t textSize, const Char* needle, size_t needleSize) noexcept
+		{
+			if (needleSize == 0)
+			{
+				return true;
+			}
+			if (textSize < needleSize)
+			{
+				return false;
+			}
+
+			// 検索語が始まりうる位置の数
+			const size_t positions = (textSize - needleSize + 1);
+			const size_t tail = (needleSize - 1);
+
+			// 先頭と末尾の間の文字数
+			const size_t middle = ((needleSize < 2) ? 0 : (needleSize - 2));
+			size_t i = 0;
+
+		# if SIMPLEGRIDVIEWER_AVX2 || SIMPLEGRIDVIEWER_SSE2
+			constexpr size_t Lanes = (sizeof(Block) / sizeof(Char));
+			const Block firstChar = Broadcast(needle[0]);
+			const Block lastChar = Broadcast(needle[tail]);
+			for (; (i + Lanes) <= positions; i += Lanes)
+			{
+				for (uint32 mask = MatchMask(Load(text + i), Load(text + i + tail), firstChar, lastChar, Char{}); mask; mask &= (mask - 1))
+				{
+					const size_t position = (i + std::countr_zero(mask));
+					if (Matches(text + position + 1, needle + 1, middle))
+					{
+						return true;
+					}
+				}
+			}
+		# endif
+
+			for (; i < positions; ++i)
+			{
+				if ((text[i] == needle[0]) && (text[i + tail] == needle[tail])
+					&& Matches(text + i + 1, needle + 1, middle))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+
+	SubstringSearcher::SubstringSearcher(StringView needle)
+		: m_needle{ needle }
+		, m_utf8{ Unicode::ToUTF8(needle) } {}
+
+	bool SubstringSearcher::isEmpty() const noexcept
+	{
+		return m_needle.isEmpty();
+	}
+
+	const String& SubstringSearcher::needle() const noexcept
+	{
+		return m_needle;
+	}
+
+	bool SubstringSearcher::contains(StringView text) const noexcept
+	{
+		return Contains(text.data(), text.size(), m_needle.data(), m_needle.size());
+	}
+
+	bool SubstringSearcher::contains(std::string_view utf8) const noexcept
+	{
+		return Contains(utf8.data(), utf8.size(), m_utf8.data(), m_utf8.size());
+	}
+}
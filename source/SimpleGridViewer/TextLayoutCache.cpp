@@ -0,0 +1,125 @@
+﻿# include "SimpleGridViewer/TextLayoutCache.hpp"
+
+namespace SimpleGridViewer
+{
+	void TextLayoutCache::Layout::draw(const Vec2& pos, const ColorF& color) const
+	{
+		for (size_t i = 0; i < glyphs.size(); ++i)
+		{
+			glyphs[i].texture.draw(pos + Vec2{ penX[i], 0.0 } + glyphs[i].getOffset(), color);
+		}
+	}
+
+	void TextLayoutCache::Layout::drawAt(const Vec2& center, const ColorF& color) const
+	{
+		draw(center - Vec2{ width * 0.5, height * 0.5 }, color);
+	}
+
+	TextLayoutCache::TextLayoutCache(size_t capacity)
+		: m_capacity(Max<size_t>(capacity, 1)) {}
+
+	const TextLayoutCache::Layout& TextLayoutCache::get(const Key& key, const Font& font, StringView text)
+	{
+		if (auto it = m_index.find(key); it != m_index.end())
+		{
+			++m_hits;
+			m_entries.splice(m_entries.begin(), m_entries, it->second);
+			return it->second->second;
+		}
+
+		++m_misses;
+		if (m_entries.size() >= m_capacity)
+		{
+			m_index.erase(m_entries.back().first);
+			m_entries.pop_back();
+		}
+
+		m_entries.emplace_front(key, MakeLayout(font, text, key.clipWidth));
+		m_index.emplace(key, m_entries.begin());
+		return m_entries.front().second;
+	}
+
+	void TextLayoutCache::clear()
+	{
+		m_entries.clear();
+		m_index.clear();
+	}
+
+	size_t TextLayoutCache::size() const noexcept
+	{
+		return m_entries.size();
+	}
+
+	size_t TextLayoutCache::capacity() const noexcept
+	{
+		return m_capacity;
+	}
+
+	size_t TextLayoutCache::hits() const noexcept
+	{
+		return m_hits;
+	}
+
+	size_t TextLayoutCache::misses() const noexcept
+	{
+		return m_misses;
+	}
+
+	void TextLayoutCache::resetCounters() noexcept
+	{
+		m_hits = 0;
+		m_misses = 0;
+	}
+
+	size_t TextLayoutCache::KeyHash::operator()(const Key& key) const noexcept
+	{
+		uint64 h = static_cast<uint64>(key.slot);
+		for (const uint64 value : { key.row, key.column, key.content, static_cast<uint64>(static_cast<uint32>(key.clipWidth)) })
+		{
+			h ^= value + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+		}
+		return static_cast<size_t>(h);
+	}
+
+	TextLayoutCache::Layout TextLayoutCache::MakeLayout(const Font& font, StringView text, int32 clipWidth)
+	{
+		Layout layout;
+		layout.height = font.height();
+
+		// 1 行目だけを、幅に収まるところまで並べる
+		bool truncated = false;
+		double penX = 0.0;
+		for (const auto& glyph : font.getGlyphs(text))
+		{
+			if (glyph.codePoint == U'\n' || glyph.codePoint == U'\r' || clipWidth < (penX + glyph.xAdvance))
+			{
+				truncated = true;
+				break;
+			}
+			layout.glyphs.push_back(glyph);
+			layout.penX.push_back(penX);
+			penX += glyph.xAdvance;
+		}
+
+		// 収まらなかった場合は、末尾を省略記号に置き換える
+		if (truncated)
+		{
+			const Glyph ellipsis = font.getGlyph(U'…');
+			while (layout.glyphs && clipWidth < (penX + ellipsis.xAdvance))
+			{
+				penX = layout.penX.back();
+				layout.glyphs.pop_back();
+				layout.penX.pop_back();
+			}
+			if ((penX + ellipsis.xAdvance) <= clipWidth)
+			{
+				layout.glyphs.push_back(ellipsis);
+				layout.penX.push_back(penX);
+				penX += ellipsis.xAdvance;
+			}
+		}
+
+		layout.width = penX;
+		return layout;
+	}
+}
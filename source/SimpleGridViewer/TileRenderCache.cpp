@@ -0,0 +1,189 @@
+﻿# include "SimpleGridViewer/TileRenderCache.hpp"
+
+namespace SimpleGridViewer
+{
+	TileRenderCache::TileRenderCache(size_t capacity)
+		: m_capacity(Max<size_t>(capacity, 1)) {}
+
+	Rect TileRenderCache::GetTileBounds(const Rect& region)
+	{
+		// 座標は 0 以上なので、割り算の切り捨てでタイルの番号になる
+		const int32 left = ((Max(region.x, 0) / TileSize) * TileSize);
+		const int32 top = ((Max(region.y, 0) / TileSize) * TileSize);
+		const int32 right = (((Max(region.x + region.w, 0) + TileSize - 1) / TileSize) * TileSize);
+		const int32 bottom = (((Max(region.y + region.h, 0) + TileSize - 1) / TileSize) * TileSize);
+		return Rect{ left, top, (right - left), (bottom - top) };
+	}
+
+	void TileRenderCache::draw(const Rect& viewport, uint64 dataVersion, uint64 styleVersion, const ColorF& background, const Renderer& render)
+	{
+		m_renderedCount = 0;
+		if ((viewport.w <= 0) || (viewport.h <= 0))
+		{
+			return;
+		}
+
+		if (background != m_background)
+		{
+			m_background = background;
+			for (auto& tile : m_tiles)
+			{
+				tile.valid = false;
+			}
+		}
+
+		const Rect bounds = GetTileBounds(viewport);
+		const int32 viewRight = (viewport.x + viewport.w);
+		const int32 viewBottom = (viewport.y + viewport.h);
+		size_t usedCount = 0;
+
+		for (int32 y = bounds.y; y < (bounds.y + bounds.h); y += TileSize)
+		{
+			for (int32 x = bounds.x; x < (bounds.x + bounds.w); x += TileSize)
+			{
+				const Rect region{ x, y, TileSize, TileSize };
+				Tile& tile = acquire(Key{ (x / TileSize), (y / TileSize) });
+				++usedCount;
+
+				if ((not tile.valid) || (tile.dataVersion != dataVersion) || (tile.styleVersion != styleVersion))
+				{
+					{
+						const ScopedRenderTarget2D target{ tile.texture.clear(m_background) };
+
+						// 呼び出し元のシザー矩形は画面の座標なので、タイルに描くときは外す
+						const ScopedRenderStates2D states{ RasterizerState::Default2D };
+
+						// 呼び出し元の座標変換を外し、タイルの左上をテクスチャの原点に合わせる
+						const Transformer2D t{ Mat3x2::Translate(-region.pos), Transformer2D::Target::SetLocal };
+						render(region);
+					}
+					tile.dataVersion = dataVersion;
+					tile.styleVersion = styleVersion;
+					tile.valid = true;
+					++m_renderedCount;
+				}
+
+				// viewport からはみ出す部分は切り取って貼る
+				const int32 left = Max(x, viewport.x);
+				const int32 top = Max(y, viewport.y);
+				const int32 right = Min((x + TileSize), viewRight);
+				const int32 bottom = Min((y + TileSize), viewBottom);
+				tile.texture((left - x), (top - y), (right - left), (bottom - top)).draw(left, top);
+			}
+		}
+
+		evict(usedCount);
+	}
+
+	void TileRenderCache::invalidate(const Rect& region)
+	{
+		if ((region.w <= 0) || (region.h <= 0))
+		{
+			return;
+		}
+
+		const Rect bounds = GetTileBounds(region);
+		for (int32 y = bounds.y; y < (bounds.y + bounds.h); y += TileSize)
+		{
+			for (int32 x = bounds.x; x < (bounds.x + bounds.w); x += TileSize)
+			{
+				if (const auto it = m_index.find(Key{ (x / TileSize), (y / TileSize) }); it != m_index.end())
+				{
+					it->second->valid = false;
+				}
+			}
+		}
+	}
+
+	void TileRenderCache::invalidateBelow(int32 top)
+	{
+		const int32 firstRow = (Max(top, 0) / TileSize);
+		for (auto& tile : m_tiles)
+		{
+			if (firstRow <= tile.key.y)
+			{
+				tile.valid = false;
+			}
+		}
+	}
+
+	void TileRenderCache::clear()
+	{
+		for (auto& tile : m_tiles)
+		{
+			m_freeTextures.push_back(std::move(tile.texture));
+		}
+		m_tiles.clear();
+		m_index.clear();
+	}
+
+	void TileRenderCache::release()
+	{
+		m_tiles.clear();
+		m_index.clear();
+		m_freeTextures.clear();
+	}
+
+	size_t TileRenderCache::size() const noexcept
+	{
+		return m_tiles.size();
+	}
+
+	size_t TileRenderCache::capacity() const noexcept
+	{
+		return m_capacity;
+	}
+
+	size_t TileRenderCache::renderedCount() const noexcept
+	{
+		return m_renderedCount;
+	}
+
+	TileRenderCache::Tile& TileRenderCache::acquire(const Key& key)
+	{
+		if (const auto it = m_index.find(key); it != m_index.end())
+		{
+			m_tiles.splice(m_tiles.begin(), m_tiles, it->second);
+			return m_tiles.front();
+		}
+
+		Tile tile;
+		tile.key = key;
+		if (not m_freeTextures.isEmpty())
+		{
+			tile.texture = std::move(m_freeTextures.back());
+			m_freeTextures.pop_back();
+		}
+		else
+		{
+			tile.texture = RenderTexture{ Size{ TileSize, TileSize } };
+		}
+
+		m_tiles.push_front(std::move(tile));
+		m_index.emplace(key, m_tiles.begin());
+		return m_tiles.front();
+	}
+
+	void TileRenderCache::evict(size_t usedCount)
+	{
+		// 今回使ったタイルは先頭に集まっているので、それより後ろから捨てる
+		while (Max(m_capacity, usedCount) < m_tiles.size())
+		{
+			m_index.erase(m_tiles.back().key);
+			m_freeTextures.push_back(std::move(m_tiles.back().texture));
+			m_tiles.pop_back();
+		}
+
+		// 使い回す当てのないテクスチャは解放する
+		while ((not m_freeTextures.isEmpty()) && (m_capacity < (m_tiles.size() + m_freeTextures.size())))
+		{
+			m_freeTextures.pop_back();
+		}
+	}
+
+	size_t TileRenderCache::KeyHash::operator()(const Key& key) const noexcept
+	{
+		const uint64 h = ((static_cast<uint64>(static_cast<uint32>(key.y)) << 32) | static_cast<uint32>(key.x));
+		return static_cast<size_t>(h * 0x9e3779b97f4a7c15ull);
+	}
+}
@@ -1,261 +1,425 @@
-﻿# include "gridcell/CellGrid.hpp"
-
-/// @brief 各列の幅と各行の高さを指定して CellGrid を作成します。
-/// @param columnWidths 各列の幅（ピクセル）
-/// @param rowHeights 各行の高さ（ピクセル）
-CellGrid::CellGrid(const Array<int32>& columnWidths, const Array<int32>& rowHeights)
-	: m_columnWidths(columnWidths)
-	, m_rowHeights(rowHeights) {}
-
-/// @brief 列の個数を返します。
-/// @return 列の個数
-[[nodiscard]]
-size_t CellGrid::getColumnCount() const noexcept
-{
-	return m_columnWidths.size();
-}
-
-/// @brief 行の個数を返します。
-/// @return 行の個数
-[[nodiscard]]
-size_t CellGrid::getRowCount() const noexcept
-{
-	return m_rowHeights.size();
-}
-
-/// @brief セルの個数が 0 であるかを返します。
-/// @return セルの個数が 0 である場合 true, それ以外の場合は false
-[[nodiscard]]
-bool CellGrid::isEmpty() const noexcept
-{
-	return (m_columnWidths.isEmpty() || m_rowHeights.isEmpty());
-}
-
-/// @brief セルの個数を返します。
-/// @return セルの個数
-[[nodiscard]]
-size_t CellGrid::getNumCells() const noexcept
-{
-	return getRowCount() * getColumnCount();
-}
-
-/// @brief 行と列の情報をクリアします。
-void CellGrid::clear() noexcept
-{
-	m_columnWidths.clear();
-	m_rowHeights.clear();
-}
-
-/// @brief 各列の幅を返します。
-/// @return 各列の幅（ピクセル）
-[[nodiscard]]
-const Array<int32>& CellGrid::getColumnWidths() const noexcept
-{
-	return m_columnWidths.getWidthArray();
-}
-
-/// @brief 各行の高さを返します。
-/// @return 各行の高さ（ピクセル）
-[[nodiscard]]
-const Array<int32>& CellGrid::getRowHeights() const noexcept
-{
-	return m_rowHeights.getWidthArray();
-}
-
-/// @brief 列の幅を追加します。
-/// @param width 列の幅（ピクセル）
-/// @remark この関数を呼び出すと、列の個数が 1 増えます。
-void CellGrid::addColumn(int32 width)
-{
-	m_columnWidths.insert(getColumnCount(), width);
-}
-
-/// @brief 行の高さを追加します。
-/// @param height 行の高さ（ピクセル）
-/// @remark この関数を呼び出すと、行の個数が 1 増えます。
-void CellGrid::addRow(int32 height)
-{
-	m_rowHeights.insert(getRowCount(), height);
-}
-
-/// @brief 指定した列を削除します。
-/// @param column 列
-void CellGrid::removeColumn(size_t column)
-{
-	assert(column < m_columnWidths.size());
-	m_columnWidths.erase(column);
-}
-
-/// @brief 指定した行を削除します。
-/// @param row 行
-void CellGrid::removeRow(size_t row)
-{
-	assert(row < m_rowHeights.size());
-	m_rowHeights.erase(row);
-}
-
-/// @brief 列を挿入します。
-/// @param column 挿入する列の位置
-/// @param width 列の幅（ピクセル）
-void CellGrid::insertColumn(size_t column, int32 width)
-{
-	assert(column <= m_columnWidths.size());
-	m_columnWidths.insert(column, width);
-}
-
-/// @brief 行を挿入します。
-/// @param row 挿入する行の位置
-/// @param height 行の高さ（ピクセル）
-void CellGrid::insertRow(size_t row, int32 height)
-{
-	assert(row <= m_rowHeights.size());
-	m_rowHeights.insert(row, height);
-}
-
-/// @brief 指定した列の幅を変更します。
-/// @param column 列
-/// @param width 列の幅（ピクセル）
-void CellGrid::setColumnWidth(size_t column, int32 width) noexcept
-{
-	assert(column < m_columnWidths.size());
-	m_columnWidths.setWidth(column, width);
-}
-
-/// @brief 指定した行の高さを変更します。
-/// @param row 行
-/// @param height 行の高さ（ピクセル）
-void CellGrid::setRowHeight(size_t row, int32 height) noexcept
-{
-	assert(row < m_rowHeights.size());
-	m_rowHeights.setWidth(row, height);
-}
-
-/// @brief 指定した列の幅を返します。
-/// @param column 列
-/// @return 列の幅（ピクセル）
-[[nodiscard]]
-int32 CellGrid::getColumnWidth(size_t column) const noexcept
-{
-	assert(column < m_columnWidths.size());
-	return m_columnWidths.getWidth(column);
-}
-
-/// @brief 指定した行の高さを返します。
-/// @param row 行
-/// @return 行の高さ（ピクセル）
-[[nodiscard]]
-int32 CellGrid::getRowHeight(size_t row) const noexcept
-{
-	assert(row < m_rowHeights.size());
-	return m_rowHeights.getWidth(row);
-}
-
-/// @brief 指定したインデックスのセルのサイズを返します。
-/// @param column 列
-/// @param row 行
-/// @return セルのサイズ（ピクセル）
-Size CellGrid::getCellSize(size_t column, size_t row) const noexcept
-{
-	assert(column < m_columnWidths.size());
-	assert(row < m_rowHeights.size());
-	return{ m_columnWidths.getWidth(column), m_rowHeights.getWidth(row) };
-}
-
-/// @brief 全ての列の幅の合計を返します。
-/// @return 全ての列の幅の合計（ピクセル）
-[[nodiscard]]
-int32 CellGrid::getTotalWidth() const noexcept
-{
-	return m_columnWidths.totalWidth();
-}
-
-/// @brief 全ての行の高さの合計を返します。
-/// @return 全ての行の高さの合計（ピクセル）
-[[nodiscard]]
-int32 CellGrid::getTotalHeight() const noexcept
-{
-	return m_rowHeights.totalWidth();
-}
-
-/// @brief 指定した列が始まる X 座標を返します。
-/// @param column 列
-/// @return 指定した列が始まる X 座標（ピクセル）。列が存在しない場合は最後の列の終端の座標を返します。
-[[nodiscard]]
-int32 CellGrid::getCellX(size_t column) const noexcept
-{
-	column = Min(column, m_columnWidths.size());
-	return m_columnWidths.indexToPos(column);
-}
-
-/// @brief 指定した行が始まる Y 座標を返します。
-/// @param row 行
-/// @return 指定した行が始まる Y 座標（ピクセル）。行が存在しない場合は最後の行の終端の座標を返します。
-[[nodiscard]]
-int32 CellGrid::getCellY(size_t row) const noexcept
-{
-	row = Min(row, m_rowHeights.size());
-	return m_rowHeights.indexToPos(row);
-}
-
-/// @brief 指定したインデックスのセルの位置を返します。
-/// @param column 列
-/// @param row 行
-/// @return セルの位置（ピクセル）
-/// @remark セルの位置は、セルの左上隅の座標です。
-[[nodiscard]]
-Point CellGrid::getCellPosition(size_t column, size_t row) const noexcept
-{
-	return{ getCellX(column), getCellY(row) };
-}
-
-/// @brief 指定したインデックスのセルの範囲を返します。
-/// @param column 列
-/// @param row 行
-/// @return セルの範囲（ピクセル）
-/// @remark セルの範囲は、セルの左上隅の座標とセルのサイズからなります。
-[[nodiscard]]
-Rect CellGrid::getCellRect(size_t column, size_t row) const noexcept
-{
-	auto [x, w] = m_columnWidths.getCellRange(column);
-	auto [y, h] = m_rowHeights.getCellRange(row);
-	return Rect(x, y, w, h);
-}
-
-/// @brief 指定した X 座標がどの列に属するかを返します。
-/// @param x X 座標
-/// @return 列のインデックス。指定した座標がどの列にも属さない場合は、none を返します。
-[[nodiscard]]
-Optional<size_t> CellGrid::getColumnIndex(int32 x) const noexcept
-{
-	if (x < 0 || getTotalWidth() <= x) return none;
-	return m_columnWidths.posToIndex(x);
-}
-
-/// @brief 指定した Y 座標がどの行に属するかを返します。
-/// @param y Y 座標
-/// @return 行のインデックス。指定した座標がどの行にも属さない場合は、none を返します。
-[[nodiscard]]
-Optional<size_t> CellGrid::getRowIndex(int32 y) const noexcept
-{
-	if (y < 0 || getTotalHeight() <= y) return none;
-	return m_rowHeights.posToIndex(y);
-}
-
-/// @brief 指定した座標がどのセルに属するかを返します。
-/// @param pos 座標
-/// @return セルのインデックス。指定した座標がどのセルにも属さない場合は、none を返します。
-[[nodiscard]]
-Optional<Point> CellGrid::getCellIndex(Point pos) const noexcept
-{
-	const auto column = getColumnIndex(pos.x);
-	const auto row = getRowIndex(pos.y);
-
-	if (column && row)
-	{
-		return Point{ *column, *row };
-	}
-	else
-	{
-		return none;
-	}
-}
+﻿# include "gridcell/CellGrid.hpp"
+
+namespace
+{
+	// 軸は 64 ビットで位置を持つが、描画に使う座標は int32 なので、そこで頭打ちにする
+	int32 ToPixel(TreeGridAxis::Position pos) noexcept
+	{
+		return static_cast<int32>(Min<TreeGridAxis::Position>(pos, CellGrid::MaxPosition));
+	}
+}
+
+/// @brief 各列の幅と各行の高さを指定して CellGrid を作成します。
+/// @param columnWidths 各列の幅（ピクセル）
+/// @param rowHeights 各行の高さ（ピクセル）
+CellGrid::CellGrid(const Array<int32>& columnWidths, const Array<int32>& rowHeights)
+	: m_columnWidths(columnWidths)
+	, m_rowHeights(rowHeights) {}
+
+/// @brief 全ての列の幅と全ての行の高さが等しい CellGrid を作成します。
+/// @param cellCount 列の個数と行の個数
+/// @param cellSize 列の幅と行の高さ（ピクセル）
+/// @remark 同じ幅が続く区間はまとめて保持されるため、行や列の個数によらず少ないメモリで済みます。
+CellGrid::CellGrid(const Size& cellCount, const Size& cellSize)
+	: m_columnWidths(static_cast<size_t>(cellCount.x), cellSize.x)
+	, m_rowHeights(static_cast<size_t>(cellCount.y), cellSize.y) {}
+
+/// @brief 列の個数を返します。
+/// @return 列の個数
+[[nodiscard]]
+size_t CellGrid::getColumnCount() const noexcept
+{
+	return m_columnWidths.size();
+}
+
+/// @brief 行の個数を返します。
+/// @return 行の個数
+[[nodiscard]]
+size_t CellGrid::getRowCount() const noexcept
+{
+	return m_rowHeights.size();
+}
+
+/// @brief セルの個数が 0 であるかを返します。
+/// @return セルの個数が 0 である場合 true, それ以外の場合は false
+[[nodiscard]]
+bool CellGrid::isEmpty() const noexcept
+{
+	return (m_columnWidths.isEmpty() || m_rowHeights.isEmpty());
+}
+
+/// @brief セルの個数を返します。
+/// @return セルの個数
+[[nodiscard]]
+size_t CellGrid::getNumCells() const noexcept
+{
+	return getRowCount() * getColumnCount();
+}
+
+/// @brief 行と列の情報をクリアします。
+void CellGrid::clear() noexcept
+{
+	m_columnWidths.clear();
+	m_rowHeights.clear();
+	++m_sizeVersion;
+}
+
+/// @brief 各列の幅を返します。
+/// @return 各列の幅（ピクセル）
+[[nodiscard]]
+Array<int32> CellGrid::getColumnWidths() const
+{
+	return m_columnWidths.getWidthArray();
+}
+
+/// @brief 各行の高さを返します。
+/// @return 各行の高さ（ピクセル）
+[[nodiscard]]
+Array<int32> CellGrid::getRowHeights() const
+{
+	return m_rowHeights.getWidthArray();
+}
+
+/// @brief 列の幅を追加します。
+/// @param width 列の幅（ピクセル）
+/// @remark この関数を呼び出すと、列の個数が 1 増えます。
+void CellGrid::addColumn(int32 width)
+{
+	m_columnWidths.insert(getColumnCount(), width);
+	++m_sizeVersion;
+}
+
+/// @brief 行の高さを追加します。
+/// @param height 行の高さ（ピクセル）
+/// @remark この関数を呼び出すと、行の個数が 1 増えます。
+void CellGrid::addRow(int32 height)
+{
+	m_rowHeights.insert(getRowCount(), height);
+	++m_sizeVersion;
+}
+
+/// @brief 指定した列を削除します。
+/// @param column 列
+void CellGrid::removeColumn(size_t column)
+{
+	assert(column < m_columnWidths.size());
+	m_columnWidths.erase(column);
+	++m_sizeVersion;
+}
+
+/// @brief 指定した行を削除します。
+/// @param row 行
+void CellGrid::removeRow(size_t row)
+{
+	assert(row < m_rowHeights.size());
+	m_rowHeights.erase(row);
+	++m_sizeVersion;
+}
+
+/// @brief 列を挿入します。
+/// @param column 挿入する列の位置
+/// @param width 列の幅（ピクセル）
+void CellGrid::insertColumn(size_t column, int32 width)
+{
+	assert(column <= m_columnWidths.size());
+	m_columnWidths.insert(column, width);
+	++m_sizeVersion;
+}
+
+/// @brief 行を挿入します。
+/// @param row 挿入する行の位置
+/// @param height 行の高さ（ピクセル）
+void CellGrid::insertRow(size_t row, int32 height)
+{
+	assert(row <= m_rowHeights.size());
+	m_rowHeights.insert(row, height);
+	++m_sizeVersion;
+}
+
+/// @brief 複数の列の幅をまとめて追加します。
+/// @param widths 各列の幅（ピクセル）
+/// @remark この関数を呼び出すと、列の個数が widths.size() 増えます。
+void CellGrid::addColumns(std::span<const int32> widths)
+{
+	m_columnWidths.appendRange(widths);
+	++m_sizeVersion;
+}
+
+/// @brief 複数の行の高さをまとめて追加します。
+/// @param heights 各行の高さ（ピクセル）
+/// @remark この関数を呼び出すと、行の個数が heights.size() 増えます。
+void CellGrid::addRows(std::span<const int32> heights)
+{
+	m_rowHeights.appendRange(heights);
+	++m_sizeVersion;
+}
+
+/// @brief 同じ幅の列をまとめて追加します。
+/// @param count 追加する列の個数
+/// @param width 列の幅（ピクセル）
+void CellGrid::addColumns(size_t count, int32 width)
+{
+	m_columnWidths.appendRun(count, width);
+	++m_sizeVersion;
+}
+
+/// @brief 同じ高さの行をまとめて追加します。
+/// @param count 追加する行の個数
+/// @param height 行の高さ（ピクセル）
+void CellGrid::addRows(size_t count, int32 height)
+{
+	m_rowHeights.appendRun(count, height);
+	++m_sizeVersion;
+}
+
+/// @brief 指定した範囲の列を削除します。
+/// @param first 削除する最初の列
+/// @param last 削除する最後の列の次の列
+void CellGrid::removeColumns(size_t first, size_t last)
+{
+	assert(first <= last && last <= m_columnWidths.size());
+	m_columnWidths.eraseRange(first, last);
+	++m_sizeVersion;
+}
+
+/// @brief 指定した範囲の行を削除します。
+/// @param first 削除する最初の行
+/// @param last 削除する最後の行の次の行
+void CellGrid::removeRows(size_t first, size_t last)
+{
+	assert(first <= last && last <= m_rowHeights.size());
+	m_rowHeights.eraseRange(first, last);
+	++m_sizeVersion;
+}
+
+/// @brief 複数の列をまとめて挿入します。
+/// @param column 挿入する列の位置
+/// @param widths 各列の幅（ピクセル）
+void CellGrid::insertColumns(size_t column, std::span<const int32> widths)
+{
+	assert(column <= m_columnWidths.size());
+	m_columnWidths.insertRange(column, widths);
+	++m_sizeVersion;
+}
+
+/// @brief 複数の行をまとめて挿入します。
+/// @param row 挿入する行の位置
+/// @param heights 各行の高さ（ピクセル）
+void CellGrid::insertRows(size_t row, std::span<const int32> heights)
+{
+	assert(row <= m_rowHeights.size());
+	m_rowHeights.insertRange(row, heights);
+	++m_sizeVersion;
+}
+
+/// @brief 指定した列の幅を変更します。
+/// @param column 列
+/// @param width 列の幅（ピクセル）
+void CellGrid::setColumnWidth(size_t column, int32 width) noexcept
+{
+	assert(column < m_columnWidths.size());
+	m_columnWidths.setWidth(column, width);
+	++m_sizeVersion;
+}
+
+/// @brief 指定した行の高さを変更します。
+/// @param row 行
+/// @param height 行の高さ（ピクセル）
+void CellGrid::setRowHeight(size_t row, int32 height) noexcept
+{
+	assert(row < m_rowHeights.size());
+	m_rowHeights.setWidth(row, height);
+	++m_sizeVersion;
+}
+
+/// @brief 複数の列の幅をまとめて変更します。
+/// @param widths 列と列の幅（ピクセル）の組
+void CellGrid::setColumnWidths(std::span<const std::pair<size_t, int32>> widths)
+{
+	m_columnWidths.setWidths(widths);
+	++m_sizeVersion;
+}
+
+/// @brief 複数の行の高さをまとめて変更します。
+/// @param heights 行と行の高さ（ピクセル）の組
+void CellGrid::setRowHeights(std::span<const std::pair<size_t, int32>> heights)
+{
+	m_rowHeights.setWidths(heights);
+	++m_sizeVersion;
+}
+
+/// @brief 指定した列の幅を返します。
+/// @param column 列
+/// @return 列の幅（ピクセル）
+[[nodiscard]]
+int32 CellGrid::getColumnWidth(size_t column) const noexcept
+{
+	assert(column < m_columnWidths.size());
+	return m_columnWidths.getWidth(column);
+}
+
+/// @brief 指定した行の高さを返します。
+/// @param row 行
+/// @return 行の高さ（ピクセル）
+[[nodiscard]]
+int32 CellGrid::getRowHeight(size_t row) const noexcept
+{
+	assert(row < m_rowHeights.size());
+	return m_rowHeights.getWidth(row);
+}
+
+/// @brief 指定したインデックスのセルのサイズを返します。
+/// @param column 列
+/// @param row 行
+/// @return セルのサイズ（ピクセル）
+Size CellGrid::getCellSize(size_t column, size_t row) const noexcept
+{
+	assert(column < m_columnWidths.size());
+	assert(row < m_rowHeights.size());
+	return{ m_columnWidths.getWidth(column), m_rowHeights.getWidth(row) };
+}
+
+/// @brief 全ての列の幅の合計を返します。
+/// @return 全ての列の幅の合計（ピクセル）。 MaxPosition を超える場合は MaxPosition
+[[nodiscard]]
+int32 CellGrid::getTotalWidth() const noexcept
+{
+	return ToPixel(m_columnWidths.totalWidth());
+}
+
+/// @brief 列の幅や行の高さ、列や行の個数を変えるたびに増える値を返します。
+/// @return 列の幅と行の高さの版
+[[nodiscard]]
+uint64 CellGrid::getSizeVersion() const noexcept
+{
+	return m_sizeVersion;
+}
+
+/// @brief 全ての行の高さの合計を返します。
+/// @return 全ての行の高さの合計（ピクセル）。 MaxPosition を超える場合は MaxPosition
+[[nodiscard]]
+int32 CellGrid::getTotalHeight() const noexcept
+{
+	return ToPixel(m_rowHeights.totalWidth());
+}
+
+/// @brief 指定した列が始まる X 座標を返します。
+/// @param column 列
+/// @return 指定した列が始まる X 座標（ピクセル）。列が存在しない場合は最後の列の終端の座標を返します。
+[[nodiscard]]
+int32 CellGrid::getCellX(size_t column) const noexcept
+{
+	column = Min(column, m_columnWidths.size());
+	return ToPixel(m_columnWidths.indexToPos(column));
+}
+
+/// @brief 指定した行が始まる Y 座標を返します。
+/// @param row 行
+/// @return 指定した行が始まる Y 座標（ピクセル）。行が存在しない場合は最後の行の終端の座標を返します。
+[[nodiscard]]
+int32 CellGrid::getCellY(size_t row) const noexcept
+{
+	row = Min(row, m_rowHeights.size());
+	return ToPixel(m_rowHeights.indexToPos(row));
+}
+
+/// @brief 指定したインデックスのセルの位置を返します。
+/// @param column 列
+/// @param row 行
+/// @return セルの位置（ピクセル）
+/// @remark セルの位置は、セルの左上隅の座標です。
+[[nodiscard]]
+Point CellGrid::getCellPosition(size_t column, size_t row) const noexcept
+{
+	return{ getCellX(column), getCellY(row) };
+}
+
+/// @brief 指定したインデックスのセルの範囲を返します。
+/// @param column 列
+/// @param row 行
+/// @return セルの範囲（ピクセル）
+/// @remark セルの範囲は、セルの左上隅の座標とセルのサイズからなります。
+[[nodiscard]]
+Rect CellGrid::getCellRect(size_t column, size_t row) const noexcept
+{
+	auto [x, w] = m_columnWidths.getCellRange(column);
+	auto [y, h] = m_rowHeights.getCellRange(row);
+	return Rect(ToPixel(x), ToPixel(y), w, h);
+}
+
+/// @brief 指定した X 座標がどの列に属するかを返します。
+/// @param x X 座標
+/// @return 列のインデックス。指定した座標がどの列にも属さない場合は、none を返します。
+[[nodiscard]]
+Optional<size_t> CellGrid::getColumnIndex(int32 x) const noexcept
+{
+	if (x < 0 || getTotalWidth() <= x) return none;
+	return m_columnWidths.posToIndex(x);
+}
+
+/// @brief 指定した Y 座標がどの行に属するかを返します。
+/// @param y Y 座標
+/// @return 行のインデックス。指定した座標がどの行にも属さない場合は、none を返します。
+[[nodiscard]]
+Optional<size_t> CellGrid::getRowIndex(int32 y) const noexcept
+{
+	if (y < 0 || getTotalHeight() <= y) return none;
+	return m_rowHeights.posToIndex(y);
+}
+
+/// @brief 指定した座標がどのセルに属するかを返します。
+/// @param pos 座標
+/// @return セルのインデックス。指定した座標がどのセルにも属さない場合は、none を返します。
+[[nodiscard]]
+Optional<Point> CellGrid::getCellIndex(Point pos) const noexcept
+{
+	const auto column = getColumnIndex(pos.x);
+	const auto row = getRowIndex(pos.y);
+
+	if (column && row)
+	{
+		return Point{ *column, *row };
+	}
+	else
+	{
+		return none;
+	}
+}
+
+/// @brief 指定した範囲と重なる行と列を、それらの位置とサイズとともに返します。
+/// @param viewport 範囲（ピクセル）
+/// @return 範囲と重なる行と列
+/// @remark 各軸について、両端の要素を posToIndex で 2 回探索し、その間の位置とサイズは getCellRanges の一度の探索と走査で求めます。
+[[nodiscard]]
+CellGrid::VisibleSpan CellGrid::queryVisible(const RectF& viewport) const
+{
+	VisibleSpan span;
+	queryVisible(viewport, span);
+	return span;
+}
+
+/// @brief 指定した範囲と重なる行と列を、それらの位置とサイズとともに求めます。
+/// @param viewport 範囲（ピクセル）
+/// @param span 結果の格納先。配列の領域は再利用されます。
+void CellGrid::queryVisible(const RectF& viewport, VisibleSpan& span) const
+{
+	// [begin, end) の座標と重なる要素を、[first, last] として求める
+	const auto query = [](const TreeGridAxis& axis, double begin, double end, size_t& first, size_t& last, Array<int32>& positions, Array<int32>& sizes)
+		{
+			const int32 beginPos = static_cast<int32>(Max(Math::Floor(begin), 0.0));
+			const int32 endPos = static_cast<int32>(Min(Math::Ceil(end), static_cast<double>(ToPixel(axis.totalWidth()))));
+			if (endPos <= beginPos)
+			{
+				first = last = 0;
+				positions.clear();
+				sizes.clear();
+				return;
+			}
+			first = axis.posToIndex(beginPos);
+			last = Min(axis.posToIndex(endPos - 1), axis.size() - 1);
+			axis.getCellRanges(first, last + 1, positions, sizes);
+		};
+
+	query(m_columnWidths, viewport.x, viewport.x + viewport.w, span.firstColumn, span.lastColumn, span.xs, span.widths);
+	query(m_rowHeights, viewport.y, viewport.y + viewport.h, span.firstRow, span.lastRow, span.ys, span.heights);
+}
@@ -0,0 +1,471 @@
+﻿# include "gridcell/TreeGridAxis.hpp"
+
+using Coord = TreeGridAxis::Coord;
+using Position = TreeGridAxis::Position;
+
+namespace
+{
+	constexpr uint32 MaxRunLength = std::numeric_limits<uint32>::max();
+
+	Position RunWidth(Coord width, uint32 length)
+	{
+		return static_cast<Position>(width) * static_cast<Position>(length);
+	}
+
+	Coord ToCoord(Position pos)
+	{
+		return static_cast<Coord>(Min<Position>(pos, std::numeric_limits<Coord>::max()));
+	}
+}
+
+TreeGridAxis::TreeGridAxis()
+	: m_nodes(1) {}
+
+TreeGridAxis::TreeGridAxis(Array<Coord> init)
+	: m_nodes(1)
+{
+	m_root = build(init.data(), init.size());
+}
+
+TreeGridAxis::TreeGridAxis(size_t count, Coord width)
+	: m_nodes(1)
+{
+	Array<std::pair<Coord, uint32>> runs;
+	for (size_t rest = count; rest > 0;) {
+		const uint32 length = static_cast<uint32>(Min<size_t>(rest, MaxRunLength));
+		runs.emplace_back(width, length);
+		rest -= length;
+	}
+	m_root = build(runs);
+}
+
+uint32 TreeGridAxis::nextPriority()
+{
+	// xorshift32
+	m_seed ^= (m_seed << 13);
+	m_seed ^= (m_seed >> 17);
+	m_seed ^= (m_seed << 5);
+	return m_seed;
+}
+
+TreeGridAxis::NodeIndex TreeGridAxis::newNode(Coord width, uint32 length)
+{
+	Node node;
+	node.priority = nextPriority();
+	node.width = width;
+	node.length = length;
+	node.sum = RunWidth(width, length);
+	node.count = length;
+
+	if (m_free) {
+		const NodeIndex index = m_free.back();
+		m_free.pop_back();
+		m_nodes[index] = node;
+		return index;
+	}
+
+	m_nodes.push_back(node);
+	return static_cast<NodeIndex>(m_nodes.size() - 1);
+}
+
+void TreeGridAxis::deleteTree(NodeIndex node)
+{
+	if (node == 0) return;
+
+	Array<NodeIndex> stack{ node };
+	while (stack) {
+		const NodeIndex current = stack.back();
+		stack.pop_back();
+		if (m_nodes[current].left != 0) stack.push_back(m_nodes[current].left);
+		if (m_nodes[current].right != 0) stack.push_back(m_nodes[current].right);
+		m_free.push_back(current);
+	}
+}
+
+void TreeGridAxis::pull(NodeIndex node)
+{
+	Node& n = m_nodes[node];
+	const Node& l = m_nodes[n.left];
+	const Node& r = m_nodes[n.right];
+	n.count = l.count + n.length + r.count;
+	n.sum = l.sum + RunWidth(n.width, n.length) + r.sum;
+}
+
+std::pair<TreeGridAxis::NodeIndex, TreeGridAxis::NodeIndex> TreeGridAxis::split(NodeIndex node, size_t at)
+{
+	if (node == 0) return { 0, 0 };
+
+	const size_t leftCount = m_nodes[m_nodes[node].left].count;
+	const size_t length = m_nodes[node].length;
+	if (at <= leftCount) {
+		auto [a, b] = split(m_nodes[node].left, at);
+		m_nodes[node].left = b;
+		pull(node);
+		return { a, node };
+	}
+	else if (leftCount + length <= at) {
+		auto [a, b] = split(m_nodes[node].right, at - leftCount - length);
+		m_nodes[node].right = a;
+		pull(node);
+		return { node, b };
+	}
+	else {
+		// ランの途中で切る。後半は同じ優先度の新しいノードにして右の部分木を引き継ぐ
+		const uint32 headLength = static_cast<uint32>(at - leftCount);
+		const NodeIndex tail = newNode(m_nodes[node].width, static_cast<uint32>(length - headLength));
+		m_nodes[tail].priority = m_nodes[node].priority;
+		m_nodes[tail].right = m_nodes[node].right;
+		pull(tail);
+
+		m_nodes[node].length = headLength;
+		m_nodes[node].right = 0;
+		pull(node);
+		return { node, tail };
+	}
+}
+
+TreeGridAxis::NodeIndex TreeGridAxis::merge(NodeIndex left, NodeIndex right)
+{
+	if (left == 0) return right;
+	if (right == 0) return left;
+
+	if (m_nodes[left].priority > m_nodes[right].priority) {
+		const NodeIndex merged = merge(m_nodes[left].right, right);
+		m_nodes[left].right = merged;
+		pull(left);
+		return left;
+	}
+	else {
+		const NodeIndex merged = merge(left, m_nodes[right].left);
+		m_nodes[right].left = merged;
+		pull(right);
+		return right;
+	}
+}
+
+TreeGridAxis::NodeIndex TreeGridAxis::join(NodeIndex left, NodeIndex right)
+{
+	if (left == 0) return right;
+	if (right == 0) return left;
+
+	NodeIndex last = left;
+	while (m_nodes[last].right != 0) last = m_nodes[last].right;
+	NodeIndex first = right;
+	while (m_nodes[first].left != 0) first = m_nodes[first].left;
+
+	const Coord width = m_nodes[last].width;
+	const uint32 firstLength = m_nodes[first].length;
+	if (m_nodes[first].width != width || MaxRunLength - m_nodes[last].length < firstLength) {
+		return merge(left, right);
+	}
+
+	// 右側の先頭のランを取り外し、左側の末尾のランに吸収させる
+	auto [head, rest] = split(right, firstLength);
+	deleteTree(head);
+
+	for (NodeIndex node = left; node != 0; node = m_nodes[node].right) {
+		m_nodes[node].count += firstLength;
+		m_nodes[node].sum += RunWidth(width, firstLength);
+		if (node == last) m_nodes[node].length += firstLength;
+	}
+
+	return merge(left, rest);
+}
+
+TreeGridAxis::NodeIndex TreeGridAxis::build(std::span<const std::pair<Coord, uint32>> runs)
+{
+	// 右スパインをスタックに持つデカルト木の構築
+	// ポップされた時点で部分木が確定するので、そこで pull する
+	Array<NodeIndex> stack;
+	for (const auto& [width, length] : runs) {
+		const NodeIndex node = newNode(width, length);
+		NodeIndex last = 0;
+		while (stack && m_nodes[stack.back()].priority < m_nodes[node].priority) {
+			last = stack.back();
+			stack.pop_back();
+			pull(last);
+		}
+		m_nodes[node].left = last;
+		if (stack) m_nodes[stack.back()].right = node;
+		stack.push_back(node);
+	}
+
+	NodeIndex root = 0;
+	while (stack) {
+		root = stack.back();
+		stack.pop_back();
+		pull(root);
+	}
+	return root;
+}
+
+TreeGridAxis::NodeIndex TreeGridAxis::build(const Coord* widths, size_t count)
+{
+	Array<std::pair<Coord, uint32>> runs;
+	for (size_t i = 0; i < count; i++) {
+		if (runs && runs.back().first == widths[i] && runs.back().second < MaxRunLength) {
+			runs.back().second++;
+		}
+		else {
+			runs.emplace_back(widths[i], 1);
+		}
+	}
+	return build(runs);
+}
+
+TreeGridAxis::NodeIndex TreeGridAxis::findNode(size_t at) const
+{
+	NodeIndex node = m_root;
+	while (node != 0) {
+		const size_t leftCount = m_nodes[m_nodes[node].left].count;
+		if (at < leftCount) {
+			node = m_nodes[node].left;
+		}
+		else if (at < leftCount + m_nodes[node].length) {
+			return node;
+		}
+		else {
+			at -= leftCount + m_nodes[node].length;
+			node = m_nodes[node].right;
+		}
+	}
+	return 0;
+}
+
+size_t TreeGridAxis::size() const { return m_nodes[m_root].count; }
+
+Position TreeGridAxis::totalWidth() const { return m_nodes[m_root].sum; }
+
+bool TreeGridAxis::isEmpty() const { return size() == 0; }
+
+size_t TreeGridAxis::runCount() const { return m_nodes.size() - 1 - m_free.size(); }
+
+void TreeGridAxis::clear() { (*this) = TreeGridAxis(); }
+
+// lower bound
+size_t TreeGridAxis::posToIndex(Position x) const
+{
+	if (x < 0) return 0;
+
+	size_t base = 0;
+	NodeIndex node = m_root;
+	while (node != 0) {
+		const Node& n = m_nodes[node];
+		const Node& l = m_nodes[n.left];
+		if (x < l.sum) {
+			node = n.left;
+			continue;
+		}
+		x -= l.sum;
+		const Position runWidth = RunWidth(n.width, n.length);
+		if (x < runWidth) return base + l.count + static_cast<size_t>(x / n.width);
+		x -= runWidth;
+		base += l.count + n.length;
+		node = n.right;
+	}
+	return size();
+}
+
+Position TreeGridAxis::indexToPos(size_t at) const
+{
+	if (at >= size()) return totalWidth();
+
+	Position pos = 0;
+	NodeIndex node = m_root;
+	while (node != 0) {
+		const Node& n = m_nodes[node];
+		const Node& l = m_nodes[n.left];
+		if (at < l.count) {
+			node = n.left;
+		}
+		else if (at < l.count + n.length) {
+			return pos + l.sum + RunWidth(n.width, static_cast<uint32>(at - l.count));
+		}
+		else {
+			pos += l.sum + RunWidth(n.width, n.length);
+			at -= l.count + n.length;
+			node = n.right;
+		}
+	}
+	return pos;
+}
+
+Coord TreeGridAxis::getWidth(size_t at) const
+{
+	return m_nodes[findNode(at)].width;
+}
+
+// ( left pos, width )
+std::pair<Position, Coord> TreeGridAxis::getCellRange(size_t at) const
+{
+	Position pos = 0;
+	NodeIndex node = m_root;
+	while (node != 0) {
+		const Node& n = m_nodes[node];
+		const Node& l = m_nodes[n.left];
+		if (at < l.count) {
+			node = n.left;
+		}
+		else if (at < l.count + n.length) {
+			return { pos + l.sum + RunWidth(n.width, static_cast<uint32>(at - l.count)), n.width };
+		}
+		else {
+			pos += l.sum + RunWidth(n.width, n.length);
+			at -= l.count + n.length;
+			node = n.right;
+		}
+	}
+	return { pos, 0 };
+}
+
+Array<Coord> TreeGridAxis::getWidthArray() const
+{
+	Array<Coord> res;
+	res.reserve(size());
+
+	// 通りがけ順
+	Array<NodeIndex> stack;
+	NodeIndex node = m_root;
+	while (node != 0 || stack) {
+		while (node != 0) {
+			stack.push_back(node);
+			node = m_nodes[node].left;
+		}
+		node = stack.back();
+		stack.pop_back();
+		res.insert(res.end(), m_nodes[node].length, m_nodes[node].width);
+		node = m_nodes[node].right;
+	}
+	return res;
+}
+
+void TreeGridAxis::getCellRanges(size_t first, size_t last, Array<Coord>& positions, Array<Coord>& widths) const
+{
+	positions.clear();
+	widths.clear();
+	last = Min(last, size());
+	if (last <= first) return;
+
+	// first を含むランまで降り、左に進んだノードを後で辿るために積んでおく
+	Array<NodeIndex> stack;
+	Position pos = 0;
+	size_t at = first;
+	size_t offset = 0;
+	NodeIndex node = m_root;
+	while (node != 0) {
+		const Node& n = m_nodes[node];
+		const Node& l = m_nodes[n.left];
+		if (at < l.count) {
+			stack.push_back(node);
+			node = n.left;
+		}
+		else if (at < l.count + n.length) {
+			offset = at - l.count;
+			pos += l.sum + RunWidth(n.width, static_cast<uint32>(offset));
+			break;
+		}
+		else {
+			pos += l.sum + RunWidth(n.width, n.length);
+			at -= l.count + n.length;
+			node = n.right;
+		}
+	}
+
+	size_t remaining = last - first;
+	positions.reserve(remaining);
+	widths.reserve(remaining);
+	while (node != 0 && remaining != 0) {
+		const Node& n = m_nodes[node];
+		for (size_t i = offset; i < n.length && remaining != 0; i++, remaining--) {
+			positions.push_back(ToCoord(pos));
+			widths.push_back(n.width);
+			pos += n.width;
+		}
+		offset = 0;
+
+		// 次のラン
+		if (n.right != 0) {
+			node = n.right;
+			while (m_nodes[node].left != 0) {
+				stack.push_back(node);
+				node = m_nodes[node].left;
+			}
+		}
+		else if (stack) {
+			node = stack.back();
+			stack.pop_back();
+		}
+		else {
+			node = 0;
+		}
+	}
+}
+
+void TreeGridAxis::insert(size_t at, Coord width)
+{
+	const NodeIndex node = newNode(width, 1);
+	auto [left, right] = split(m_root, at);
+	m_root = join(join(left, node), right);
+}
+
+void TreeGridAxis::erase(size_t at)
+{
+	eraseRange(at, at + 1);
+}
+
+void TreeGridAxis::insertRange(size_t at, std::span<const Coord> widths)
+{
+	if (widths.empty()) return;
+
+	const NodeIndex inserted = build(widths.data(), widths.size());
+	auto [left, right] = split(m_root, at);
+	m_root = join(join(left, inserted), right);
+}
+
+void TreeGridAxis::eraseRange(size_t first, size_t last)
+{
+	if (last <= first) return;
+
+	auto [left, rest] = split(m_root, first);
+	auto [target, right] = split(rest, last - first);
+	deleteTree(target);
+	m_root = join(left, right);
+}
+
+void TreeGridAxis::appendRange(std::span<const Coord> widths)
+{
+	if (widths.empty()) return;
+
+	m_root = join(m_root, build(widths.data(), widths.size()));
+}
+
+void TreeGridAxis::appendRun(size_t count, Coord width)
+{
+	if (count == 0) return;
+
+	Array<std::pair<Coord, uint32>> runs;
+	for (size_t rest = count; rest > 0;) {
+		const uint32 length = static_cast<uint32>(Min<size_t>(rest, MaxRunLength));
+		runs.emplace_back(width, length);
+		rest -= length;
+	}
+	m_root = join(m_root, build(runs));
+}
+
+void TreeGridAxis::setWidth(size_t at, Coord newWidth)
+{
+	const NodeIndex target = findNode(at);
+	if (target == 0 || m_nodes[target].width == newWidth) return;
+
+	// その 1 要素を切り出して幅を変え、前後のランと同じ幅になればまとめ直す
+	auto [left, rest] = split(m_root, at);
+	auto [single, right] = split(rest, 1);
+	m_nodes[single].width = newWidth;
+	pull(single);
+	m_root = join(join(left, single), right);
+}
+
+void TreeGridAxis::setWidths(std::span<const std::pair<size_t, Coord>> widths)
+{
+	for (const auto& [at, newWidth] : widths) setWidth(at, newWidth);
+}